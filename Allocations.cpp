@@ -0,0 +1,157 @@
+/*	Allocations.cpp
+	Jayden Fullerton
+
+	This file contains the allocation counter used by the benchmarks. The
+	global operator new and delete are replaced so every heap allocation made
+	with new is counted, and allocators that bypass new (the aligned pixel
+	buffers of Image) report theirs with noteAllocation(). Counting is two
+	relaxed atomic adds per allocation, so it is left on in every build. The
+	peak resident set size of the process is read from the operating system.	*/
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include "Allocations.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static std::atomic<long long> allocations(0);
+static std::atomic<long long> allocatedBytes(0);
+
+/*	records an allocation made without operator new
+	@param	bytes allocated
+	@pre	none
+	@post	the allocation is included in allocationCount()	*/
+void noteAllocation(size_t bytes)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add((long long)bytes, std::memory_order_relaxed);
+}
+
+/*	returns the allocations made so far
+	@pre	none
+	@post	number and total size of the heap allocations made since the
+			program started are returned	*/
+AllocationCount allocationCount()
+{
+	AllocationCount count;
+	count.count = allocations.load(std::memory_order_relaxed);
+	count.bytes = allocatedBytes.load(std::memory_order_relaxed);
+	return count;
+}
+
+/*	returns the peak resident set size of the process
+	@pre	none
+	@post	largest amount of physical memory the process has held is returned
+			in bytes, 0 if the operating system does not report it	*/
+long long peakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return (long long)counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (long long)usage.ru_maxrss; // bytes on macOS
+#else
+	return (long long)usage.ru_maxrss * 1024; // kilobytes on Linux
+#endif
+#endif
+}
+
+/*	starts a new peak resident set size measurement
+	@pre	none
+	@post	peakResidentBytes() reports the peak from now on where the
+			operating system allows it to be reset (Linux), otherwise nothing
+			changes and false is returned	*/
+bool resetPeakResident()
+{
+#ifdef __linux__
+	// writing 5 to clear_refs resets the peak RSS the kernel reports
+	std::ofstream refs("/proc/self/clear_refs");
+	refs << "5";
+	refs.flush();
+	return refs.good();
+#else
+	return false;
+#endif
+}
+
+/*	allocates memory for new, counting the allocation
+	@param	bytes to allocate
+	@pre	none
+	@post	pointer to the memory is returned, std::bad_alloc is thrown if
+			out of memory	*/
+void* operator new(size_t bytes)
+{
+	noteAllocation(bytes);
+	void* p = malloc(bytes > 0 ? bytes : 1);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t bytes)
+{
+	return operator new(bytes);
+}
+
+/*	allocates memory for new (nothrow), counting the allocation
+	@param	bytes to allocate
+	@pre	none
+	@post	pointer to the memory is returned, nullptr if out of memory	*/
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+	noteAllocation(bytes);
+	return malloc(bytes > 0 ? bytes : 1);
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t& tag) noexcept
+{
+	return operator new(bytes, tag);
+}
+
+/*	frees memory from new
+	@param	memory to free
+	@pre	p must be from new or nullptr
+	@post	memory is freed	*/
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
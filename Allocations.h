@@ -0,0 +1,47 @@
+/*	Allocations.h
+	Jayden Fullerton
+
+	This file contains the allocation counter used by the benchmarks. The
+	global operator new and delete are replaced so every heap allocation made
+	with new is counted, and allocators that bypass new (the aligned pixel
+	buffers of Image) report theirs with noteAllocation(). Counting is two
+	relaxed atomic adds per allocation, so it is left on in every build. The
+	peak resident set size of the process is read from the operating system.	*/
+#pragma once
+
+#include <cstddef>
+
+/*	AllocationCount struct
+
+	Number of heap allocations and the bytes requested by them since the
+	program started.	*/
+struct AllocationCount
+{
+	long long count;
+	long long bytes;
+};
+
+/*	records an allocation made without operator new
+	@param	bytes allocated
+	@pre	none
+	@post	the allocation is included in allocationCount()	*/
+void noteAllocation(size_t bytes);
+
+/*	returns the allocations made so far
+	@pre	none
+	@post	number and total size of the heap allocations made since the
+			program started are returned	*/
+AllocationCount allocationCount();
+
+/*	returns the peak resident set size of the process
+	@pre	none
+	@post	largest amount of physical memory the process has held is returned
+			in bytes, 0 if the operating system does not report it	*/
+long long peakResidentBytes();
+
+/*	starts a new peak resident set size measurement
+	@pre	none
+	@post	peakResidentBytes() reports the peak from now on where the
+			operating system allows it to be reset (Linux), otherwise nothing
+			changes and false is returned	*/
+bool resetPeakResident();
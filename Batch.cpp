@@ -0,0 +1,814 @@
+/*	Batch.cpp
+	Jayden Fullerton
+
+	This file contains the batch mode of the driver. Every input file is a
+	job that is decoded, segmented and encoded on a pool of worker threads.
+	Jobs only decode once their estimated memory fits in a shared budget, so
+	a directory of large frames never holds more than a bounded amount of
+	image data in flight, and a report is printed for every file and for the
+	batch as a whole.	*/
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include "Batch.h"
+#include "Profile.h"
+#include "RawImage.h"
+#include "RegionGraph.h"
+#include "StreamSegmenter.h"
+#include "ThreadPool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// Bytes a job holds per pixel: the decoded input and painted output, the
+// label map, the labeling scratch (union-find forest or region frontier) and
+// the encoder's working set
+static const long long BYTES_PER_PIXEL = 24;
+
+/*	FileFormat enum
+
+	How an input is read and its output written.	*/
+enum class FileFormat
+{
+	Gif,	// decoded and encoded by GifCodec
+	Ppm,	// binary PPM, mapped
+	Raw		// headerless RGB of the size given with -rawsize, mapped
+};
+
+/*	milliseconds since a point in time
+	@param	start of the interval
+	@pre	none
+	@post	milliseconds from start until now are returned	*/
+static double millisSince(std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/*	does a name match a wildcard pattern
+	@param	pattern, * matches any run of characters and ? any one character
+	@param	name to test
+	@pre	none
+	@post	true is returned if name matches pattern	*/
+static bool matches(const char* pattern, const char* name)
+{
+	// Greedy match that backtracks to the last * on a mismatch
+	const char* star = nullptr;
+	const char* resume = nullptr;
+	while (*name != '\0')
+	{
+		if (*pattern == '*')
+		{
+			star = pattern++;
+			resume = name;
+		}
+		else if (*pattern == '?' || *pattern == *name)
+		{
+			pattern++;
+			name++;
+		}
+		else if (star != nullptr)
+		{
+			pattern = star + 1;
+			name = ++resume;
+		}
+		else
+			return false;
+	}
+	while (*pattern == '*')
+		pattern++;
+	return *pattern == '\0';
+}
+
+/*	lists the names of the files in a directory
+	@param	directory to list, empty for the working directory
+	@pre	none
+	@post	the names of the entries of directory are returned	*/
+static std::vector<std::string> listDirectory(const std::string& directory)
+{
+	std::vector<std::string> names;
+#ifdef _WIN32
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA((directory.empty() ? std::string("*") : directory + "\\*").c_str(), &entry);
+	if (find == INVALID_HANDLE_VALUE)
+		return names;
+	do
+	{
+		if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			names.push_back(entry.cFileName);
+	} while (FindNextFileA(find, &entry));
+	FindClose(find);
+#else
+	DIR* dir = opendir(directory.empty() ? "." : directory.c_str());
+	if (dir == nullptr)
+		return names;
+	while (dirent* entry = readdir(dir))
+	{
+		if (entry->d_type != DT_DIR)
+			names.push_back(entry->d_name);
+	}
+	closedir(dir);
+#endif
+	return names;
+}
+
+/*	returns the position of the last path separator in a name
+	@param	file name
+	@pre	none
+	@post	index of the last / or \ is returned, npos if there is none	*/
+static size_t lastSeparator(const std::string& filename)
+{
+	return filename.find_last_of("/\\");
+}
+
+/*	returns the extension of a file name
+	@param	file name
+	@pre	none
+	@post	the extension from its dot, in lower case, is returned, empty if
+			the name has none	*/
+static std::string extensionOf(const std::string& filename)
+{
+	size_t dot = filename.find_last_of('.');
+	size_t split = lastSeparator(filename);
+	if (dot == std::string::npos || (split != std::string::npos && dot < split))
+		return "";
+	std::string extension = filename.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension;
+}
+
+/*	returns the format of a file
+	@param	file name
+	@pre	none
+	@post	format selected by the extension of filename is returned, GIF
+			for anything that is not .ppm, .raw or .rgb	*/
+static FileFormat formatOf(const std::string& filename)
+{
+	std::string extension = extensionOf(filename);
+	if (extension == ".ppm")
+		return FileFormat::Ppm;
+	if (extension == ".raw" || extension == ".rgb")
+		return FileFormat::Raw;
+	return FileFormat::Gif;
+}
+
+/*	BatchOptions constructor
+	@pre	none
+	@post	options write next to each input on every hardware thread with
+			no memory limit	*/
+BatchOptions::BatchOptions()
+{
+	jobs = 0;
+	maxMemory = 0;
+	writeStats = false;
+	rawRows = 0;
+	rawCols = 0;
+	streamRows = 0;
+	writeLabels = false;
+	cropTop = 0;
+	cropLeft = 0;
+	cropRows = 0;
+	cropCols = 0;
+	transform = Transform::None;
+}
+
+/*	MemoryBudget constructor
+	@param	bytes that may be held at once, 0 for no limit
+	@pre	limit must be non-negative
+	@post	nothing is held	*/
+MemoryBudget::MemoryBudget(long long limit)
+{
+	this->limit = limit;
+	used = 0;
+}
+
+/*	waits until bytes fit in the budget and holds them
+	@param	bytes to hold
+	@pre	none
+	@post	bytes are held. A request larger than the whole budget is let
+			through once nothing else is held so it cannot wait forever	*/
+void MemoryBudget::acquire(long long bytes)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	if (limit > 0)
+		released.wait(guard, [&] { return used == 0 || used + bytes <= limit; });
+	used += bytes;
+}
+
+/*	gives back held bytes
+	@param	bytes to give back
+	@pre	bytes must have been acquired
+	@post	bytes are no longer held and waiting jobs are woken	*/
+void MemoryBudget::release(long long bytes)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		used -= bytes;
+	}
+	released.notify_all();
+}
+
+/*	expands a file name pattern
+	@param	file name, the last component may hold * and ? wildcards
+	@pre	none
+	@post	the matching files are returned in sorted order, a name without
+			wildcards is returned as is	*/
+std::vector<std::string> expandInput(const std::string& pattern)
+{
+	std::vector<std::string> files;
+	size_t split = lastSeparator(pattern);
+	std::string directory = split == std::string::npos ? "" : pattern.substr(0, split);
+	std::string name = split == std::string::npos ? pattern : pattern.substr(split + 1);
+	if (name.find_first_of("*?") == std::string::npos)
+	{
+		files.push_back(pattern);
+		return files;
+	}
+
+	std::vector<std::string> entries = listDirectory(directory);
+	std::sort(entries.begin(), entries.end());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (matches(name.c_str(), entries[i].c_str()))
+			files.push_back(split == std::string::npos ? entries[i] : pattern.substr(0, split + 1) + entries[i]);
+	}
+	return files;
+}
+
+/*	reads a list of file names
+	@param	file holding one file name or pattern per line
+	@param	list to append the expanded names to
+	@pre	none
+	@post	every non-empty line is expanded onto files, false is returned if
+			the list could not be opened	*/
+bool readFileList(const std::string& filename, std::vector<std::string>& files)
+{
+	std::ifstream list(filename);
+	if (!list)
+		return false;
+	std::string line;
+	while (std::getline(list, line))
+	{
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.empty())
+			continue;
+		std::vector<std::string> expanded = expandInput(line);
+		files.insert(files.end(), expanded.begin(), expanded.end());
+	}
+	return true;
+}
+
+/*	reads an image of any supported format
+	@param	file name
+	@param	batch options, the raw size is used
+	@pre	none
+	@post	GIFs are decoded and PPM or raw files are memory-mapped, an image
+			with 0 rows is returned if the file could not be read	*/
+Image loadImage(const std::string& filename, const BatchOptions& options)
+{
+	switch (formatOf(filename))
+	{
+	case FileFormat::Ppm:
+		return mapPpm(filename);
+	case FileFormat::Raw:
+		return mapRaw(filename, options.rawRows, options.rawCols);
+	default:
+		return Image(filename);
+	}
+}
+
+/*	crops and transforms an image before it is segmented
+	@param	image to prepare
+	@param	batch options, the crop, transform and threads are used
+	@pre	none
+	@post	img is cropped and transformed, false is returned and img is
+			unchanged if the crop does not fit inside it	*/
+bool prepareImage(Image& img, const BatchOptions& options)
+{
+	if (options.cropRows > 0)
+	{
+		if (options.cropTop + options.cropRows > img.getRows() || options.cropLeft + options.cropCols > img.getCols())
+			return false;
+		img = cropImage(img, options.cropTop, options.cropLeft, options.cropRows, options.cropCols);
+	}
+	transformInPlace(img, options.transform, options.segment.threads);
+	return true;
+}
+
+/*	returns where the segmented image of an input is written
+	@param	input file name
+	@param	output directory, empty writes next to the input
+	@pre	none
+	@post	outputDir/name of the input, or name_segmented.gif beside the input
+			(name_segmented.ppm, .raw or .rgb for those inputs)	*/
+std::string outputPath(const std::string& input, const std::string& outputDir)
+{
+	size_t split = lastSeparator(input);
+	std::string name = split == std::string::npos ? input : input.substr(split + 1);
+	if (!outputDir.empty())
+	{
+		char last = outputDir[outputDir.size() - 1];
+		return last == '/' || last == '\\' ? outputDir + name : outputDir + "/" + name;
+	}
+
+	size_t dot = input.find_last_of('.');
+	if (dot == std::string::npos || (split != std::string::npos && dot < split))
+		dot = input.size();
+	std::string extension = formatOf(input) == FileFormat::Gif ? ".gif" : input.substr(dot);
+	return input.substr(0, dot) + "_segmented" + extension;
+}
+
+/*	returns the identity of an existing file
+	@param	file name
+	@param	string to write the identity to
+	@pre	none
+	@post	true is returned and id identifies the file, however its name is
+			spelled, if it exists; false is returned if it does not	*/
+static bool fileIdentity(const std::string& filename, std::string& id)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	BY_HANDLE_FILE_INFORMATION info;
+	bool found = GetFileInformationByHandle(file, &info) != 0;
+	CloseHandle(file);
+	if (found)
+		id = std::to_string(info.dwVolumeSerialNumber) + ":" + std::to_string(info.nFileIndexHigh) + ":"
+			+ std::to_string(info.nFileIndexLow);
+	return found;
+#else
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0)
+		return false;
+	id = std::to_string((unsigned long long)info.st_dev) + ":" + std::to_string((unsigned long long)info.st_ino);
+	return true;
+#endif
+}
+
+/*	do two names refer to the same file
+	@param	first file name
+	@param	second file name
+	@pre	none
+	@post	true is returned if both files exist and are one file, however
+			their names are spelled	*/
+static bool sameFile(const std::string& a, const std::string& b)
+{
+	std::string x, y;
+	return fileIdentity(a, x) && fileIdentity(b, y) && x == y;
+}
+
+/*	returns a key that is equal for every name of a file
+	@param	file name, the file need not exist
+	@pre	none
+	@post	the identity of an existing file is returned, otherwise the
+			absolute name the file would be created under	*/
+static std::string fileKey(const std::string& filename)
+{
+	std::string id;
+	if (fileIdentity(filename, id))
+		return "#" + id;
+#ifdef _WIN32
+	char full[MAX_PATH];
+	DWORD length = GetFullPathNameA(filename.c_str(), MAX_PATH, full, nullptr);
+	std::string key = length > 0 && length < MAX_PATH ? std::string(full, length) : filename;
+	std::transform(key.begin(), key.end(), key.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+	return key;
+#else
+	// Only the directory has to exist, the name in it is appended as is
+	size_t split = lastSeparator(filename);
+	std::string directory = split == std::string::npos ? "." : split == 0 ? "/" : filename.substr(0, split);
+	char* real = realpath(directory.c_str(), nullptr);
+	if (real == nullptr)
+		return filename;
+	std::string key = std::string(real) + "/" + filename.substr(split == std::string::npos ? 0 : split + 1);
+	free(real);
+	return key;
+#endif
+}
+
+/*	replaces the extension of a file name
+	@param	file name
+	@param	new extension, from its dot
+	@pre	none
+	@post	filename with its extension (if any) replaced is returned	*/
+static std::string withExtension(const std::string& filename, const std::string& extension)
+{
+	size_t dot = filename.find_last_of('.');
+	size_t split = lastSeparator(filename);
+	if (dot != std::string::npos && (split == std::string::npos || dot > split))
+		return filename.substr(0, dot) + extension;
+	return filename + extension;
+}
+
+/*	writes the segment statistics of a job next to its output
+	@param	output file name
+	@param	statistics of every segment
+	@pre	none
+	@post	the table is written to the output's name with a .csv extension	*/
+static void writeStatsFile(const std::string& output, const std::vector<SegmentStats>& stats)
+{
+	std::ofstream table(withExtension(output, ".csv"));
+	writeSegmentTable(table, stats);
+}
+
+/*	processes one PPM or raw file of a batch a band of rows at a time
+	@param	input file name
+	@param	format of the input
+	@param	batch options
+	@param	memory budget shared by every job
+	@param	report to fill in, with input and output set
+	@pre	format must not be GIF
+	@post	the input is segmented like the union-find mode and written,
+			report describes the outcome	*/
+static void streamJob(const std::string& input, FileFormat format, const BatchOptions& options,
+	MemoryBudget& budget, FileReport& report)
+{
+	FILE* in = fopen(input.c_str(), "rb");
+	if (in == nullptr)
+	{
+		report.error = "could not open " + input;
+		return;
+	}
+	int rows = options.rawRows;
+	int cols = options.rawCols;
+	if (format == FileFormat::Ppm ? !readPpmHeader(in, rows, cols) : rows <= 0 || cols <= 0)
+	{
+		fclose(in);
+		report.error = format == FileFormat::Ppm ? "not a readable PPM" : "raw inputs need -rawsize";
+		return;
+	}
+	report.rows = rows;
+	report.cols = cols;
+
+	// opening the output truncates it, and the input is still being read
+	if (sameFile(input, report.output))
+	{
+		fclose(in);
+		report.error = "output would overwrite the input";
+		return;
+	}
+	FILE* out = fopen(report.output.c_str(), "wb");
+	if (out == nullptr)
+	{
+		fclose(in);
+		report.error = "could not write " + report.output;
+		return;
+	}
+	if (format == FileFormat::Ppm)
+		fprintf(out, "P6\n%d %d\n255\n", cols, rows);
+
+	// Only a band is held, the queued label rows and open segments are small
+	// next to it for anything but pathological images
+	int bandRows = std::min(options.streamRows, rows);
+	long long bytes = (long long)bandRows * cols * BYTES_PER_PIXEL;
+	budget.acquire(bytes);
+
+	// A row of statistics is written as each segment closes, so only the
+	// open segments are ever held
+	std::ofstream table;
+	long long closed = 0;
+	if (options.writeStats)
+	{
+		table.open(withExtension(report.output, ".csv"));
+		writeSegmentHeader(table);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool written = true;
+	int read = 0;
+	{
+		StreamSegmenter segmenter(cols, options.segment.similarity,
+			[&](const pixel* colors)
+			{
+				std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+				written = fwrite(colors, sizeof(pixel), cols, out) == (size_t)cols && written;
+				report.encodeMs += millisSince(begin);
+			},
+			options.writeStats ? SegmentSink([&](const SegmentStats& s) { writeSegmentRow(table, closed++, s); })
+				: SegmentSink());
+		Image band(bandRows, cols);
+		while (read < rows)
+		{
+			PROFILE_SCOPE("decode");
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			int count = 0;
+			while (count < bandRows && read + count < rows
+				&& fread(band.getRow(count), sizeof(pixel), cols, in) == (size_t)cols)
+				count++;
+			report.decodeMs += millisSince(begin);
+			if (count == 0)
+				break;
+			segmenter.addRows(band, count);
+			read += count;
+		}
+		segmenter.finish();
+		report.segments = segmenter.getSegments();
+	}
+	report.segmentMs = millisSince(start) - report.decodeMs - report.encodeMs;
+	fclose(in);
+	written = fclose(out) == 0 && written;
+	budget.release(bytes);
+
+	if (read < rows)
+	{
+		report.error = format == FileFormat::Ppm ? "PPM is shorter than its header" : "raw file is smaller than -rawsize";
+		return;
+	}
+	if (!written)
+	{
+		report.error = "could not write " + report.output;
+		return;
+	}
+	report.ok = true;
+}
+
+/*	starts the report of one file of a batch
+	@param	input file name
+	@param	batch options
+	@param	report to fill in
+	@pre	none
+	@post	report names the input and its output and describes a job that
+			has not succeeded yet	*/
+static void startReport(const std::string& input, const BatchOptions& options, FileReport& report)
+{
+	report.input = input;
+	report.output = outputPath(input, options.outputDir);
+	report.rows = 0;
+	report.cols = 0;
+	report.segments = 0;
+	report.decodeMs = 0;
+	report.segmentMs = 0;
+	report.encodeMs = 0;
+	report.ok = false;
+}
+
+/*	processes one file of a batch
+	@param	input file name
+	@param	batch options
+	@param	memory budget shared by every job
+	@param	report to fill in
+	@pre	none
+	@post	the input is segmented and written, report describes the outcome	*/
+static void runJob(const std::string& input, const BatchOptions& options, MemoryBudget& budget, FileReport& report)
+{
+	PROFILE_SCOPE("job");
+	startReport(input, options, report);
+
+	FileFormat format = formatOf(input);
+	if (options.streamRows > 0)
+	{
+		if (format == FileFormat::Gif)
+			report.error = "streaming needs a PPM or raw input";
+		else
+			streamJob(input, format, options, budget, report);
+		return;
+	}
+
+	Image in(0, 0);
+	long long bytes = 0;
+	std::chrono::steady_clock::time_point start;
+	if (format == FileFormat::Gif)
+	{
+		// -out can name the input's own directory, whose output keeps the
+		// input's name
+		if (sameFile(input, report.output))
+		{
+			report.error = "output would overwrite the input";
+			return;
+		}
+
+		// The header gives the size of the image before anything is decoded
+		GifReader reader(input);
+		if (!reader.isValid())
+		{
+			report.error = "not a readable GIF";
+			return;
+		}
+		report.rows = reader.getRows();
+		report.cols = reader.getCols();
+		bytes = (long long)report.rows * report.cols * BYTES_PER_PIXEL;
+		budget.acquire(bytes);
+
+		start = std::chrono::steady_clock::now();
+		in = Image(reader);
+		report.decodeMs = millisSince(start);
+		if (in.getRows() == 0)
+		{
+			budget.release(bytes);
+			report.error = "corrupt GIF";
+			return;
+		}
+	}
+	else
+	{
+		// Creating the mapped output truncates its file, which must not be
+		// the one the input is about to be mapped from
+		if (sameFile(input, report.output))
+		{
+			report.error = "output would overwrite the input";
+			return;
+		}
+
+		// Mapping reads no pixels until they are used, so it is done before
+		// the budget is held and is all the decoding there is
+		start = std::chrono::steady_clock::now();
+		in = format == FileFormat::Ppm ? mapPpm(input) : mapRaw(input, options.rawRows, options.rawCols);
+		report.decodeMs = millisSince(start);
+		if (in.getRows() == 0)
+		{
+			report.error = format == FileFormat::Ppm ? "not a readable PPM" : "raw file is smaller than -rawsize";
+			return;
+		}
+		report.rows = in.getRows();
+		report.cols = in.getCols();
+		bytes = (long long)report.rows * report.cols * BYTES_PER_PIXEL;
+		budget.acquire(bytes);
+	}
+
+	// Preparing the image is counted as decoding it
+	start = std::chrono::steady_clock::now();
+	if (!prepareImage(in, options))
+	{
+		budget.release(bytes);
+		report.error = "crop does not fit inside the image";
+		return;
+	}
+	report.decodeMs += millisSince(start);
+	report.rows = in.getRows();
+	report.cols = in.getCols();
+
+	start = std::chrono::steady_clock::now();
+	Segmentation seg;
+	{
+		// Mapped formats are segmented straight into the output file
+		Image out = format == FileFormat::Gif ? Image(in.getRows(), in.getCols())
+			: format == FileFormat::Ppm ? createPpm(report.output, in.getRows(), in.getCols())
+			: createRaw(report.output, in.getRows(), in.getCols());
+		if (out.getRows() != 0)
+		{
+			// the label map is only kept when it is written
+			if (options.writeLabels)
+			{
+				labelImage(in, options.segment, seg);
+				paintLabels(seg.labels.data(), seg.stats, out);
+			}
+			else
+				segmentImage(in, out, options.segment, seg.stats);
+			report.segments = (int)seg.stats.size();
+		}
+		report.segmentMs = millisSince(start);
+
+		start = std::chrono::steady_clock::now();
+		report.ok = out.getRows() != 0 && (format != FileFormat::Gif || out.writeToDisk(report.output));
+	} // a mapped output is unmapped here, so that counts as encoding
+	std::string labelFile = withExtension(report.output, ".seg");
+	bool labelsWritten = true;
+	if (report.ok && options.writeLabels)
+	{
+		RegionGraph graph;
+		buildRegionGraph(in, seg, graph);
+		labelsWritten = writeSegmentation(labelFile, seg, graph);
+	}
+	report.encodeMs = millisSince(start);
+	budget.release(bytes);
+	if (!report.ok || !labelsWritten)
+	{
+		report.ok = false;
+		report.error = "could not write " + (labelsWritten ? report.output : labelFile);
+		return;
+	}
+
+	if (options.writeStats)
+		writeStatsFile(report.output, seg.stats);
+}
+
+/*	finds the jobs of a batch that would write over another job's files
+	@param	input file names
+	@param	batch options
+	@pre	none
+	@post	for every job whose output or its .csv or .seg would be an input
+			of the batch, or a file an earlier job writes, the error to
+			report is returned; the other jobs get an empty string	*/
+static std::vector<std::string> findCollisions(const std::vector<std::string>& files, const BatchOptions& options)
+{
+	std::unordered_map<std::string, size_t> inputs, written;
+	for (size_t i = 0; i < files.size(); i++)
+		inputs.emplace(fileKey(files[i]), i);
+
+	std::vector<std::string> errors(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		std::string output = outputPath(files[i], options.outputDir);
+		std::vector<std::string> keys(1, fileKey(output));
+		if (options.writeStats)
+			keys.push_back(fileKey(withExtension(output, ".csv")));
+		if (options.writeLabels)
+			keys.push_back(fileKey(withExtension(output, ".seg")));
+
+		for (size_t k = 0; k < keys.size() && errors[i].empty(); k++)
+		{
+			auto input = inputs.find(keys[k]);
+			auto earlier = written.find(keys[k]);
+			if (input != inputs.end())
+				errors[i] = input->second == i ? "output would overwrite the input"
+					: "output would overwrite " + files[input->second] + ", an input of the batch";
+			else if (earlier != written.end())
+				errors[i] = "output would overwrite the output of " + files[earlier->second];
+		}
+
+		// a refused job writes nothing, so its names stay free
+		if (errors[i].empty())
+		{
+			for (size_t k = 0; k < keys.size(); k++)
+				written.emplace(keys[k], i);
+		}
+	}
+	return errors;
+}
+
+/*	processes a batch of images
+	@param	input file names
+	@param	batch options
+	@param	report of every file, in the order of files
+	@pre	none
+	@post	every input is segmented and written, a line is printed as each
+			file finishes. A job that would write over an input of the batch
+			or over the output of an earlier job fails without running	*/
+void runBatch(const std::vector<std::string>& files, const BatchOptions& options, std::vector<FileReport>& reports)
+{
+	reports.assign(files.size(), FileReport());
+	MemoryBudget budget(options.maxMemory);
+	std::mutex printLock;
+	ThreadPool pool(options.jobs);
+
+	// Jobs write at the same time, so every output is checked against the
+	// whole batch before any of them starts
+	std::vector<std::string> collisions = findCollisions(files, options);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		pool.submit([&, i]
+		{
+			FileReport& report = reports[i];
+			if (collisions[i].empty())
+				runJob(files[i], options, budget, report);
+			else
+			{
+				startReport(files[i], options, report);
+				report.error = collisions[i];
+			}
+
+			std::lock_guard<std::mutex> guard(printLock);
+			if (report.ok)
+				std::cout << report.input << " -> " << report.output << ": " << report.cols << "x" << report.rows
+					<< ", " << report.segments << " segments, decode " << report.decodeMs << " ms, segment "
+					<< report.segmentMs << " ms, encode " << report.encodeMs << " ms" << std::endl;
+			else
+				std::cout << report.input << ": failed, " << report.error << std::endl;
+		});
+	}
+	pool.wait();
+}
+
+/*	prints the throughput of a batch
+	@param	report of every file
+	@param	wall clock time of the whole batch in milliseconds
+	@pre	none
+	@post	files processed, images per second and megapixels per second are
+			written to the console	*/
+void printBatchSummary(const std::vector<FileReport>& reports, double elapsedMs)
+{
+	int done = 0;
+	double megapixels = 0;
+	double decodeMs = 0, segmentMs = 0, encodeMs = 0;
+	for (size_t i = 0; i < reports.size(); i++)
+	{
+		if (!reports[i].ok)
+			continue;
+		done++;
+		megapixels += (double)reports[i].rows * reports[i].cols / 1e6;
+		decodeMs += reports[i].decodeMs;
+		segmentMs += reports[i].segmentMs;
+		encodeMs += reports[i].encodeMs;
+	}
+
+	double seconds = elapsedMs / 1000;
+	std::cout << "Processed " << done << " of " << reports.size() << " images (" << megapixels << " MP) in "
+		<< seconds << " s" << std::endl;
+	if (seconds > 0)
+		std::cout << "Throughput: " << done / seconds << " images/s, " << megapixels / seconds << " MP/s" << std::endl;
+	std::cout << "Time in each stage across all jobs: decode " << decodeMs << " ms, segment " << segmentMs
+		<< " ms, encode " << encodeMs << " ms" << std::endl;
+}
@@ -0,0 +1,141 @@
+/*	Batch.h
+	Jayden Fullerton
+
+	This file contains the batch mode of the driver. Every input file is a
+	job that is decoded, segmented and encoded on a pool of worker threads.
+	Jobs only decode once their estimated memory fits in a shared budget, so
+	a directory of large frames never holds more than a bounded amount of
+	image data in flight, and a report is printed for every file and for the
+	batch as a whole. PPM and raw RGB inputs are memory-mapped instead of
+	decoded and their output is segmented straight into a mapped file of
+	the same format, or with -stream they are read and written a band of
+	rows at a time so an image never has to fit in memory.	*/
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Pipeline.h"
+#include "Transform.h"
+
+/*	BatchOptions struct
+
+	Selects how a batch of images is processed.	*/
+struct BatchOptions
+{
+	SegmentOptions segment;	// how every image is segmented
+	std::string outputDir;	// directory to write to, empty writes next to each input
+	int jobs;				// images processed at once, 0 for every hardware thread
+	long long maxMemory;	// bytes of image data in flight, 0 for no limit
+	bool writeStats;		// write a CSV of segment statistics for every image
+	bool writeLabels;		// write the label map and region graph of every image
+	int rawRows, rawCols;	// size of every .raw/.rgb input, 0 if not given
+	int streamRows;			// rows read at a time when streaming PPM/raw inputs, 0 maps them whole
+	int cropTop, cropLeft;	// rectangle of every input that is segmented,
+	int cropRows, cropCols;	// 0 rows keeps the whole image
+	Transform transform;	// applied after cropping, before segmenting
+
+	/*	BatchOptions constructor
+		@pre	none
+		@post	options write next to each input on every hardware thread with
+				no memory limit	*/
+	BatchOptions();
+};
+
+/*	FileReport struct
+
+	The outcome of one job of a batch.	*/
+struct FileReport
+{
+	std::string input, output;
+	int rows, cols;
+	int segments;
+	double decodeMs, segmentMs, encodeMs;
+	bool ok;
+	std::string error;
+};
+
+class MemoryBudget
+{
+	std::mutex lock;
+	std::condition_variable released;
+	long long limit;
+	long long used;
+public:
+	/*	MemoryBudget constructor
+		@param	bytes that may be held at once, 0 for no limit
+		@pre	limit must be non-negative
+		@post	nothing is held	*/
+	MemoryBudget(long long limit = 0);
+
+	/*	waits until bytes fit in the budget and holds them
+		@param	bytes to hold
+		@pre	none
+		@post	bytes are held. A request larger than the whole budget is let
+				through once nothing else is held so it cannot wait forever	*/
+	void acquire(long long bytes);
+
+	/*	gives back held bytes
+		@param	bytes to give back
+		@pre	bytes must have been acquired
+		@post	bytes are no longer held and waiting jobs are woken	*/
+	void release(long long bytes);
+};
+
+/*	expands a file name pattern
+	@param	file name, the last component may hold * and ? wildcards
+	@pre	none
+	@post	the matching files are returned in sorted order, a name without
+			wildcards is returned as is	*/
+std::vector<std::string> expandInput(const std::string& pattern);
+
+/*	reads a list of file names
+	@param	file holding one file name or pattern per line
+	@param	list to append the expanded names to
+	@pre	none
+	@post	every non-empty line is expanded onto files, false is returned if
+			the list could not be opened	*/
+bool readFileList(const std::string& filename, std::vector<std::string>& files);
+
+/*	reads an image of any supported format
+	@param	file name
+	@param	batch options, the raw size is used
+	@pre	none
+	@post	GIFs are decoded and PPM or raw files are memory-mapped, an image
+			with 0 rows is returned if the file could not be read	*/
+Image loadImage(const std::string& filename, const BatchOptions& options);
+
+/*	crops and transforms an image before it is segmented
+	@param	image to prepare
+	@param	batch options, the crop, transform and threads are used
+	@pre	none
+	@post	img is cropped and transformed, false is returned and img is
+			unchanged if the crop does not fit inside it	*/
+bool prepareImage(Image& img, const BatchOptions& options);
+
+/*	returns where the segmented image of an input is written
+	@param	input file name
+	@param	output directory, empty writes next to the input
+	@pre	none
+	@post	outputDir/name of the input, or name_segmented.gif beside the input
+			(name_segmented.ppm, .raw or .rgb for those inputs)	*/
+std::string outputPath(const std::string& input, const std::string& outputDir);
+
+/*	processes a batch of images
+	@param	input file names
+	@param	batch options
+	@param	report of every file, in the order of files
+	@pre	none
+	@post	every input is segmented and written, a line is printed as each
+			file finishes. A job that would write over an input of the batch
+			or over the output of an earlier job fails without running	*/
+void runBatch(const std::vector<std::string>& files, const BatchOptions& options, std::vector<FileReport>& reports);
+
+/*	prints the throughput of a batch
+	@param	report of every file
+	@param	wall clock time of the whole batch in milliseconds
+	@pre	none
+	@post	files processed, images per second and megapixels per second are
+			written to the console	*/
+void printBatchSummary(const std::vector<FileReport>& reports, double elapsedMs);
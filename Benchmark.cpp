@@ -0,0 +1,471 @@
+/*	Benchmark.cpp
+	Jayden Fullerton
+
+	This file contains the benchmarks of the segmentation modes. An image is
+	segmented several times with each configuration and the fastest run is
+	reported as milliseconds per image, nanoseconds per pixel and megapixels
+	per second. The benchmark suite times the Image and Container operations
+	and every segmentation mode on synthetic images of several sizes and
+	region counts, and reports the allocations and peak memory of each case
+	as JSON so results can be compared between builds.	*/
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <string>
+#include "Allocations.h"
+#include "Benchmark.h"
+#include "ColorKernel.h"
+#include "Container.h"
+#include "Transform.h"
+
+/*	times the fastest of several segmentations
+	@param	image to segment
+	@param	segmentation options
+	@param	number of times to segment
+	@param	number of segments found
+	@pre	repeats must be positive
+	@post	milliseconds taken by the fastest run are returned	*/
+static double fastestRun(const Image& in, const SegmentOptions& options, int repeats, size_t& segments)
+{
+	Image out(in.getRows(), in.getCols());
+	std::vector<SegmentStats> stats;
+	double best = 0;
+	for (int i = 0; i < repeats; i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		segmentImage(in, out, options, stats);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (i == 0 || elapsed.count() < best)
+			best = elapsed.count();
+	}
+	segments = stats.size();
+	return best;
+}
+
+/*	times segmenting an image with every color metric
+	@param	image to segment
+	@param	segmentation options, the metric is replaced by each metric in turn
+			and the threshold is used for all of them
+	@param	number of times to segment with each metric
+	@param	stream to write the results to
+	@pre	repeats must be positive
+	@post	a table with the segments found and the throughput of each metric
+			is written to out	*/
+void benchmarkMetrics(const Image& in, const SegmentOptions& options, int repeats, std::ostream& out)
+{
+	const Metric metrics[] = { Metric::L1, Metric::L2, Metric::Chebyshev, Metric::Weighted, Metric::Lab };
+	double pixels = (double)in.getRows() * in.getCols();
+
+	out << (options.unionFind ? "union-find" : "flood fill") << ", " << in.getCols() << "x" << in.getRows()
+		<< ", threshold " << options.similarity.threshold << ", best of " << repeats << " runs" << std::endl;
+	out << std::left << std::setw(12) << "metric" << std::right << std::setw(10) << "segments" << std::setw(12)
+		<< "ms/image" << std::setw(12) << "ns/pixel" << std::setw(10) << "MP/s" << std::endl;
+	for (Metric metric : metrics)
+	{
+		SegmentOptions run = options;
+		run.similarity.metric = metric;
+		run.verbose = false;
+		size_t segments;
+		double ms = fastestRun(in, run, repeats, segments);
+		out << std::left << std::setw(12) << metricName(metric) << std::right << std::setw(10) << segments
+			<< std::fixed << std::setprecision(2) << std::setw(12) << ms << std::setw(12) << ms * 1e6 / pixels
+			<< std::setw(10) << pixels / ms / 1e3 << std::defaultfloat << std::endl;
+	}
+}
+
+// Region counts the segmentation cases are run with, a count is skipped if
+// it leaves regions smaller than MIN_REGION_PIXELS
+static const int REGION_COUNTS[] = { 16, 1024, 65536 };
+static const int MIN_REGION_PIXELS = 8;
+
+// Region count of the image the Image and Container cases run on
+static const int OPERATION_REGIONS = 1024;
+
+// Smallest segment the merging mode keeps, the size the driver's summary
+// counts as a fragment
+static const int MERGE_MIN_REGION = 10;
+
+// Levels of flat blocks the coarse-to-fine union-find case labels with
+static const int PYRAMID_LEVELS = 4;
+
+// Results of the timed loops are stored here so they are not optimized away
+static volatile long long sink;
+
+/*	BenchmarkCase struct
+
+	The measurements of one case of the suite.	*/
+struct BenchmarkCase
+{
+	std::string name;
+	int megapixels, rows, cols;
+	int regions;			// 0 if the case does not depend on the image content
+	int runs;
+	double ms;				// fastest run
+	long long allocations;	// made by one run
+	long long allocatedBytes;
+	long long peakResident;	// peak resident set size of the process during the case
+	long long segments;		// -1 if the case does not segment
+};
+
+/*	next value of a linear congruential generator
+	@param	state of the generator
+	@pre	none
+	@post	state is advanced and its top bits are returned	*/
+static unsigned nextRandom(unsigned& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+/*	makes a synthetic image of flat colored regions
+	@param	number of rows
+	@param	number of columns
+	@param	number of regions, laid out as a grid of rectangles
+	@param	seed of the colors and noise
+	@pre	rows, cols and regions must be positive
+	@post	an image is returned whose regions each have one random color
+			with a little noise added to every pixel, the same seed always
+			gives the same image	*/
+Image syntheticImage(int rows, int cols, int regions, unsigned seed)
+{
+	int across = (int)std::sqrt((double)regions);
+	if (across < 1)
+		across = 1;
+	int down = (regions + across - 1) / across;
+
+	std::vector<pixel> colors((size_t)across * down);
+	unsigned state = seed;
+	for (pixel& color : colors)
+	{
+		unsigned value = nextRandom(state);
+		color.red = (byte)value;
+		color.green = (byte)(value >> 8);
+		color.blue = (byte)(value >> 16);
+	}
+
+	Image img(rows, cols);
+	for (int row = 0; row < rows; row++)
+	{
+		pixel* line = img.getRow(row);
+		const pixel* band = &colors[(size_t)((long long)row * down / rows) * across];
+		for (int col = 0; col < cols; col++)
+		{
+			const pixel& color = band[(long long)col * across / cols];
+			unsigned noise = nextRandom(state);
+			// +-3 per channel, clamped so flat regions stay flat
+			int red = color.red + (int)(noise & 7) - 3;
+			int green = color.green + (int)((noise >> 3) & 7) - 3;
+			int blue = color.blue + (int)((noise >> 6) & 7) - 3;
+			line[col].red = (byte)(red < 0 ? 0 : red > 255 ? 255 : red);
+			line[col].green = (byte)(green < 0 ? 0 : green > 255 ? 255 : green);
+			line[col].blue = (byte)(blue < 0 ? 0 : blue > 255 ? 255 : blue);
+		}
+	}
+	return img;
+}
+
+/*	times one case of the suite
+	@param	case to fill in, name and image size must be set
+	@param	number of times to run the case
+	@param	work to time, returns the segments found or -1
+	@param	stream to write progress to
+	@pre	runs must be positive
+	@post	the fastest run, the allocations of the first run and the peak
+			resident set size over all runs are recorded in result	*/
+template <class Work>
+static void measure(BenchmarkCase& result, int runs, Work work, std::ostream& log)
+{
+	resetPeakResident();
+	result.runs = runs;
+	for (int i = 0; i < runs; i++)
+	{
+		AllocationCount before = allocationCount();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		result.segments = work();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		AllocationCount after = allocationCount();
+		if (i == 0)
+		{
+			result.ms = elapsed.count();
+			result.allocations = after.count - before.count;
+			result.allocatedBytes = after.bytes - before.bytes;
+		}
+		else if (elapsed.count() < result.ms)
+			result.ms = elapsed.count();
+	}
+	result.peakResident = peakResidentBytes();
+
+	double pixels = (double)result.rows * result.cols;
+	log << std::left << std::setw(24) << result.name << std::right << std::setw(5) << result.megapixels << " MP"
+		<< std::setw(7) << result.regions << " regions" << std::fixed << std::setprecision(2) << std::setw(12)
+		<< result.ms * 1e6 / pixels << " ns/pixel" << std::setw(12) << result.allocations << " allocations"
+		<< std::setw(8) << result.peakResident / (1024 * 1024) << " MB peak" << std::defaultfloat << std::endl;
+}
+
+/*	times the Image and Container operations on one image
+	@param	image to run on
+	@param	case with the image size filled in
+	@param	number of times to run each case
+	@param	results to append to
+	@param	stream to write progress to
+	@pre	runs must be positive
+	@post	a result for each operation is appended to results	*/
+static void benchmarkOperations(const Image& img, const BenchmarkCase& size, int runs,
+	std::vector<BenchmarkCase>& results, std::ostream& log)
+{
+	int rows = img.getRows();
+	int cols = img.getCols();
+	const std::string red = "red";
+	const std::string green = "green";
+	BenchmarkCase result = size;
+
+	result.name = "image_construct";
+	measure(result, runs, [&]() { Image blank(rows, cols); sink = blank.getRows(); return -1LL; }, log);
+	results.push_back(result);
+
+	result.name = "image_copy";
+	measure(result, runs, [&]() { Image copy(img); sink = copy.getRows(); return -1LL; }, log);
+	results.push_back(result);
+
+	result.name = "get_pixel_color";
+	measure(result, runs, [&]()
+	{
+		long long sum = 0;
+		for (int row = 0; row < rows; row++)
+		{
+			for (int col = 0; col < cols; col++)
+				sum += img.getPixelColor(row, col, red);
+		}
+		sink = sum;
+		return -1LL;
+	}, log);
+	results.push_back(result);
+
+	Image target(img);
+	result.name = "set_pixel_color";
+	measure(result, runs, [&]()
+	{
+		for (int row = 0; row < rows; row++)
+		{
+			for (int col = 0; col < cols; col++)
+				target.setPixelColor(row, col, green, row + col);
+		}
+		return -1LL;
+	}, log);
+	results.push_back(result);
+
+	result.name = "mirror";
+	measure(result, runs, [&]() { Image mirrored = target.mirror(); sink = mirrored.getRows(); return -1LL; }, log);
+	results.push_back(result);
+
+	result.name = "mirror_in_place";
+	measure(result, runs, [&]() { target.mirrorInPlace(); return -1LL; }, log);
+	results.push_back(result);
+
+	// the other transforms, to compare with mirror
+	result.name = "flip_vertical_in_place";
+	measure(result, runs, [&]() { transformInPlace(target, Transform::FlipVertical); return -1LL; }, log);
+	results.push_back(result);
+
+	result.name = "rotate_180_in_place";
+	measure(result, runs, [&]() { transformInPlace(target, Transform::Rotate180); return -1LL; }, log);
+	results.push_back(result);
+
+	result.name = "transpose";
+	measure(result, runs, [&]() { Image turned = transformImage(target, Transform::Transpose); sink = turned.getRows(); return -1LL; }, log);
+	results.push_back(result);
+
+	result.name = "rotate_90";
+	measure(result, runs, [&]() { Image turned = transformImage(target, Transform::Rotate90); sink = turned.getRows(); return -1LL; }, log);
+	results.push_back(result);
+
+	result.name = "rotate_90_parallel";
+	measure(result, runs, [&]() { Image turned = transformImage(target, Transform::Rotate90, 0); sink = turned.getRows(); return -1LL; }, log);
+	results.push_back(result);
+
+	target = img;
+	result.name = "equals";
+	measure(result, runs, [&]() { sink = target == img; return -1LL; }, log);
+	results.push_back(result);
+	target = Image(0, 0);
+
+	result.name = "container_add";
+	measure(result, runs, [&]()
+	{
+		Container c;
+		for (int row = 0; row < rows; row++)
+		{
+			const pixel* line = img.getRow(row);
+			for (int col = 0; col < cols; col++)
+				c.addPixel({ line[col].red, line[col].green, line[col].blue, row, col });
+		}
+		sink = c.getSize();
+		return -1LL;
+	}, log);
+	results.push_back(result);
+
+	// the remaining cases work on containers holding every pixel
+	Container top;
+	Container bottom;
+	for (int row = 0; row < rows; row++)
+	{
+		const pixel* line = img.getRow(row);
+		for (int col = 0; col < cols; col++)
+		{
+			PixelData p = { line[col].red, line[col].green, line[col].blue, row, col };
+			(row < rows / 2 ? top : bottom).addPixel(p);
+		}
+	}
+
+	result.name = "container_iterate";
+	measure(result, runs, [&]()
+	{
+		long long sum = 0;
+		for (const PixelData& p : top)
+			sum += p.red;
+		for (const PixelData& p : bottom)
+			sum += p.red;
+		sink = sum;
+		return -1LL;
+	}, log);
+	results.push_back(result);
+
+	result.name = "container_merge_copy";
+	measure(result, runs, [&]() { Container c; c.merge(top); c.merge(bottom); sink = c.getSize(); return -1LL; }, log);
+	results.push_back(result);
+
+	// splicing consumes bottom, so it is run once
+	result.name = "container_merge_splice";
+	measure(result, 1, [&]()
+	{
+		top.merge(static_cast<Container&&>(bottom));
+		sink = top.getSize();
+		return -1LL;
+	}, log);
+	results.push_back(result);
+}
+
+/*	times every segmentation mode on one image
+	@param	image to segment
+	@param	case with the image size and region count filled in
+	@param	segmentation options, the mode is replaced by each mode in turn
+	@param	number of times to run each case
+	@param	results to append to
+	@param	stream to write progress to
+	@pre	runs must be positive
+	@post	a result for each mode is appended to results	*/
+static void benchmarkSegmentation(const Image& img, const BenchmarkCase& size, const SegmentOptions& options,
+	int runs, std::vector<BenchmarkCase>& results, std::ostream& log)
+{
+	struct Mode
+	{
+		const char* name;
+		bool unionFind;
+		Reference reference;
+		bool merge;
+		int pyramidLevels;
+		bool runs;
+	};
+	const Mode modes[] = {
+		{ "segment_flood_fill", false, Reference::Seed, false, 0, false },
+		{ "segment_flood_fill_mean", false, Reference::Mean, false, 0, false },
+		{ "segment_flood_fill_merge", false, Reference::Seed, true, 0, false },
+		{ "segment_union_find", true, Reference::Seed, false, 0, false },
+		{ "segment_union_find_pyramid", true, Reference::Seed, false, PYRAMID_LEVELS, false },
+		{ "segment_union_find_runs", true, Reference::Seed, false, 0, true }
+	};
+
+	for (const Mode& mode : modes)
+	{
+		SegmentOptions run = options;
+		run.unionFind = mode.unionFind;
+		run.reference = mode.reference;
+		if (mode.merge)
+			run.minRegion = MERGE_MIN_REGION;
+		run.pyramidLevels = mode.pyramidLevels;
+		run.runs = mode.runs;
+		run.verbose = false;
+		BenchmarkCase result = size;
+		result.name = mode.name;
+		measure(result, runs, [&]()
+		{
+			Image out(img.getRows(), img.getCols());
+			std::vector<SegmentStats> stats;
+			segmentImage(img, out, run, stats);
+			return (long long)stats.size();
+		}, log);
+		results.push_back(result);
+	}
+}
+
+/*	writes the results of the suite as JSON
+	@param	results of every case
+	@param	segmentation options the suite ran with
+	@param	stream to write to
+	@pre	none
+	@post	one object holding the settings and a results array is written	*/
+static void writeJson(const std::vector<BenchmarkCase>& results, const SegmentOptions& options, std::ostream& json)
+{
+	json << "{" << std::endl;
+	json << "  \"kernel\": \"" << colorKernelName() << "\"," << std::endl;
+	json << "  \"metric\": \"" << metricName(options.similarity.metric) << "\"," << std::endl;
+	json << "  \"threshold\": " << options.similarity.threshold << "," << std::endl;
+	json << "  \"threads\": " << options.threads << "," << std::endl;
+	json << "  \"results\": [" << std::endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkCase& r = results[i];
+		double pixels = (double)r.rows * r.cols;
+		json << "    { \"name\": \"" << r.name << "\", \"megapixels\": " << r.megapixels
+			<< ", \"rows\": " << r.rows << ", \"cols\": " << r.cols << ", \"regions\": " << r.regions
+			<< ", \"runs\": " << r.runs << std::fixed << std::setprecision(3) << ", \"ms\": " << r.ms
+			<< ", \"nsPerPixel\": " << r.ms * 1e6 / pixels << std::defaultfloat
+			<< ", \"allocations\": " << r.allocations << ", \"allocatedBytes\": " << r.allocatedBytes
+			<< ", \"peakRssBytes\": " << r.peakResident;
+		if (r.segments >= 0)
+			json << ", \"segments\": " << r.segments;
+		json << " }" << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	json << "  ]" << std::endl;
+	json << "}" << std::endl;
+}
+
+/*	runs the benchmark suite
+	@param	image sizes to run, in megapixels
+	@param	segmentation options, the mode is replaced by each mode in turn
+	@param	stream to write the JSON results to
+	@param	stream to write progress to
+	@pre	every size must be positive
+	@post	every case is timed on a square synthetic image of each size
+			(Image and Container operations once per size, segmentation once
+			per region count) and the results are written to json as one
+			object with a results array. Cases on images under 10 megapixels
+			report the fastest of 3 runs, larger ones a single run	*/
+void benchmarkSuite(const std::vector<int>& megapixels, const SegmentOptions& options, std::ostream& json, std::ostream& log)
+{
+	std::vector<BenchmarkCase> results;
+	for (int mp : megapixels)
+	{
+		BenchmarkCase size;
+		size.megapixels = mp;
+		size.rows = size.cols = (int)std::lround(std::sqrt(mp * 1e6));
+		size.regions = 0;
+		size.segments = -1;
+		int runs = mp < 10 ? 3 : 1;
+		double pixels = (double)size.rows * size.cols;
+
+		{
+			Image img = syntheticImage(size.rows, size.cols, OPERATION_REGIONS, 1);
+			benchmarkOperations(img, size, runs, results, log);
+		}
+		for (int regions : REGION_COUNTS)
+		{
+			if (pixels / regions < MIN_REGION_PIXELS)
+				continue;
+			size.regions = regions;
+			Image img = syntheticImage(size.rows, size.cols, regions, (unsigned)regions);
+			benchmarkSegmentation(img, size, options, runs, results, log);
+		}
+	}
+	writeJson(results, options, json);
+}
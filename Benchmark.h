@@ -0,0 +1,51 @@
+/*	Benchmark.h
+	Jayden Fullerton
+
+	This file contains the benchmarks of the segmentation modes. An image is
+	segmented several times with each configuration and the fastest run is
+	reported as milliseconds per image, nanoseconds per pixel and megapixels
+	per second. The benchmark suite times the Image and Container operations
+	and every segmentation mode on synthetic images of several sizes and
+	region counts, and reports the allocations and peak memory of each case
+	as JSON so results can be compared between builds.	*/
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include "Image.h"
+#include "Pipeline.h"
+
+/*	times segmenting an image with every color metric
+	@param	image to segment
+	@param	segmentation options, the metric is replaced by each metric in turn
+			and the threshold is used for all of them
+	@param	number of times to segment with each metric
+	@param	stream to write the results to
+	@pre	repeats must be positive
+	@post	a table with the segments found and the throughput of each metric
+			is written to out	*/
+void benchmarkMetrics(const Image& in, const SegmentOptions& options, int repeats, std::ostream& out);
+
+/*	makes a synthetic image of flat colored regions
+	@param	number of rows
+	@param	number of columns
+	@param	number of regions, laid out as a grid of rectangles
+	@param	seed of the colors and noise
+	@pre	rows, cols and regions must be positive
+	@post	an image is returned whose regions each have one random color
+			with a little noise added to every pixel, the same seed always
+			gives the same image	*/
+Image syntheticImage(int rows, int cols, int regions, unsigned seed);
+
+/*	runs the benchmark suite
+	@param	image sizes to run, in megapixels
+	@param	segmentation options, the mode is replaced by each mode in turn
+	@param	stream to write the JSON results to
+	@param	stream to write progress to
+	@pre	every size must be positive
+	@post	every case is timed on a square synthetic image of each size
+			(Image and Container operations once per size, segmentation once
+			per region count) and the results are written to json as one
+			object with a results array. Cases on images under 10 megapixels
+			report the fastest of 3 runs, larger ones a single run	*/
+void benchmarkSuite(const std::vector<int>& megapixels, const SegmentOptions& options, std::ostream& json, std::ostream& log);
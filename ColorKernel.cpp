@@ -0,0 +1,963 @@
+/*	ColorKernel.cpp
+	Jayden Fullerton
+
+	This file contains the color distance kernels behind the L1 similarity
+	test. Instead of testing one pixel at a time, a kernel tests a whole span
+	of pixels against a seed color, or two spans against each other, and
+	returns a bitmask with one bit per pixel that passed. The fastest kernel
+	the processor supports (AVX2, SSSE3 or plain C++) is picked the first
+	time one is used. A second kernel of the same kind sums and maximizes
+	the channel differences of two spans for image diffs, a third reverses
+	the order of a span of pixels for flips and rotations, a fourth sums the
+	channels of a span for segment statistics, and the last two halve rows
+	for image pyramids.
+
+	Pixels are stored as packed 3 byte triples, so the vector kernels take
+	the byte-wise absolute difference of 48 bytes (16 pixels) at a time and
+	then gather the red, green and blue differences into their own registers
+	with byte shuffles before summing them in 16 bits.	*/
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include "ColorKernel.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define COLOR_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit vector instructions in functions marked for them,
+// MSVC emits whatever intrinsics are used
+#if defined(COLOR_KERNEL_X86) && defined(__GNUC__)
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KERNEL_TARGET(isa)
+#endif
+
+// The per-step helpers must be inlined, a call that passes vector registers
+// is slower than the step itself
+#ifdef _MSC_VER
+#define KERNEL_INLINE __forceinline
+#else
+#define KERNEL_INLINE inline __attribute__((always_inline))
+#endif
+
+static_assert(sizeof(pixel) == 3, "kernels assume pixels are packed 3 byte triples");
+
+// Distances are summed in 16 bits and can be at most 3 * 255
+static const int MAX_THRESHOLD = 3 * 255 + 1;
+
+typedef void (*MaskKernel)(const uint8_t* a, const uint8_t* b, int bStep, int count, int threshold, uint64_t* mask);
+typedef void (*ErrorKernel)(const uint8_t* a, const uint8_t* b, int bytes, long long& sum, int& largest);
+
+// Steps of 16 pixels whose squares fit in 32 bit lanes: a lane adds four
+// squares of at most 255 * 255 a step
+static const int SUM_STEPS = 16384;
+
+/*	clamps a threshold to the range the kernels compare in
+	@pre	none
+	@post	a threshold with the same result for every pair of pixels is returned	*/
+static int clampThreshold(int threshold)
+{
+	if (threshold < 0)
+		return 0;
+	return threshold > MAX_THRESHOLD ? MAX_THRESHOLD : threshold;
+}
+
+/*	L1 distance between two pixels stored as byte triples
+	@pre	none
+	@post	|dr| + |dg| + |db| is returned	*/
+static KERNEL_INLINE int distance(const uint8_t* a, const uint8_t* b)
+{
+	int dr = a[0] - b[0];
+	int dg = a[1] - b[1];
+	int db = a[2] - b[2];
+	return (dr < 0 ? -dr : dr) + (dg < 0 ? -dg : dg) + (db < 0 ? -db : db);
+}
+
+/*	scalar kernel, also used for the pixels left over by the vector kernels
+	@param	first pixel of a as bytes
+	@param	first pixel of b as bytes
+	@param	bytes b advances per pixel, 0 to compare every pixel with b[0..2]
+	@param	first pixel to test
+	@param	one past the last pixel to test
+	@param	threshold the distance must be below
+	@param	mask to set bits in
+	@pre	the bits of first..last-1 must be clear
+	@post	the bit of every pixel in first..last-1 that passed is set	*/
+static void scalarRange(const uint8_t* a, const uint8_t* b, int bStep, int first, int last, int threshold,
+	uint64_t* mask)
+{
+	for (int i = first; i < last; i++)
+	{
+		if (distance(a + 3 * i, b + bStep * i) < threshold)
+			mask[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+}
+
+static void scalarKernel(const uint8_t* a, const uint8_t* b, int bStep, int count, int threshold, uint64_t* mask)
+{
+	scalarRange(a, b, bStep, 0, count, threshold, mask);
+}
+
+/*	scalar error kernel, also used for the bytes left over by the vector ones
+	@param	first byte of a
+	@param	first byte of b
+	@param	number of bytes to compare
+	@param	sum to add the absolute differences to
+	@param	largest absolute difference so far
+	@pre	none
+	@post	sum and largest include every byte	*/
+static void scalarError(const uint8_t* a, const uint8_t* b, int bytes, long long& sum, int& largest)
+{
+	for (int i = 0; i < bytes; i++)
+	{
+		int d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+		sum += d;
+		if (d > largest)
+			largest = d;
+	}
+}
+
+/*	rounded average of two bytes, as the vector average instructions round
+	@pre	none
+	@post	(a + b + 1) / 2 is returned	*/
+static KERNEL_INLINE uint8_t average(uint8_t a, uint8_t b)
+{
+	return (uint8_t)((a + b + 1) >> 1);
+}
+
+/*	combines one channel of neighbouring pixels
+	@param	channel above (Gaussian only)
+	@param	channel of the pixel
+	@param	channel below, or right of, the pixel
+	@param	how the channels are combined
+	@pre	none
+	@post	the combined channel is returned	*/
+static KERNEL_INLINE uint8_t reduce(uint8_t above, uint8_t value, uint8_t below, Reduction reduction)
+{
+	switch (reduction)
+	{
+	case Reduction::Min:
+		return value < below ? value : below;
+	case Reduction::Max:
+		return value > below ? value : below;
+	case Reduction::Box:
+		return average(value, below);
+	default:
+		// (above + 2 * value + below) / 4, rounded as two averages
+		return average(value, average(above, below));
+	}
+}
+
+/*	scalar row combination, also used for the bytes left over by the vector one
+	@param	first byte of the row above (Gaussian only)
+	@param	first byte of the row
+	@param	first byte of the row below
+	@param	number of bytes
+	@param	how the rows are combined
+	@param	first byte to write
+	@pre	none
+	@post	every byte of out combines the bytes of the rows	*/
+static void scalarCombineRows(const uint8_t* above, const uint8_t* row, const uint8_t* below, int bytes,
+	Reduction reduction, uint8_t* out)
+{
+	for (int i = 0; i < bytes; i++)
+		out[i] = reduce(above[i], row[i], below[i], reduction);
+}
+
+/*	scalar row halving, also used for the pixels left over by the vector one
+	@param	row to halve
+	@param	number of pixels in the row
+	@param	first output pixel to write
+	@param	how neighbouring pixels are combined
+	@param	row to write, (count + 1) / 2 pixels
+	@pre	none
+	@post	out[first] onward combine in[2 * j] with its neighbours	*/
+static void scalarHalveRow(const pixel* in, int count, int first, Reduction reduction, pixel* out)
+{
+	for (int j = first; j < (count + 1) / 2; j++)
+	{
+		const uint8_t* left = (const uint8_t*)(in + (j > 0 ? 2 * j - 1 : 0));
+		const uint8_t* centre = (const uint8_t*)(in + 2 * j);
+		const uint8_t* right = (const uint8_t*)(in + (2 * j + 1 < count ? 2 * j + 1 : 2 * j));
+		uint8_t* to = (uint8_t*)(out + j);
+		for (int c = 0; c < 3; c++)
+			to[c] = reduce(left[c], centre[c], right[c], reduction);
+	}
+}
+
+/*	scalar reversal, also used for the pixels left over by the vector one
+	@param	first pixel to reverse
+	@param	number of pixels
+	@param	where the reversed pixels go
+	@pre	in and out must not overlap
+	@post	out[i] is in[count - 1 - i]	*/
+static void scalarReverse(const pixel* in, int count, pixel* out)
+{
+	for (int i = 0; i < count; i++)
+		out[count - 1 - i] = in[i];
+}
+
+/*	scalar reversal in place
+	@param	first pixel to reverse
+	@param	number of pixels
+	@pre	none
+	@post	the order of the pixels is reversed	*/
+static void scalarReverseInPlace(pixel* pixels, int count)
+{
+	for (int i = 0, j = count - 1; i < j; i++, j--)
+		std::swap(pixels[i], pixels[j]);
+}
+
+/*	scalar channel sums
+	@param	first pixel to sum
+	@param	number of pixels
+	@param	red, green and blue sums to add to
+	@param	red, green and blue sums of squares to add to
+	@pre	none
+	@post	sums and squares include every pixel	*/
+static void scalarSums(const pixel* pixels, int count, long long sums[3], long long squares[3])
+{
+	for (int i = 0; i < count; i++)
+	{
+		const pixel& p = pixels[i];
+		sums[0] += p.red;
+		sums[1] += p.green;
+		sums[2] += p.blue;
+		squares[0] += p.red * p.red;
+		squares[1] += p.green * p.green;
+		squares[2] += p.blue * p.blue;
+	}
+}
+
+#ifdef COLOR_KERNEL_X86
+/*	gathers one channel of 16 pixels held in three registers
+	@param	bytes 0..15, 16..31 and 32..47 of the pixels
+	@param	shuffles that move the channel's bytes of each register into place
+	@pre	none
+	@post	byte i of the result is the channel of pixel i	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE __m128i gather(__m128i v0, __m128i v1, __m128i v2, __m128i s0, __m128i s1, __m128i s2)
+{
+	return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, s0), _mm_shuffle_epi8(v1, s1)),
+		_mm_shuffle_epi8(v2, s2));
+}
+
+/*	byte-wise absolute difference
+	@pre	none
+	@post	|a - b| of every unsigned byte is returned	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE __m128i absDiff(__m128i a, __m128i b)
+{
+	return _mm_sub_epi8(_mm_max_epu8(a, b), _mm_min_epu8(a, b));
+}
+
+/*	splits the absolute differences of 16 pixels into channels
+	@param	differences of bytes 0..15, 16..31 and 32..47
+	@param	red, green and blue differences, one byte per pixel
+	@pre	none
+	@post	red, green and blue hold the channel differences	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE void splitChannels(__m128i d0, __m128i d1, __m128i d2, __m128i& red, __m128i& green, __m128i& blue)
+{
+	red = gather(d0, d1, d2,
+		_mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		_mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1),
+		_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13));
+	green = gather(d0, d1, d2,
+		_mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		_mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1),
+		_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14));
+	blue = gather(d0, d1, d2,
+		_mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		_mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1),
+		_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15));
+}
+
+/*	repeats a seed color across three registers
+	@param	seed color as bytes
+	@param	registers to fill, byte j of pattern k is channel (16k + j) % 3
+	@pre	none
+	@post	the registers hold 48 bytes of 16 copies of the seed	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE void seedPattern(const uint8_t* seed, __m128i pattern[3])
+{
+	__m128i color = _mm_cvtsi32_si128(seed[0] | seed[1] << 8 | seed[2] << 16);
+	pattern[0] = _mm_shuffle_epi8(color, _mm_setr_epi8(0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0));
+	pattern[1] = _mm_shuffle_epi8(color, _mm_setr_epi8(1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1));
+	pattern[2] = _mm_shuffle_epi8(color, _mm_setr_epi8(2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2));
+}
+
+/*	tests 16 pixels with SSSE3
+	@param	48 bytes of the first span
+	@param	48 bytes of the second span, unused when comparing with a seed
+	@param	seed copies, used when y is nullptr
+	@param	threshold in every 16 bit lane
+	@pre	none
+	@post	bit i of the result is set if pixel i passed	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE uint32_t ssse3Step(const uint8_t* x, const uint8_t* y, const __m128i pattern[3], __m128i limit)
+{
+	__m128i d[3];
+	for (int k = 0; k < 3; k++)
+		d[k] = absDiff(_mm_loadu_si128((const __m128i*)(x + 16 * k)),
+			y == nullptr ? pattern[k] : _mm_loadu_si128((const __m128i*)(y + 16 * k)));
+	__m128i red, green, blue;
+	splitChannels(d[0], d[1], d[2], red, green, blue);
+
+	const __m128i zero = _mm_setzero_si128();
+	__m128i low = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(red, zero), _mm_unpacklo_epi8(green, zero)),
+		_mm_unpacklo_epi8(blue, zero));
+	__m128i high = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(red, zero), _mm_unpackhi_epi8(green, zero)),
+		_mm_unpackhi_epi8(blue, zero));
+	__m128i pass = _mm_packs_epi16(_mm_cmpgt_epi16(limit, low), _mm_cmpgt_epi16(limit, high));
+	return (uint16_t)_mm_movemask_epi8(pass);
+}
+
+/*	SSSE3 kernel, 16 pixels per step
+	@pre	see scalarKernel
+	@post	see scalarKernel	*/
+KERNEL_TARGET("ssse3")
+static void ssse3Kernel(const uint8_t* a, const uint8_t* b, int bStep, int count, int threshold, uint64_t* mask)
+{
+	// A seed is compared as 16 copies of itself held in registers
+	__m128i pattern[3];
+	if (bStep == 0)
+		seedPattern(b, pattern);
+
+	const __m128i limit = _mm_set1_epi16((short)threshold);
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+		mask[i >> 6] |= (uint64_t)ssse3Step(a + 3 * i, bStep == 0 ? nullptr : b + 3 * i, pattern, limit) << (i & 63);
+
+	// The last few pixels are copied out so they take one more step instead
+	// of up to 15 scalar tests
+	if (i < count)
+	{
+		uint8_t x[48] = {}, y[48] = {};
+		memcpy(x, a + 3 * i, 3 * (count - i));
+		if (bStep != 0)
+			memcpy(y, b + 3 * i, 3 * (count - i));
+		uint32_t bits = ssse3Step(x, bStep == 0 ? nullptr : y, pattern, limit);
+		mask[i >> 6] |= (uint64_t)(bits & ((1u << (count - i)) - 1)) << (i & 63);
+	}
+}
+
+/*	tests 32 pixels with AVX2
+	@param	96 bytes of the first span
+	@param	96 bytes of the second span, unused when comparing with a seed
+	@param	seed copies, used when y is nullptr
+	@param	threshold in every 16 bit lane
+	@pre	none
+	@post	bit i of the result is set if pixel i passed	*/
+KERNEL_TARGET("avx2")
+static KERNEL_INLINE uint32_t avx2Step(const uint8_t* x, const uint8_t* y, const __m256i pattern[3], __m256i limit)
+{
+	__m256i d[3];
+	for (int k = 0; k < 3; k++)
+	{
+		__m256i u = _mm256_loadu_si256((const __m256i*)(x + 32 * k));
+		__m256i v = y == nullptr ? pattern[k] : _mm256_loadu_si256((const __m256i*)(y + 32 * k));
+		d[k] = _mm256_sub_epi8(_mm256_max_epu8(u, v), _mm256_min_epu8(u, v));
+	}
+
+	// pixels 0..15 are in the first 48 bytes, 16..31 in the last 48
+	__m128i red0, green0, blue0, red1, green1, blue1;
+	splitChannels(_mm256_castsi256_si128(d[0]), _mm256_extracti128_si256(d[0], 1),
+		_mm256_castsi256_si128(d[1]), red0, green0, blue0);
+	splitChannels(_mm256_extracti128_si256(d[1], 1), _mm256_castsi256_si128(d[2]),
+		_mm256_extracti128_si256(d[2], 1), red1, green1, blue1);
+
+	__m256i sum0 = _mm256_add_epi16(_mm256_add_epi16(_mm256_cvtepu8_epi16(red0), _mm256_cvtepu8_epi16(green0)),
+		_mm256_cvtepu8_epi16(blue0));
+	__m256i sum1 = _mm256_add_epi16(_mm256_add_epi16(_mm256_cvtepu8_epi16(red1), _mm256_cvtepu8_epi16(green1)),
+		_mm256_cvtepu8_epi16(blue1));
+	// packing works within 128 bit lanes, so the quarters are put back in order
+	__m256i pass = _mm256_packs_epi16(_mm256_cmpgt_epi16(limit, sum0), _mm256_cmpgt_epi16(limit, sum1));
+	pass = _mm256_permute4x64_epi64(pass, 0xD8);
+	return (uint32_t)_mm256_movemask_epi8(pass);
+}
+
+/*	AVX2 kernel, 32 pixels per step
+	@pre	see scalarKernel
+	@post	see scalarKernel	*/
+KERNEL_TARGET("avx2")
+static void avx2Kernel(const uint8_t* a, const uint8_t* b, int bStep, int count, int threshold, uint64_t* mask)
+{
+	// 96 bytes of seed copies start at 16 byte blocks with phases 0,1,2,0,1,2
+	__m256i pattern[3];
+	if (bStep == 0)
+	{
+		__m128i half[3];
+		seedPattern(b, half);
+		pattern[0] = _mm256_set_m128i(half[1], half[0]);
+		pattern[1] = _mm256_set_m128i(half[0], half[2]);
+		pattern[2] = _mm256_set_m128i(half[2], half[1]);
+	}
+
+	const __m256i limit = _mm256_set1_epi16((short)threshold);
+	int i = 0;
+	for (; i + 32 <= count; i += 32)
+		mask[i >> 6] |= (uint64_t)avx2Step(a + 3 * i, bStep == 0 ? nullptr : b + 3 * i, pattern, limit) << (i & 63);
+
+	if (i < count)
+	{
+		uint8_t x[96] = {}, y[96] = {};
+		memcpy(x, a + 3 * i, 3 * (count - i));
+		if (bStep != 0)
+			memcpy(y, b + 3 * i, 3 * (count - i));
+		uint32_t bits = avx2Step(x, bStep == 0 ? nullptr : y, pattern, limit);
+		mask[i >> 6] |= (uint64_t)(bits & (uint32_t)(((uint64_t)1 << (count - i)) - 1)) << (i & 63);
+	}
+
+	// leaving the upper halves dirty slows down the SSE code of the caller
+	_mm256_zeroupper();
+}
+
+/*	SSE2 error kernel, 16 bytes per step. Channels are summed and maximized
+	together, so pixels need not line up with the steps
+	@pre	see scalarError
+	@post	see scalarError	*/
+KERNEL_TARGET("sse2")
+static void sse2Error(const uint8_t* a, const uint8_t* b, int bytes, long long& sum, int& largest)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i total = zero, top = zero;
+	int i = 0;
+	for (; i + 16 <= bytes; i += 16)
+	{
+		__m128i u = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i v = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i d = _mm_sub_epi8(_mm_max_epu8(u, v), _mm_min_epu8(u, v));
+		total = _mm_add_epi64(total, _mm_sad_epu8(d, zero));
+		top = _mm_max_epu8(top, d);
+	}
+
+	alignas(16) uint64_t sums[2];
+	alignas(16) uint8_t tops[16];
+	_mm_store_si128((__m128i*)sums, total);
+	_mm_store_si128((__m128i*)tops, top);
+	sum += (long long)(sums[0] + sums[1]);
+	for (int k = 0; k < 16; k++)
+	{
+		if (tops[k] > largest)
+			largest = tops[k];
+	}
+	scalarError(a + i, b + i, bytes - i, sum, largest);
+}
+
+/*	AVX2 error kernel, 32 bytes per step
+	@pre	see scalarError
+	@post	see scalarError	*/
+KERNEL_TARGET("avx2")
+static void avx2Error(const uint8_t* a, const uint8_t* b, int bytes, long long& sum, int& largest)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i total = zero, top = zero;
+	int i = 0;
+	for (; i + 32 <= bytes; i += 32)
+	{
+		__m256i u = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i v = _mm256_loadu_si256((const __m256i*)(b + i));
+		__m256i d = _mm256_sub_epi8(_mm256_max_epu8(u, v), _mm256_min_epu8(u, v));
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(d, zero));
+		top = _mm256_max_epu8(top, d);
+	}
+
+	alignas(32) uint64_t sums[4];
+	alignas(32) uint8_t tops[32];
+	_mm256_store_si256((__m256i*)sums, total);
+	_mm256_store_si256((__m256i*)tops, top);
+	_mm256_zeroupper();
+	sum += (long long)(sums[0] + sums[1] + sums[2] + sums[3]);
+	for (int k = 0; k < 32; k++)
+	{
+		if (tops[k] > largest)
+			largest = tops[k];
+	}
+	scalarError(a + i, b + i, bytes - i, sum, largest);
+}
+
+/*	reverses the order of 16 pixels held in three registers
+	@param	bytes 0..15, 16..31 and 32..47 of the pixels, replaced by those
+			of the reversed pixels
+	@pre	none
+	@post	pixel i of the registers is pixel 15 - i of what they held	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE void reverse16(__m128i& v0, __m128i& v1, __m128i& v2)
+{
+	// byte k of the result is byte 3 * (15 - k / 3) + k % 3 of the input
+	const __m128i none = _mm_set1_epi8(-1);
+	__m128i r0 = gather(v0, v1, v2, none,
+		_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 14),
+		_mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -1));
+	__m128i r1 = gather(v0, v1, v2,
+		_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1),
+		_mm_setr_epi8(15, -1, 11, 12, 13, 8, 9, 10, 5, 6, 7, 2, 3, 4, -1, 0),
+		_mm_setr_epi8(-1, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+	__m128i r2 = gather(v0, v1, v2,
+		_mm_setr_epi8(-1, 12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2),
+		_mm_setr_epi8(1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		none);
+	v0 = r0;
+	v1 = r1;
+	v2 = r2;
+}
+
+/*	SSSE3 reversal, 16 pixels per step
+	@pre	see scalarReverse
+	@post	see scalarReverse	*/
+KERNEL_TARGET("ssse3")
+static void ssse3Reverse(const pixel* in, int count, pixel* out)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i* from = (const __m128i*)(in + i);
+		__m128i v0 = _mm_loadu_si128(from);
+		__m128i v1 = _mm_loadu_si128(from + 1);
+		__m128i v2 = _mm_loadu_si128(from + 2);
+		reverse16(v0, v1, v2);
+		__m128i* to = (__m128i*)(out + count - i - 16);
+		_mm_storeu_si128(to, v0);
+		_mm_storeu_si128(to + 1, v1);
+		_mm_storeu_si128(to + 2, v2);
+	}
+	scalarReverse(in + i, count - i, out);
+}
+
+/*	SSSE3 reversal in place, swapping 16 pixels from each end per step
+	@pre	see scalarReverseInPlace
+	@post	see scalarReverseInPlace	*/
+KERNEL_TARGET("ssse3")
+static void ssse3ReverseInPlace(pixel* pixels, int count)
+{
+	int low = 0, high = count;
+	for (; high - low >= 32; low += 16, high -= 16)
+	{
+		__m128i* left = (__m128i*)(pixels + low);
+		__m128i* right = (__m128i*)(pixels + high - 16);
+		__m128i l0 = _mm_loadu_si128(left), l1 = _mm_loadu_si128(left + 1), l2 = _mm_loadu_si128(left + 2);
+		__m128i r0 = _mm_loadu_si128(right), r1 = _mm_loadu_si128(right + 1), r2 = _mm_loadu_si128(right + 2);
+		reverse16(l0, l1, l2);
+		reverse16(r0, r1, r2);
+		_mm_storeu_si128(left, r0);
+		_mm_storeu_si128(left + 1, r1);
+		_mm_storeu_si128(left + 2, r2);
+		_mm_storeu_si128(right, l0);
+		_mm_storeu_si128(right + 1, l1);
+		_mm_storeu_si128(right + 2, l2);
+	}
+	scalarReverseInPlace(pixels + low, high - low);
+}
+
+/*	SSSE3 channel sums, 16 pixels per step. Channels are split with byte
+	shuffles, summed with SAD and squared with 16 bit multiply-adds
+	@pre	see scalarSums
+	@post	see scalarSums	*/
+KERNEL_TARGET("ssse3")
+static void ssse3Sums(const pixel* pixels, int count, long long sums[3], long long squares[3])
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i* from = (const __m128i*)pixels;
+	int i = 0;
+	while (i + 16 <= count)
+	{
+		// squares are widened to 64 bits before the 32 bit lanes can overflow
+		int last = std::min(count, i + 16 * SUM_STEPS);
+		__m128i total[3] = { zero, zero, zero };
+		__m128i square[3] = { zero, zero, zero };
+		for (; i + 16 <= last; i += 16, from += 3)
+		{
+			__m128i channel[3];
+			splitChannels(_mm_loadu_si128(from), _mm_loadu_si128(from + 1), _mm_loadu_si128(from + 2),
+				channel[0], channel[1], channel[2]);
+			for (int c = 0; c < 3; c++)
+			{
+				__m128i low = _mm_unpacklo_epi8(channel[c], zero);
+				__m128i high = _mm_unpackhi_epi8(channel[c], zero);
+				total[c] = _mm_add_epi64(total[c], _mm_sad_epu8(channel[c], zero));
+				square[c] = _mm_add_epi32(square[c], _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high)));
+			}
+		}
+
+		alignas(16) uint64_t totals[2];
+		alignas(16) uint32_t squared[4];
+		for (int c = 0; c < 3; c++)
+		{
+			_mm_store_si128((__m128i*)totals, total[c]);
+			_mm_store_si128((__m128i*)squared, square[c]);
+			sums[c] += (long long)(totals[0] + totals[1]);
+			squares[c] += (long long)squared[0] + squared[1] + squared[2] + squared[3];
+		}
+	}
+	scalarSums(pixels + i, count - i, sums, squares);
+}
+
+/*	combines one channel of neighbouring pixels, 16 at a time
+	@pre	see reduce
+	@post	see reduce	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE __m128i reduce16(__m128i above, __m128i value, __m128i below, Reduction reduction)
+{
+	switch (reduction)
+	{
+	case Reduction::Min:
+		return _mm_min_epu8(value, below);
+	case Reduction::Max:
+		return _mm_max_epu8(value, below);
+	case Reduction::Box:
+		return _mm_avg_epu8(value, below);
+	default:
+		return _mm_avg_epu8(value, _mm_avg_epu8(above, below));
+	}
+}
+
+/*	interleaves the channels of 16 pixels back into packed triples
+	@param	red, green and blue, one byte per pixel
+	@param	bytes 0..15, 16..31 and 32..47 of the pixels
+	@pre	none
+	@post	d0, d1 and d2 hold the pixels, the inverse of splitChannels	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE void mergeChannels(__m128i red, __m128i green, __m128i blue, __m128i& d0, __m128i& d1, __m128i& d2)
+{
+	d0 = gather(red, green, blue,
+		_mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5),
+		_mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1),
+		_mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1));
+	d1 = gather(red, green, blue,
+		_mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1),
+		_mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10),
+		_mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1));
+	d2 = gather(red, green, blue,
+		_mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1),
+		_mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1),
+		_mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15));
+}
+
+/*	halves one channel of 32 pixels
+	@param	channel of pixels 0..15 and 16..31
+	@param	odd channel values of the previous 32 pixels, byte 15 is used
+	@param	how neighbouring pixels are combined
+	@pre	none
+	@post	byte j of the result combines pixel 2j with its neighbours,
+			carry holds the odd values for the next 32 pixels	*/
+KERNEL_TARGET("ssse3")
+static KERNEL_INLINE __m128i halve32(__m128i low, __m128i high, __m128i& carry, Reduction reduction)
+{
+	const __m128i evenBytes = _mm_set1_epi16(0x00ff);
+	__m128i even = _mm_packus_epi16(_mm_and_si128(low, evenBytes), _mm_and_si128(high, evenBytes));
+	__m128i odd = _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8));
+	// pixel 2j - 1 is odd value j - 1, carried over from the last step for j = 0
+	__m128i before = _mm_alignr_epi8(odd, carry, 15);
+	carry = odd;
+	return reduce16(before, even, odd, reduction);
+}
+
+/*	SSSE3 row combination, 16 bytes per step
+	@pre	see scalarCombineRows
+	@post	see scalarCombineRows	*/
+KERNEL_TARGET("ssse3")
+static void ssse3CombineRows(const uint8_t* above, const uint8_t* row, const uint8_t* below, int bytes,
+	Reduction reduction, uint8_t* out)
+{
+	int i = 0;
+	for (; i + 16 <= bytes; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(above + i));
+		__m128i v = _mm_loadu_si128((const __m128i*)(row + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(below + i));
+		_mm_storeu_si128((__m128i*)(out + i), reduce16(a, v, b, reduction));
+	}
+	scalarCombineRows(above + i, row + i, below + i, bytes - i, reduction, out + i);
+}
+
+/*	SSSE3 row halving, 32 pixels in and 16 out per step
+	@pre	see scalarHalveRow
+	@post	see scalarHalveRow	*/
+KERNEL_TARGET("ssse3")
+static void ssse3HalveRow(const pixel* in, int count, Reduction reduction, pixel* out)
+{
+	if (count < 32)
+	{
+		scalarHalveRow(in, count, 0, reduction, out);
+		return;
+	}
+
+	// pixel -1 is clamped to pixel 0
+	__m128i carry[3];
+	const uint8_t* first = (const uint8_t*)in;
+	for (int c = 0; c < 3; c++)
+		carry[c] = _mm_set1_epi8((char)first[c]);
+
+	int i = 0;
+	for (; i + 32 <= count; i += 32)
+	{
+		const __m128i* from = (const __m128i*)(in + i);
+		__m128i red[2], green[2], blue[2];
+		splitChannels(_mm_loadu_si128(from), _mm_loadu_si128(from + 1), _mm_loadu_si128(from + 2),
+			red[0], green[0], blue[0]);
+		splitChannels(_mm_loadu_si128(from + 3), _mm_loadu_si128(from + 4), _mm_loadu_si128(from + 5),
+			red[1], green[1], blue[1]);
+		__m128i r = halve32(red[0], red[1], carry[0], reduction);
+		__m128i g = halve32(green[0], green[1], carry[1], reduction);
+		__m128i b = halve32(blue[0], blue[1], carry[2], reduction);
+		__m128i d0, d1, d2;
+		mergeChannels(r, g, b, d0, d1, d2);
+		__m128i* to = (__m128i*)(out + i / 2);
+		_mm_storeu_si128(to, d0);
+		_mm_storeu_si128(to + 1, d1);
+		_mm_storeu_si128(to + 2, d2);
+	}
+	scalarHalveRow(in, count, i / 2, reduction, out);
+}
+
+/*	does the processor support a kernel
+	@param	"avx2" or "ssse3"
+	@pre	none
+	@post	true is returned if the kernel's instructions can be used	*/
+static bool supports(const std::string& isa)
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	if (isa == "ssse3")
+		return (info[2] & (1 << 9)) != 0;
+	// AVX2 also needs the operating system to save the 256 bit registers
+	bool osSaves = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osSaves && (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	if (isa == "ssse3")
+		return __builtin_cpu_supports("ssse3");
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+/*	returns the fastest kernel the processor supports
+	@pre	none
+	@post	the fastest supported kernel is returned	*/
+static MaskKernel fastestKernel()
+{
+#ifdef COLOR_KERNEL_X86
+	if (supports("avx2"))
+		return avx2Kernel;
+	if (supports("ssse3"))
+		return ssse3Kernel;
+#endif
+	return scalarKernel;
+}
+
+/*	returns the kernel in use
+	@pre	none
+	@post	reference to the selected kernel is returned, the fastest
+			supported kernel is selected the first time	*/
+static MaskKernel& kernel()
+{
+	// initialized once even if the first calls race on several threads
+	static MaskKernel selected = fastestKernel();
+	return selected;
+}
+
+/*	tests a span of pixels against a seed color
+	@param	first pixel of the span
+	@param	number of pixels in the span
+	@param	seed color
+	@param	threshold the L1 distance must be below
+	@param	mask to write, bit i of mask[i / 64] is pixel i
+	@pre	mask must hold maskWords(count) words
+	@post	a bit is set for every pixel whose L1 distance to seed is below
+			threshold, bits past count are clear	*/
+void seedDistanceMask(const pixel* pixels, int count, const pixel& seed, int threshold, uint64_t* mask)
+{
+	memset(mask, 0, maskWords(count) * sizeof(uint64_t));
+	kernel()((const uint8_t*)pixels, (const uint8_t*)&seed, 0, count, clampThreshold(threshold), mask);
+}
+
+/*	tests two spans of pixels against each other, pixel by pixel
+	@param	first pixel of the first span
+	@param	first pixel of the second span
+	@param	number of pixels in each span
+	@param	threshold the L1 distance must be below
+	@param	mask to write, bit i of mask[i / 64] is the pair a[i], b[i]
+	@pre	mask must hold maskWords(count) words
+	@post	a bit is set for every pair whose L1 distance is below threshold,
+			bits past count are clear	*/
+void pairDistanceMask(const pixel* a, const pixel* b, int count, int threshold, uint64_t* mask)
+{
+	memset(mask, 0, maskWords(count) * sizeof(uint64_t));
+	kernel()((const uint8_t*)a, (const uint8_t*)b, 3, count, clampThreshold(threshold), mask);
+}
+
+/*	measures the channel differences of two spans of pixels
+	@param	first pixel of the first span
+	@param	first pixel of the second span
+	@param	number of pixels in each span
+	@param	sum to add the absolute difference of every channel to
+	@param	largest absolute difference of one channel so far
+	@pre	none
+	@post	sum and largest include every channel of every pair	*/
+void channelError(const pixel* a, const pixel* b, int count, long long& sum, int& largest)
+{
+	// the error kernel follows the selected mask kernel, SSSE3 implies SSE2
+	ErrorKernel error = scalarError;
+#ifdef COLOR_KERNEL_X86
+	if (kernel() == avx2Kernel)
+		error = avx2Error;
+	else if (kernel() == ssse3Kernel)
+		error = sse2Error;
+#endif
+	error((const uint8_t*)a, (const uint8_t*)b, 3 * count, sum, largest);
+}
+
+/*	sums the channels of a span of pixels and their squares
+	@param	first pixel to sum
+	@param	number of pixels
+	@param	red, green and blue sums to add to
+	@param	red, green and blue sums of squares to add to
+	@pre	none
+	@post	sums and squares include every pixel	*/
+void channelSums(const pixel* pixels, int count, long long sums[3], long long squares[3])
+{
+	// the shuffles need SSSE3, which both vector kernels imply
+#ifdef COLOR_KERNEL_X86
+	if (kernel() != scalarKernel)
+	{
+		ssse3Sums(pixels, count, sums, squares);
+		return;
+	}
+#endif
+	scalarSums(pixels, count, sums, squares);
+}
+
+/*	reverses the order of a span of pixels
+	@param	first pixel to reverse
+	@param	number of pixels
+	@param	where the reversed pixels go
+	@pre	in and out must not overlap
+	@post	out[i] is in[count - 1 - i]	*/
+void reversePixels(const pixel* in, int count, pixel* out)
+{
+	// the shuffles need SSSE3, which both vector kernels imply
+#ifdef COLOR_KERNEL_X86
+	if (kernel() != scalarKernel)
+	{
+		ssse3Reverse(in, count, out);
+		return;
+	}
+#endif
+	scalarReverse(in, count, out);
+}
+
+/*	reverses the order of a span of pixels in place
+	@param	first pixel to reverse
+	@param	number of pixels
+	@pre	none
+	@post	the order of the pixels is reversed	*/
+void reversePixelsInPlace(pixel* pixels, int count)
+{
+#ifdef COLOR_KERNEL_X86
+	if (kernel() != scalarKernel)
+	{
+		ssse3ReverseInPlace(pixels, count);
+		return;
+	}
+#endif
+	scalarReverseInPlace(pixels, count);
+}
+
+/*	combines three rows of pixels channel by channel, the first step of
+	halving an image
+	@param	row above, only read by Gaussian
+	@param	row
+	@param	row below
+	@param	number of pixels in each row
+	@param	how the rows are combined
+	@param	row to write
+	@pre	out may be any of the rows or none of them
+	@post	every channel of out is reduction applied to the rows' channels:
+			Min, Max and Box combine row and below, Gaussian weights above,
+			row and below by 1, 2, 1	*/
+void combineRows(const pixel* above, const pixel* row, const pixel* below, int count, Reduction reduction, pixel* out)
+{
+#ifdef COLOR_KERNEL_X86
+	if (kernel() != scalarKernel)
+	{
+		ssse3CombineRows((const uint8_t*)above, (const uint8_t*)row, (const uint8_t*)below, 3 * count,
+			reduction, (uint8_t*)out);
+		return;
+	}
+#endif
+	scalarCombineRows((const uint8_t*)above, (const uint8_t*)row, (const uint8_t*)below, 3 * count,
+		reduction, (uint8_t*)out);
+}
+
+/*	halves a row of pixels, the second step of halving an image
+	@param	row to halve
+	@param	number of pixels in the row
+	@param	how neighbouring pixels are combined
+	@param	row to write, (count + 1) / 2 pixels
+	@pre	in and out must not overlap
+	@post	out[j] is reduction applied to in[2j] and in[2j + 1], or for
+			Gaussian to in[2j - 1], in[2j] and in[2j + 1] weighted 1, 2, 1;
+			pixels past either end are clamped to the end	*/
+void halveRow(const pixel* in, int count, Reduction reduction, pixel* out)
+{
+#ifdef COLOR_KERNEL_X86
+	if (kernel() != scalarKernel)
+	{
+		ssse3HalveRow(in, count, reduction, out);
+		return;
+	}
+#endif
+	scalarHalveRow(in, count, 0, reduction, out);
+}
+
+/*	returns the name of the kernel in use
+	@pre	none
+	@post	"avx2", "ssse3" or "scalar" is returned	*/
+const char* colorKernelName()
+{
+#ifdef COLOR_KERNEL_X86
+	if (kernel() == avx2Kernel)
+		return "avx2";
+	if (kernel() == ssse3Kernel)
+		return "ssse3";
+#endif
+	return "scalar";
+}
+
+/*	chooses the kernel to use
+	@param	"avx2", "ssse3", "scalar" or "auto" for the fastest supported
+	@pre	no kernel may be running on another thread
+	@post	the kernel is selected, false is returned if it is unknown or
+			not supported by this processor	*/
+bool selectColorKernel(const std::string& name)
+{
+	if (name == "auto")
+	{
+		kernel() = fastestKernel();
+		return true;
+	}
+	if (name == "scalar")
+	{
+		kernel() = scalarKernel;
+		return true;
+	}
+#ifdef COLOR_KERNEL_X86
+	if (name == "avx2" && supports("avx2"))
+	{
+		kernel() = avx2Kernel;
+		return true;
+	}
+	if (name == "ssse3" && supports("ssse3"))
+	{
+		kernel() = ssse3Kernel;
+		return true;
+	}
+#endif
+	return false;
+}
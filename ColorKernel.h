@@ -0,0 +1,185 @@
+/*	ColorKernel.h
+	Jayden Fullerton
+
+	This file contains the color distance kernels behind the L1 similarity
+	test. Instead of testing one pixel at a time, a kernel tests a whole span
+	of pixels against a seed color, or two spans against each other, and
+	returns a bitmask with one bit per pixel that passed. The fastest kernel
+	the processor supports (AVX2, SSSE3 or plain C++) is picked the first
+	time one is used. A second kernel of the same kind sums and maximizes
+	the channel differences of two spans for image diffs, a third reverses
+	the order of a span of pixels for flips and rotations, a fourth sums the
+	channels of a span for segment statistics, and the last two halve rows
+	for image pyramids.	*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "ImageLib.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// How neighbouring pixels are combined when an image is halved
+enum class Reduction
+{
+	Min,		// smallest value of every channel
+	Max,		// largest value of every channel
+	Box,		// mean of a 2 x 2 block
+	Gaussian	// 1 2 1 weighted mean of a 3 x 3 neighbourhood
+};
+
+/*	returns the number of 64 bit words a mask of count pixels needs
+	@param	number of pixels
+	@pre	count must be non-negative
+	@post	number of words is returned	*/
+inline int maskWords(int count)
+{
+	return (count + 63) / 64;
+}
+
+/*	returns the index of the lowest set bit
+	@param	word to scan
+	@pre	word must not be 0
+	@post	index of the lowest set bit is returned	*/
+inline int lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+/*	returns the index of the highest set bit
+	@param	word to scan
+	@pre	word must not be 0
+	@post	index of the highest set bit is returned	*/
+inline int highestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, word);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(word);
+#endif
+}
+
+/*	returns the number of set bits
+	@param	word to count
+	@pre	none
+	@post	number of set bits is returned	*/
+inline int countBits(uint64_t word)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(word);
+#else
+	return __builtin_popcountll(word);
+#endif
+}
+
+/*	returns the number of consecutive set bits starting at bit 0
+	@param	word to scan
+	@pre	none
+	@post	number of trailing ones is returned, 64 if every bit is set	*/
+inline int trailingOnes(uint64_t word)
+{
+	return ~word == 0 ? 64 : lowestBit(~word);
+}
+
+/*	tests a span of pixels against a seed color
+	@param	first pixel of the span
+	@param	number of pixels in the span
+	@param	seed color
+	@param	threshold the L1 distance must be below
+	@param	mask to write, bit i of mask[i / 64] is pixel i
+	@pre	mask must hold maskWords(count) words
+	@post	a bit is set for every pixel whose L1 distance to seed is below
+			threshold, bits past count are clear	*/
+void seedDistanceMask(const pixel* pixels, int count, const pixel& seed, int threshold, uint64_t* mask);
+
+/*	tests two spans of pixels against each other, pixel by pixel
+	@param	first pixel of the first span
+	@param	first pixel of the second span
+	@param	number of pixels in each span
+	@param	threshold the L1 distance must be below
+	@param	mask to write, bit i of mask[i / 64] is the pair a[i], b[i]
+	@pre	mask must hold maskWords(count) words
+	@post	a bit is set for every pair whose L1 distance is below threshold,
+			bits past count are clear	*/
+void pairDistanceMask(const pixel* a, const pixel* b, int count, int threshold, uint64_t* mask);
+
+/*	measures the channel differences of two spans of pixels
+	@param	first pixel of the first span
+	@param	first pixel of the second span
+	@param	number of pixels in each span
+	@param	sum to add the absolute difference of every channel to
+	@param	largest absolute difference of one channel so far
+	@pre	none
+	@post	sum and largest include every channel of every pair	*/
+void channelError(const pixel* a, const pixel* b, int count, long long& sum, int& largest);
+
+/*	sums the channels of a span of pixels and their squares
+	@param	first pixel to sum
+	@param	number of pixels
+	@param	red, green and blue sums to add to
+	@param	red, green and blue sums of squares to add to
+	@pre	none
+	@post	sums and squares include every pixel	*/
+void channelSums(const pixel* pixels, int count, long long sums[3], long long squares[3]);
+
+/*	reverses the order of a span of pixels
+	@param	first pixel to reverse
+	@param	number of pixels
+	@param	where the reversed pixels go
+	@pre	in and out must not overlap
+	@post	out[i] is in[count - 1 - i]	*/
+void reversePixels(const pixel* in, int count, pixel* out);
+
+/*	reverses the order of a span of pixels in place
+	@param	first pixel to reverse
+	@param	number of pixels
+	@pre	none
+	@post	the order of the pixels is reversed	*/
+void reversePixelsInPlace(pixel* pixels, int count);
+
+/*	combines three rows of pixels channel by channel, the first step of
+	halving an image
+	@param	row above, only read by Gaussian
+	@param	row
+	@param	row below
+	@param	number of pixels in each row
+	@param	how the rows are combined
+	@param	row to write
+	@pre	out may be any of the rows or none of them
+	@post	every channel of out is reduction applied to the rows' channels:
+			Min, Max and Box combine row and below, Gaussian weights above,
+			row and below by 1, 2, 1	*/
+void combineRows(const pixel* above, const pixel* row, const pixel* below, int count, Reduction reduction, pixel* out);
+
+/*	halves a row of pixels, the second step of halving an image
+	@param	row to halve
+	@param	number of pixels in the row
+	@param	how neighbouring pixels are combined
+	@param	row to write, (count + 1) / 2 pixels
+	@pre	in and out must not overlap
+	@post	out[j] is reduction applied to in[2j] and in[2j + 1], or for
+			Gaussian to in[2j - 1], in[2j] and in[2j + 1] weighted 1, 2, 1;
+			pixels past either end are clamped to the end	*/
+void halveRow(const pixel* in, int count, Reduction reduction, pixel* out);
+
+/*	returns the name of the kernel in use
+	@pre	none
+	@post	"avx2", "ssse3" or "scalar" is returned	*/
+const char* colorKernelName();
+
+/*	chooses the kernel to use
+	@param	"avx2", "ssse3", "scalar" or "auto" for the fastest supported
+	@pre	no kernel may be running on another thread
+	@post	the kernel is selected, false is returned if it is unknown or
+			not supported by this processor	*/
+bool selectColorKernel(const std::string& name);
@@ -0,0 +1,221 @@
+/*	ColorMetric.cpp
+	Jayden Fullerton
+
+	This file contains the color distance metrics the segmenters can use to
+	decide if two pixels are similar. Every metric is a small policy class
+	whose test is inlined into the segmenter's loops, the segmenters pick the
+	policy once per image (or region) from a Similarity, so choosing a metric
+	costs nothing per pixel. The Lab metric is measured on a copy of the image
+	converted to CIE Lab once up front, and the L1 metric uses the vectorized
+	kernels in ColorKernel to test whole spans at once.	*/
+#include <algorithm>
+#include <cmath>
+#include "ColorMetric.h"
+
+// Entries of the table of the Lab companding function over 0..1
+static const int CUBE_ROOT_STEPS = 4096;
+
+/*	Similarity constructor
+	@param	metric to measure distance with
+	@param	distance two similar pixels must be below
+	@pre	none
+	@post	weights are the luma weights 3, 6, 1	*/
+Similarity::Similarity(Metric metric, int threshold)
+{
+	this->metric = metric;
+	this->threshold = threshold;
+	weights[0] = 3;
+	weights[1] = 6;
+	weights[2] = 1;
+}
+
+/*	reads the name of a metric
+	@param	"l1", "l2", "chebyshev", "weighted" or "lab"
+	@param	metric to set
+	@pre	none
+	@post	metric is set and true is returned if the name is known	*/
+bool parseMetric(const std::string& name, Metric& metric)
+{
+	const Metric all[] = { Metric::L1, Metric::L2, Metric::Chebyshev, Metric::Weighted, Metric::Lab };
+	for (Metric m : all)
+	{
+		if (name == metricName(m))
+		{
+			metric = m;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*	returns the name of a metric
+	@pre	none
+	@post	the name parseMetric() reads is returned	*/
+const char* metricName(Metric metric)
+{
+	switch (metric)
+	{
+	case Metric::L2:
+		return "l2";
+	case Metric::Chebyshev:
+		return "chebyshev";
+	case Metric::Weighted:
+		return "weighted";
+	case Metric::Lab:
+		return "lab";
+	default:
+		return "l1";
+	}
+}
+
+/*	rounds and clamps a value to a byte
+	@pre	none
+	@post	the nearest value in 0..255 is returned	*/
+static byte toByte(double value)
+{
+	if (value <= 0)
+		return 0;
+	if (value >= 255)
+		return 255;
+	return (byte)(value + 0.5);
+}
+
+/*	LabTables struct
+
+	Linearizing sRGB and the cube root are the expensive steps of converting
+	to Lab, both are looked up in tables instead.	*/
+struct LabTables
+{
+	double linear[256];
+	double cubeRoot[CUBE_ROOT_STEPS + 1];
+
+	/*	LabTables constructor
+		@pre	none
+		@post	linear holds every sRGB byte linearized, cubeRoot holds the
+				Lab companding function over 0..1	*/
+	LabTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			double c = i / 255.0;
+			linear[i] = c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+		}
+		for (int i = 0; i <= CUBE_ROOT_STEPS; i++)
+		{
+			double t = (double)i / CUBE_ROOT_STEPS;
+			cubeRoot[i] = t > 216.0 / 24389.0 ? cbrt(t) : (24389.0 / 27.0 * t + 16) / 116;
+		}
+	}
+};
+
+/*	returns the Lab lookup tables
+	@pre	none
+	@post	the tables, built on first use, are returned	*/
+static const LabTables& labTables()
+{
+	// built once, even if the first conversions race on several threads
+	static const LabTables tables;
+	return tables;
+}
+
+/*	converts a color to CIE Lab
+	@param	lookup tables
+	@param	color to convert
+	@pre	none
+	@post	the Lab color of p (D65 white) is returned as L * 2, a + 128 and
+			b + 128 in the red, green and blue channels	*/
+static inline pixel toLab(const LabTables& tables, const pixel& p)
+{
+	const double* linear = tables.linear;
+	const double* cubeRoot = tables.cubeRoot;
+	double r = linear[p.red];
+	double g = linear[p.green];
+	double b = linear[p.blue];
+	// XYZ relative to the D65 white point, each at most about 1
+	double x = (0.4124 * r + 0.3576 * g + 0.1805 * b) / 0.95047;
+	double y = 0.2126 * r + 0.7152 * g + 0.0722 * b;
+	double z = (0.0193 * r + 0.1192 * g + 0.9505 * b) / 1.08883;
+	double fx = cubeRoot[(int)(std::min(x, 1.0) * CUBE_ROOT_STEPS + 0.5)];
+	double fy = cubeRoot[(int)(std::min(y, 1.0) * CUBE_ROOT_STEPS + 0.5)];
+	double fz = cubeRoot[(int)(std::min(z, 1.0) * CUBE_ROOT_STEPS + 0.5)];
+	pixel lab;
+	lab.red = toByte(2 * (116 * fy - 16));
+	lab.green = toByte(500 * (fx - fy) + 128);
+	lab.blue = toByte(200 * (fy - fz) + 128);
+	return lab;
+}
+
+/*	converts an image to CIE Lab
+	@param	image to convert
+	@param	image to write to, as L * 2, a + 128 and b + 128 in the red,
+			green and blue channels
+	@pre	out must have the same dimensions as in
+	@post	every pixel of out is the Lab color of in (D65 white)	*/
+void convertToLab(const Image& in, Image& out)
+{
+	const LabTables& tables = labTables();
+	for (int row = 0; row < in.getRows(); row++)
+	{
+		const pixel* source = in.getRow(row);
+		pixel* dest = out.getRow(row);
+		for (int col = 0; col < in.getCols(); col++)
+			dest[col] = toLab(tables, source[col]);
+	}
+}
+
+/*	returns the image a metric measures distances on
+	@param	image being segmented
+	@param	similarity in use
+	@param	image to convert into if the metric needs it
+	@pre	none
+	@post	in is returned, or converted holding in converted for the metric	*/
+const Image& comparisonImage(const Image& in, const Similarity& similarity, Image& converted)
+{
+	if (similarity.metric != Metric::Lab)
+		return in;
+	if (converted.getRows() != in.getRows() || converted.getCols() != in.getCols())
+		converted = Image(in.getRows(), in.getCols());
+	convertToLab(in, converted);
+	return converted;
+}
+
+/*	converts one color for a metric
+	@param	similarity in use
+	@param	color to convert
+	@pre	none
+	@post	p is returned as comparisonImage() would convert it	*/
+pixel comparisonColor(const Similarity& similarity, const pixel& p)
+{
+	return similarity.metric == Metric::Lab ? toLab(labTables(), p) : p;
+}
+
+/*	measures the distance between two colors
+	@param	metric, and weights of the weighted metric, to measure with
+	@param	first color, converted for the metric
+	@param	second color, converted for the metric
+	@pre	none
+	@post	the distance in the metric's own units is returned, two colors
+			are similar if it is below the threshold	*/
+double colorDistance(const Similarity& similarity, const pixel& a, const pixel& b)
+{
+	int dr = absolute(a.red - b.red);
+	int dg = absolute(a.green - b.green);
+	int db = absolute(a.blue - b.blue);
+	const int* weights = similarity.weights;
+	switch (similarity.metric)
+	{
+	case Metric::L2:
+		return sqrt((double)(dr * dr + dg * dg + db * db));
+	case Metric::Chebyshev:
+		return std::max(dr, std::max(dg, db));
+	case Metric::Weighted:
+		// scaled as WeightedPolicy scales it
+		return 3.0 * (weights[0] * dr + weights[1] * dg + weights[2] * db)
+			/ std::max(1, weights[0] + weights[1] + weights[2]);
+	case Metric::Lab:
+		// L is stored doubled
+		return sqrt(dr * dr + 4.0 * (dg * dg + db * db)) / 2;
+	default:
+		return dr + dg + db;
+	}
+}
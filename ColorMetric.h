@@ -0,0 +1,256 @@
+/*	ColorMetric.h
+	Jayden Fullerton
+
+	This file contains the color distance metrics the segmenters can use to
+	decide if two pixels are similar. Every metric is a small policy class
+	whose test is inlined into the segmenter's loops, the segmenters pick the
+	policy once per image (or region) from a Similarity, so choosing a metric
+	costs nothing per pixel. The Lab metric is measured on a copy of the image
+	converted to CIE Lab once up front, and the L1 metric uses the vectorized
+	kernels in ColorKernel to test whole spans at once.	*/
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "ColorKernel.h"
+#include "Image.h"
+
+// The metrics a segmenter can measure color distance with
+enum class Metric
+{
+	L1,			// |dr| + |dg| + |db|
+	L2,			// sqrt(dr^2 + dg^2 + db^2)
+	Chebyshev,	// max(|dr|, |dg|, |db|)
+	Weighted,	// per channel weighted L1
+	Lab			// Euclidean distance in CIE Lab (CIE76 delta E)
+};
+
+/*	Similarity struct
+
+	Selects the metric two pixels are compared with and the distance they
+	must be below to be similar. The threshold is in the metric's own units,
+	so a threshold of 30 means a Euclidean distance of 30 for L2 and a delta E
+	of 30 for Lab.	*/
+struct Similarity
+{
+	Metric metric;
+	int threshold;
+	int weights[3];	// red, green and blue weights of the Weighted metric
+
+	/*	Similarity constructor
+		@param	metric to measure distance with
+		@param	distance two similar pixels must be below
+		@pre	none
+		@post	weights are the luma weights 3, 6, 1	*/
+	Similarity(Metric metric = Metric::L1, int threshold = 100);
+};
+
+/*	reads the name of a metric
+	@param	"l1", "l2", "chebyshev", "weighted" or "lab"
+	@param	metric to set
+	@pre	none
+	@post	metric is set and true is returned if the name is known	*/
+bool parseMetric(const std::string& name, Metric& metric);
+
+/*	returns the name of a metric
+	@pre	none
+	@post	the name parseMetric() reads is returned	*/
+const char* metricName(Metric metric);
+
+/*	converts an image to CIE Lab
+	@param	image to convert
+	@param	image to write to, as L * 2, a + 128 and b + 128 in the red,
+			green and blue channels
+	@pre	out must have the same dimensions as in
+	@post	every pixel of out is the Lab color of in (D65 white)	*/
+void convertToLab(const Image& in, Image& out);
+
+/*	returns the image a metric measures distances on
+	@param	image being segmented
+	@param	similarity in use
+	@param	image to convert into if the metric needs it
+	@pre	none
+	@post	in is returned, or converted holding in converted for the metric	*/
+const Image& comparisonImage(const Image& in, const Similarity& similarity, Image& converted);
+
+/*	converts one color for a metric
+	@param	similarity in use
+	@param	color to convert
+	@pre	none
+	@post	p is returned as comparisonImage() would convert it	*/
+pixel comparisonColor(const Similarity& similarity, const pixel& p);
+
+/*	measures the distance between two colors
+	@param	metric, and weights of the weighted metric, to measure with
+	@param	first color, converted for the metric
+	@param	second color, converted for the metric
+	@pre	none
+	@post	the distance in the metric's own units is returned, two colors
+			are similar if it is below the threshold	*/
+double colorDistance(const Similarity& similarity, const pixel& a, const pixel& b);
+
+struct L1Policy
+{
+	int limit;
+	L1Policy(const Similarity& similarity);
+	bool operator()(const pixel& a, const pixel& b) const;
+};
+
+struct L2Policy
+{
+	int limit;	// threshold squared
+	L2Policy(const Similarity& similarity);
+	bool operator()(const pixel& a, const pixel& b) const;
+};
+
+struct ChebyshevPolicy
+{
+	int limit;
+	ChebyshevPolicy(const Similarity& similarity);
+	bool operator()(const pixel& a, const pixel& b) const;
+};
+
+struct WeightedPolicy
+{
+	int red, green, blue;
+	int limit;	// threshold times the sum of the weights, the distance is scaled by 3
+	WeightedPolicy(const Similarity& similarity);
+	bool operator()(const pixel& a, const pixel& b) const;
+};
+
+struct LabPolicy
+{
+	int limit;	// 4 * threshold squared, L is stored doubled
+	LabPolicy(const Similarity& similarity);
+	bool operator()(const pixel& a, const pixel& b) const;
+};
+
+/*	tests a span of pixels against a seed color with a metric
+	@param	metric policy
+	@param	first pixel of the span
+	@param	number of pixels in the span
+	@param	seed color
+	@param	mask to write, bit i of mask[i / 64] is pixel i
+	@pre	mask must hold maskWords(count) words
+	@post	a bit is set for every pixel similar to seed, bits past count are clear	*/
+template <class Policy>
+void seedMask(const Policy& policy, const pixel* pixels, int count, const pixel& seed, uint64_t* mask);
+void seedMask(const L1Policy& policy, const pixel* pixels, int count, const pixel& seed, uint64_t* mask);
+
+/*	tests two spans of pixels against each other with a metric
+	@param	metric policy
+	@param	first pixel of the first span
+	@param	first pixel of the second span
+	@param	number of pixels in each span
+	@param	mask to write, bit i of mask[i / 64] is the pair a[i], b[i]
+	@pre	mask must hold maskWords(count) words
+	@post	a bit is set for every similar pair, bits past count are clear	*/
+template <class Policy>
+void pairMask(const Policy& policy, const pixel* a, const pixel* b, int count, uint64_t* mask);
+void pairMask(const L1Policy& policy, const pixel* a, const pixel* b, int count, uint64_t* mask);
+
+// The policies are tested once per pixel in the segmentation loops, so they
+// are defined here to be inlined
+
+inline int absolute(int value)
+{
+	return value < 0 ? -value : value;
+}
+
+inline L1Policy::L1Policy(const Similarity& similarity)
+{
+	limit = similarity.threshold;
+}
+
+inline bool L1Policy::operator()(const pixel& a, const pixel& b) const
+{
+	return absolute(a.red - b.red) + absolute(a.green - b.green) + absolute(a.blue - b.blue) < limit;
+}
+
+inline L2Policy::L2Policy(const Similarity& similarity)
+{
+	limit = similarity.threshold < 0 ? 0 : similarity.threshold * similarity.threshold;
+}
+
+inline bool L2Policy::operator()(const pixel& a, const pixel& b) const
+{
+	int dr = a.red - b.red;
+	int dg = a.green - b.green;
+	int db = a.blue - b.blue;
+	return dr * dr + dg * dg + db * db < limit;
+}
+
+inline ChebyshevPolicy::ChebyshevPolicy(const Similarity& similarity)
+{
+	limit = similarity.threshold;
+}
+
+inline bool ChebyshevPolicy::operator()(const pixel& a, const pixel& b) const
+{
+	int dr = absolute(a.red - b.red);
+	int dg = absolute(a.green - b.green);
+	int db = absolute(a.blue - b.blue);
+	int largest = dr > dg ? dr : dg;
+	return (largest > db ? largest : db) < limit;
+}
+
+inline WeightedPolicy::WeightedPolicy(const Similarity& similarity)
+{
+	// equal weights give the same result as L1
+	red = similarity.weights[0];
+	green = similarity.weights[1];
+	blue = similarity.weights[2];
+	limit = similarity.threshold * (red + green + blue);
+}
+
+inline bool WeightedPolicy::operator()(const pixel& a, const pixel& b) const
+{
+	return 3 * (red * absolute(a.red - b.red) + green * absolute(a.green - b.green)
+		+ blue * absolute(a.blue - b.blue)) < limit;
+}
+
+inline LabPolicy::LabPolicy(const Similarity& similarity)
+{
+	limit = similarity.threshold < 0 ? 0 : 4 * similarity.threshold * similarity.threshold;
+}
+
+inline bool LabPolicy::operator()(const pixel& a, const pixel& b) const
+{
+	int dl = a.red - b.red;
+	int da = a.green - b.green;
+	int db = a.blue - b.blue;
+	return dl * dl + 4 * (da * da + db * db) < limit;
+}
+
+template <class Policy>
+inline void seedMask(const Policy& policy, const pixel* pixels, int count, const pixel& seed, uint64_t* mask)
+{
+	memset(mask, 0, maskWords(count) * sizeof(uint64_t));
+	for (int i = 0; i < count; i++)
+	{
+		if (policy(pixels[i], seed))
+			mask[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+}
+
+inline void seedMask(const L1Policy& policy, const pixel* pixels, int count, const pixel& seed, uint64_t* mask)
+{
+	seedDistanceMask(pixels, count, seed, policy.limit, mask);
+}
+
+template <class Policy>
+inline void pairMask(const Policy& policy, const pixel* a, const pixel* b, int count, uint64_t* mask)
+{
+	memset(mask, 0, maskWords(count) * sizeof(uint64_t));
+	for (int i = 0; i < count; i++)
+	{
+		if (policy(a[i], b[i]))
+			mask[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+}
+
+inline void pairMask(const L1Policy& policy, const pixel* a, const pixel* b, int count, uint64_t* mask)
+{
+	pairDistanceMask(a, b, count, policy.limit, mask);
+}
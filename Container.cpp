@@ -1,22 +1,38 @@
 /*	Container.cpp
 	Jayden Fullerton
 
-	This file contains the implementation of a linked list designed to store
-	pixels with red green blue values at a specific row and column. The
-	implementation of the Container class is done using a standard singly
-	linked list.	*/
+	This file contains the implementation of a container designed to store
+	pixels with red green blue values at a specific row and column. Pixels
+	are stored in a singly linked list of chunks, each chunk a contiguous
+	array that is twice as large as the one before it (up to a limit). This
+	gives amortized O(1) appends with only a handful of allocations per
+	container, and lets two containers be spliced together in O(1).	*/
 #include "Container.h"
 
-	/*	creates an iterator for container c
-		@param	container to create an iterator on
-		@pre	none
-		@post	iterator is initialized for c */
-Container::Iterator::Iterator(const Container& c) : super(c)
+// Capacity of the first chunk, and the largest a chunk is allowed to grow
+static const int MIN_CHUNK = 16;
+static const int MAX_CHUNK = 1 << 16;
+
+/*	creates an iterator at a given position
+	@pre	none
+	@post	iterator is at index of chunk */
+Container::Iterator::Iterator(const Chunk* chunk, int index)
 {
-	if (c.head == nullptr)
-		pos = nullptr;
-	else
-		pos = c.head;
+	this->chunk = chunk;
+	this->index = index;
+}
+
+/*	creates an iterator for container c
+	@param	container to create an iterator on
+	@pre	none
+	@post	iterator is initialized for c */
+Container::Iterator::Iterator(const Container& c)
+{
+	chunk = c.head;
+	index = 0;
+	// skip empty chunks so atEnd() only has to check chunk
+	while (chunk != nullptr && chunk->count == 0)
+		chunk = chunk->next;
 }
 
 /*	increments the iterator
@@ -24,26 +40,64 @@ Container::Iterator::Iterator(const Container& c) : super(c)
 	@post	iterator is at the next item in the container */
 Container::Iterator Container::Iterator::operator++(int)
 {
-	pos = pos->next;
+	++(*this);
+	return *this;
+}
+
+Container::Iterator& Container::Iterator::operator++()
+{
+	index++;
+	while (chunk != nullptr && index >= chunk->count)
+	{
+		chunk = chunk->next;
+		index = 0;
+	}
 	return *this;
 }
 
 /*	is the iterator at the end of the container
 	@pre	none
 	@post	true is returned if iterator is at the end of container, false otherwise */
-bool Container::Iterator::atEnd()
+bool Container::Iterator::atEnd() const
 {
-	if (pos == nullptr)
-		return true;
-	return false;
+	return chunk == nullptr;
 }
 
 /*	returns the data at the current spot of the iterator
 	@pre	iterator must not be at the end of the container
 	@post	returns data at current position of iterator */
-PixelData Container::Iterator::getData()
+PixelData Container::Iterator::getData() const
+{
+	return chunk->data[index];
+}
+
+const PixelData& Container::Iterator::operator*() const
+{
+	return chunk->data[index];
+}
+
+/*	are two iterators at different positions
+	@pre	both iterators must be on the same container
+	@post	true is returned if the positions differ, false otherwise */
+bool Container::Iterator::operator!=(const Iterator& it) const
+{
+	return chunk != it.chunk || index != it.index;
+}
+
+/*	returns an iterator at the first pixel, for range-based for loops
+	@pre	none
+	@post	iterator at the start of the container is returned	*/
+Container::Iterator Container::begin() const
 {
-	return pos->data;
+	return Iterator(*this);
+}
+
+/*	returns an iterator past the last pixel, for range-based for loops
+	@pre	none
+	@post	iterator at the end of the container is returned	*/
+Container::Iterator Container::end() const
+{
+	return Iterator(nullptr, 0);
 }
 
 /*	Container constructor
@@ -52,6 +106,7 @@ PixelData Container::Iterator::getData()
 Container::Container()
 {
 	head = nullptr;
+	tail = nullptr;
 	size = 0;
 }
 
@@ -59,47 +114,34 @@ Container::Container()
 	NOTE	doesn't have to be called explicitly
 	@param	Container to be copied
 	@pre	c must be a valid Container
-	@post	a deep copy of the linked list of c
-			is created and put into this Container	*/
+	@post	a deep copy of c is created and put into this Container	*/
 Container::Container(const Container& c)
 {
+	head = nullptr;
+	tail = nullptr;
 	size = 0;
+	copyFrom(c);
+}
 
-	deallocate();
-	// Reallocate c into this
-	if (c.head == nullptr)
-	{
-		head = nullptr;
-		return;
-	}
-	head = new Node;
-	head->data = c.head->data;
-	Node* cur1 = c.head;
-	Node* cur2 = head;
-
-	while (true)
-	{
-		size++;
-		cur2->data = cur1->data;
-		if (cur1->next == nullptr)
-		{
-			cur2->next = nullptr;
-			return;
-		}
-		else
-		{
-			cur2->next = new Node;
-			cur2 = cur2->next;
-			cur1 = cur1->next;
-		}
-	}
+/*	Container move constructor
+	NOTE	doesn't have to be called explicitly
+	@param	Container to be moved from
+	@pre	c must be a valid Container
+	@post	this Container takes c's chunks, c is left empty	*/
+Container::Container(Container&& c) noexcept
+{
+	head = c.head;
+	tail = c.tail;
+	size = c.size;
+	c.head = nullptr;
+	c.tail = nullptr;
+	c.size = 0;
 }
 
 /*	Container assignment operator (=)
 	@param	right hand side of assignment
 	@pre	c must be a valid Container
-	@post	a deep copy of the linked list of c
-			is created and put into this container
+	@post	a deep copy of c is created and put into this container
 			unless it is self-assignment	*/
 Container& Container::operator=(const Container& c)
 {
@@ -108,33 +150,29 @@ Container& Container::operator=(const Container& c)
 		return *this;
 
 	deallocate();
-	// Reallocate c into this
-	if (c.head == nullptr)
-	{
-		head = nullptr;
-		return *this;
-	}
-	head = new Node;
-	head->data = c.head->data;
-	Node* cur1 = c.head;
-	Node* cur2 = head;
+	copyFrom(c);
+	return *this;
+}
 
-	while (true)
-	{
-		cur2->data = cur1->data;
-		if (cur1->next == nullptr)
-		{
-			cur2->next = nullptr;
-			return *this;
-		}
-		else
-		{
-			cur2->next = new Node;
-			cur2 = cur2->next;
-			cur1 = cur1->next;
-		}
-	}
+/*	Container move assignment operator (=)
+	@param	right hand side of assignment
+	@pre	c must be a valid Container
+	@post	this Container frees its chunks and takes c's chunks,
+			c is left empty, unless it is self-assignment
+	@return	this Container	*/
+Container& Container::operator=(Container&& c) noexcept
+{
+	// Check for self-assignment
+	if (this == &c)
+		return *this;
 
+	deallocate();
+	head = c.head;
+	tail = c.tail;
+	size = c.size;
+	c.head = nullptr;
+	c.tail = nullptr;
+	c.size = 0;
 	return *this;
 }
 
@@ -148,41 +186,93 @@ Container::~Container()
 
 /*	deallocation helper function
 	@pre	none
-	@post	linked list associated with this container is now deallocated */
+	@post	every chunk associated with this container is now deallocated */
 void Container::deallocate()
 {
 	while (head != nullptr)
 	{
-		Node* temp = head;
+		Chunk* temp = head;
 		head = head->next;
+		delete[] temp->data;
 		delete temp;
 	}
+	tail = nullptr;
+	size = 0;
+}
+
+/*	appends a new empty chunk
+	@param	number of pixels the chunk can hold
+	@pre	capacity must be greater than 0
+	@post	a new chunk is linked after tail and becomes the tail	*/
+void Container::addChunk(int capacity)
+{
+	Chunk* chunk = new Chunk;
+	chunk->data = new PixelData[capacity];
+	chunk->count = 0;
+	chunk->capacity = capacity;
+	chunk->next = nullptr;
+	if (tail == nullptr)
+		head = chunk;
+	else
+		tail->next = chunk;
+	tail = chunk;
 }
 
-/*	Add node to the end of the linked list
-	@param	red value for the pixel
-	@param	green value for the pixel
-	@param	blue value for the pixel
-	@param	row the pixel is in
-	@param	column the pixel is in
+/*	deep copies the pixels of c onto the end of this
+	@pre	c must be a valid Container, c must not be this
+	@post	every pixel of c is appended to this Container	*/
+void Container::copyFrom(const Container& c)
+{
+	if (c.size == 0) // nothing to add
+		return;
+
+	// one chunk holds the whole copy
+	reserve(c.size);
+	for (const Chunk* cur = c.head; cur != nullptr; cur = cur->next)
+	{
+		for (int i = 0; i < cur->count; i++)
+			tail->data[tail->count++] = cur->data[i];
+	}
+	size += c.size;
+}
+
+/*	Add a pixel to the end of the container
+	@param	pixel data to add
 	@pre	none
-	@post	a new node with values given in the paramaters
-			is added after the head onto the linked list	*/
+	@post	p is appended to the container, amortized O(1)	*/
 void Container::addPixel(PixelData p)
 {
-	size++;
-	if (head == nullptr)
+	if (tail == nullptr || tail->count == tail->capacity)
 	{
-		head = new Node;
-		head->data = p;
-		head->next = nullptr;
-		return;
+		// double the total capacity each time a chunk fills up
+		int capacity = size;
+		if (capacity < MIN_CHUNK)
+			capacity = MIN_CHUNK;
+		if (capacity > MAX_CHUNK)
+			capacity = MAX_CHUNK;
+		addChunk(capacity);
 	}
+	tail->data[tail->count++] = p;
+	size++;
+}
+
+/*	Reserve room for more pixels
+	@param	number of pixels that will be added
+	@pre	count must be non-negative
+	@post	the next count calls to addPixel will not allocate	*/
+void Container::reserve(int count)
+{
+	int room = tail == nullptr ? 0 : tail->capacity - tail->count;
+	if (count > room)
+		addChunk(count - room > MIN_CHUNK ? count - room : MIN_CHUNK);
+}
 
-	Node* temp = head->next;
-	head->next = new Node;
-	head->next->next = temp;
-	head->next->data = p;
+/*	Remove every pixel
+	@pre	none
+	@post	the container is empty and its memory is freed	*/
+void Container::clear()
+{
+	deallocate();
 }
 
 /*	returns the size of this
@@ -196,42 +286,45 @@ int Container::getSize() const
 /*	returns data from specific index
 	@param	index to get data from
 	@pre	container must be non-empty
-	@post	returns PixelData from the beginning of the container */
+	@post	returns PixelData from the beginning of the container,
+			the first pixel that was added */
 PixelData Container::getFirst() const
 {
-	return head->data;
+	return *begin();
 }
 
 /*	Append c to this Container
 	@param	container to merge with
 	@pre	c must be a valid Container
-	@post	the linked list associated with c is deep copied
-			and appended to this Container	*/
+	@post	the pixels of c are deep copied and appended to this Container	*/
 void Container::merge(const Container& c)
 {
-	size += c.size;
-	if (c.size == 0) // nothing to add
-		return;
-	Node* oldHead = head;
-	head = new Node;
-	head->data = c.head->data;
-	Node* cur1 = c.head;
-	Node* cur2 = head;
-
-	while (true)
+	if (this == &c)
 	{
-		cur2->data = cur1->data;
-		if (cur1->next == nullptr)
-		{
-			cur2->next = oldHead;
-			return;
-		}
-		else
-		{
-			cur2->next = new Node;
-			cur2 = cur2->next;
-			cur1 = cur1->next;
-		}
+		Container copy = c;
+		merge(static_cast<Container&&>(copy));
+		return;
 	}
-	return;
-}
\ No newline at end of file
+	copyFrom(c);
+}
+
+/*	Splice c onto the end of this Container
+	@param	container to merge with
+	@pre	c must be a valid Container
+	@post	the chunks of c are linked onto the end of this Container in
+			O(1) without copying, c is left empty	*/
+void Container::merge(Container&& c)
+{
+	if (this == &c || c.head == nullptr)
+		return;
+
+	if (tail == nullptr)
+		head = c.head;
+	else
+		tail->next = c.head;
+	tail = c.tail;
+	size += c.size;
+	c.head = nullptr;
+	c.tail = nullptr;
+	c.size = 0;
+}
@@ -1,10 +1,12 @@
 /*	Container.h
 	Jayden Fullerton
 
-	This file contains the implementation of a linked list designed to store
-	pixels with red green blue values at a specific row and column. The
-	implementation of the Container class is done using a standard singly
-	linked list.	*/
+	This file contains the implementation of a container designed to store
+	pixels with red green blue values at a specific row and column. Pixels
+	are stored in a singly linked list of chunks, each chunk a contiguous
+	array that is twice as large as the one before it (up to a limit). This
+	gives amortized O(1) appends with only a handful of allocations per
+	container, and lets two containers be spliced together in O(1).	*/
 #pragma once
 
 struct PixelData
@@ -14,15 +16,16 @@ struct PixelData
 
 class Container
 {
-	/*	Node struct
+	/*	Chunk struct
 
-		Contains a standard node for a linked list with a next pointer. Stores data
-		of a pixel within an image using the PixelData struct. Singly linked using a
-		next pointer.	*/
-	struct Node
+		Contains a contiguous array of pixels and a next pointer to the chunk
+		after it. Only the last chunk of a container may have unused capacity
+		until another container is spliced after it.	*/
+	struct Chunk
 	{
-		PixelData data;
-		Node* next;
+		PixelData* data;
+		int count, capacity;
+		Chunk* next;
 	};
 
 	/*	deallocation helper function
@@ -30,7 +33,19 @@ class Container
 		@post	dynamic memory associated with this Container is now deallocated	*/
 	void deallocate();
 
-	Node* head;
+	/*	appends a new empty chunk
+		@param	number of pixels the chunk can hold
+		@pre	capacity must be greater than 0
+		@post	a new chunk is linked after tail and becomes the tail	*/
+	void addChunk(int capacity);
+
+	/*	deep copies the pixels of c onto the end of this
+		@pre	c must be a valid Container, c must not be this
+		@post	every pixel of c is appended to this Container	*/
+	void copyFrom(const Container& c);
+
+	Chunk* head;
+	Chunk* tail;
 	int size;
 public:
 	/*	Container constructor
@@ -42,36 +57,54 @@ public:
 		NOTE	doesn't have to be called explicitly
 		@param	Container to be copied
 		@pre	c must be a valid Container
-		@post	a deep copy of the linked list of c
-				is created and put into this Container	*/
+		@post	a deep copy of c is created and put into this Container	*/
 	Container(const Container& c);
 
+	/*	Container move constructor
+		NOTE	doesn't have to be called explicitly
+		@param	Container to be moved from
+		@pre	c must be a valid Container
+		@post	this Container takes c's chunks, c is left empty	*/
+	Container(Container&& c) noexcept;
 
 	/*	Container assignment operator (=)
 		@param	right hand side of assignment
 		@pre	c must be a valid Container
-		@post	a deep copy of the linked list of c
-				is created and put into a new container
+		@post	a deep copy of c is created and put into this container
 				unless it is self-assignment
 		@return	the deep copy of the Container	*/
 	Container& operator=(const Container& c);
 
+	/*	Container move assignment operator (=)
+		@param	right hand side of assignment
+		@pre	c must be a valid Container
+		@post	this Container frees its chunks and takes c's chunks,
+				c is left empty, unless it is self-assignment
+		@return	this Container	*/
+	Container& operator=(Container&& c) noexcept;
+
 	/*	Container destructor
 		@pre	none
 		@post	dynamic memory associated with this Container is now deallocated	*/
 	~Container();
 
-	/*	Add node to the end of the linked list
-		@param	red value for the pixel
-		@param	green value for the pixel
-		@param	blue value for the pixel
-		@param	row the pixel is in
-		@param	column the pixel is in
+	/*	Add a pixel to the end of the container
+		@param	pixel data to add
 		@pre	none
-		@post	a new node with values given in the paramaters
-				is added after the head onto the linked list	*/
+		@post	p is appended to the container, amortized O(1)	*/
 	void addPixel(PixelData p);
 
+	/*	Reserve room for more pixels
+		@param	number of pixels that will be added
+		@pre	count must be non-negative
+		@post	the next count calls to addPixel will not allocate	*/
+	void reserve(int count);
+
+	/*	Remove every pixel
+		@pre	none
+		@post	the container is empty and its memory is freed	*/
+	void clear();
+
 	/*	returns the size of this
 		@pre	none
 		@post	size of this is returned */
@@ -80,20 +113,33 @@ public:
 	/*	returns data from specific index
 		@param	index to get data from
 		@pre	container must be non-empty
-		@post	returns PixelData from the beginning of the container */
+		@post	returns PixelData from the beginning of the container,
+				the first pixel that was added */
 	PixelData getFirst() const;
 
 	/*	Append c to this Container
 		@param	container to merge with
 		@pre	c must be a valid Container
-		@post	the linked list associated with c is deep copied
-				and appended to this Container	*/
+		@post	the pixels of c are deep copied and appended to this Container	*/
 	void merge(const Container& c);
 
+	/*	Splice c onto the end of this Container
+		@param	container to merge with
+		@pre	c must be a valid Container
+		@post	the chunks of c are linked onto the end of this Container in
+				O(1) without copying, c is left empty	*/
+	void merge(Container&& c);
+
 	class Iterator
 	{
-		const Container& super;
-		Node* pos;
+		const Chunk* chunk;
+		int index;
+
+		/*	creates an iterator at a given position
+			@pre	none
+			@post	iterator is at index of chunk */
+		Iterator(const Chunk* chunk, int index);
+		friend class Container;
 	public:
 		/*	creates an iterator for container c
 			@param	container to create an iterator on
@@ -105,16 +151,32 @@ public:
 			@pre	iterator must not already be at the end of the container
 			@post	iterator is at the next item in the container */
 		Iterator operator++(int);
+		Iterator& operator++();
 
 		/*	is the iterator at the end of the container
 			@pre	none
 			@post	true is returned if iterator is at the end of container, false otherwise */
-		bool atEnd();
+		bool atEnd() const;
 
 		/*	returns the data at the current spot of the iterator
 			@pre	iterator must not be at the end of the container
 			@post	returns data at current position of iterator */
-		PixelData getData();
+		PixelData getData() const;
+		const PixelData& operator*() const;
+
+		/*	are two iterators at different positions
+			@pre	both iterators must be on the same container
+			@post	true is returned if the positions differ, false otherwise */
+		bool operator!=(const Iterator& it) const;
 	};
-};
 
+	/*	returns an iterator at the first pixel, for range-based for loops
+		@pre	none
+		@post	iterator at the start of the container is returned	*/
+	Iterator begin() const;
+
+	/*	returns an iterator past the last pixel, for range-based for loops
+		@pre	none
+		@post	iterator at the end of the container is returned	*/
+	Iterator end() const;
+};
@@ -0,0 +1,95 @@
+/*	DisjointSet.cpp
+	Jayden Fullerton
+
+	This file contains a disjoint-set (union-find) forest over the integers
+	0..size-1. The forest is stored flat in two arrays, a parent index and a
+	rank per element, and uses union by rank with path compression so that a
+	sequence of operations runs in near-linear time.	*/
+#include "DisjointSet.h"
+
+/*	DisjointSet constructor
+	@param	number of elements in the forest
+	@pre	size must be non-negative
+	@post	every element 0..size-1 is in a set of its own	*/
+DisjointSet::DisjointSet(int size)
+{
+	reset(size);
+}
+
+/*	resets the forest
+	@param	number of elements in the forest
+	@pre	size must be non-negative
+	@post	every element 0..size-1 is in a set of its own, memory
+			already allocated is reused where possible	*/
+void DisjointSet::reset(int size)
+{
+	parent.resize(size);
+	rank.assign(size, 0);
+	for (int i = 0; i < size; i++)
+		parent[i] = i;
+}
+
+/*	adds a new element in a set of its own
+	@pre	none
+	@post	the index of the new element is returned	*/
+int DisjointSet::add()
+{
+	int x = (int)parent.size();
+	parent.push_back(x);
+	rank.push_back(0);
+	return x;
+}
+
+/*	finds the representative of the set containing x
+	@param	element to look up
+	@pre	x must be within 0..size-1
+	@post	the root of x's set is returned and every element on the
+			path from x to the root now points directly at the root	*/
+int DisjointSet::find(int x)
+{
+	int root = x;
+	while (parent[root] != root)
+		root = parent[root];
+
+	// second walk compresses the path
+	while (parent[x] != root)
+	{
+		int next = parent[x];
+		parent[x] = root;
+		x = next;
+	}
+	return root;
+}
+
+/*	merges the sets containing a and b
+	@param	element in the first set
+	@param	element in the second set
+	@pre	a and b must be within 0..size-1
+	@post	a and b are in the same set, the new root is returned	*/
+int DisjointSet::unite(int a, int b)
+{
+	a = find(a);
+	b = find(b);
+	if (a == b)
+		return a;
+
+	// attach the shallower tree under the deeper one
+	if (rank[a] < rank[b])
+	{
+		int temp = a;
+		a = b;
+		b = temp;
+	}
+	parent[b] = a;
+	if (rank[a] == rank[b])
+		rank[a]++;
+	return a;
+}
+
+/*	returns the number of elements in the forest
+	@pre	none
+	@post	number of elements is returned	*/
+int DisjointSet::getSize() const
+{
+	return (int)parent.size();
+}
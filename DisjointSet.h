@@ -0,0 +1,53 @@
+/*	DisjointSet.h
+	Jayden Fullerton
+
+	This file contains a disjoint-set (union-find) forest over the integers
+	0..size-1. The forest is stored flat in two arrays, a parent index and a
+	rank per element, and uses union by rank with path compression so that a
+	sequence of operations runs in near-linear time.	*/
+#pragma once
+
+#include <vector>
+
+class DisjointSet
+{
+	std::vector<int> parent;
+	std::vector<unsigned char> rank;
+public:
+	/*	DisjointSet constructor
+		@param	number of elements in the forest
+		@pre	size must be non-negative
+		@post	every element 0..size-1 is in a set of its own	*/
+	DisjointSet(int size = 0);
+
+	/*	resets the forest
+		@param	number of elements in the forest
+		@pre	size must be non-negative
+		@post	every element 0..size-1 is in a set of its own, memory
+				already allocated is reused where possible	*/
+	void reset(int size);
+
+	/*	adds a new element in a set of its own
+		@pre	none
+		@post	the index of the new element is returned	*/
+	int add();
+
+	/*	finds the representative of the set containing x
+		@param	element to look up
+		@pre	x must be within 0..size-1
+		@post	the root of x's set is returned and every element on the
+				path from x to the root now points directly at the root	*/
+	int find(int x);
+
+	/*	merges the sets containing a and b
+		@param	element in the first set
+		@param	element in the second set
+		@pre	a and b must be within 0..size-1
+		@post	a and b are in the same set, the new root is returned	*/
+	int unite(int a, int b);
+
+	/*	returns the number of elements in the forest
+		@pre	none
+		@post	number of elements is returned	*/
+	int getSize() const;
+};
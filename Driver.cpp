@@ -2,194 +2,499 @@
 	Jayden Fullerton
 
 	This file contains main(). This file uses image segmentation to seperate
-	similar color groups using Container, and then writing the average color
-	for that entire group. Images are implemented using the Image class.	*/
+	similar color groups into segments, and then writing the average color
+	for that entire group. Images are implemented using the Image class.
+	Given input files it runs in batch mode, segmenting every file on a pool
+	of workers, otherwise it segments img.gif into output.gif.	*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include "Container.h"
+#include "Batch.h"
+#include "Benchmark.h"
+#include "ColorKernel.h"
 #include "Image.h"
+#include "ImageDiff.h"
+#include "Pipeline.h"
+#include "Profile.h"
+#include "RegionGraph.h"
+#include "SegmentStats.h"
+
+// Segments smaller than this are counted as fragments in the summary
+static const int FRAGMENT_SIZE = 10;
 
 // forward declarations
-void addToContainer(Container& c, Container& merged, int row, int col, const Image& in, Image& out);
-PixelData generatePixelData(int row, int col, const Image& img);
-void segmentContainer(const Container& c, Image& out);
-int av(int num);
+int runSingle(const BatchOptions& options);
+int runCompare(const string& first, const string& second, const string& maskFile, const BatchOptions& options);
+bool parseSizes(const string& list, vector<int>& sizes);
+void printSummary(const vector<SegmentStats>& stats);
+void printUsage();
 
 /*	main()
+	@param	number of command line arguments
+	@param	command line arguments: input files or wildcard patterns, and
+			-list file		reads more inputs from file, one per line
+			-out dir		writes the segmented images to dir
+			-threshold n	color distance two pixels must be below to join
+			-metric name	color distance: l1, l2, chebyshev, weighted or lab
+			-weights r,g,b	channel weights of the weighted metric
+			-jobs n			images processed at once (0 for every hardware thread)
+			-maxmem MB		image data held in flight by all jobs
+			-rawsize WxH	size of every .raw/.rgb input
+			-stream rows	reads .ppm/.raw/.rgb inputs rows at a time in bounded memory
+			-crop WxH+X+Y	segments only a rectangle of every input
+			-transform name	flips, rotates or transposes every input before segmenting
+			-threads n		threads to label one image on in union-find mode
+			-unionfind		selects union-find mode
+			-pyramid n		union-find labels flat blocks of up to 2^n pixels square at once
+			-runs			union-find joins runs of similar pixels instead of single pixels
+			-mean			grows regions by their running mean color instead of the seed
+			-minregion n	merges segments under n pixels into their closest neighbour
+			-merge n		merges neighbouring segments whose mean colors are closer than n
+			-stats			writes the segment statistics of every image to a CSV
+			-labels			writes the label map and region graph of every image to a .seg file
+			-kernel name	color distance kernel: avx2, ssse3, scalar or auto
+			-compare a b	compares two images and reports how they differ
+			-diffmask file	writes the differing pixels of -compare to file
+			-benchmark n	times every metric n times on img.gif or the first input
+			-trace file		writes the profile in Chrome trace format (PROFILE=1 builds)
+			-suite sizes	runs the benchmark suite on synthetic images of the given
+							megapixels (e.g. 1,16,100) and writes JSON to the console
 	@pre	none
 	@post	image segmentation is used to group similar colors into
 			the average of those colors and written to disk	*/
-int main()
+int main(int argc, char* argv[])
 {
-	int numOfContainers = 0;
-	Container merged;
-
-	// Read image from disk
-	Image input = Image("img.gif");
-
-	// Create black image with same dimensions as input
-	Image output = Image(input.getRows(), input.getCols());
-
-	// Iterate through image
-	for (int row = 0; row < input.getRows(); row++)
+	BatchOptions batch;
+	vector<string> files;
+	bool listed = false;
+	int benchmarkRuns = 0;
+	vector<int> suiteSizes;
+	string traceFile;
+	vector<string> compared;
+	string diffMaskFile;
+	for (int i = 1; i < argc; i++)
 	{
-		for (int col = 0; col < input.getCols(); col++)
+		string arg = argv[i];
+		if (arg == "-unionfind")
+			batch.segment.unionFind = true;
+		else if (arg == "-mean")
+			batch.segment.reference = Reference::Mean;
+		else if (arg == "-stats")
+			batch.writeStats = true;
+		else if (arg == "-labels")
+			batch.writeLabels = true;
+		else if (arg == "-runs")
 		{
-			// if the current pixel is black
-			if (output.getPixelColor(row, col, "red") == 0 &&
-				output.getPixelColor(row, col, "green") == 0 &&
-				output.getPixelColor(row, col, "blue") == 0)
+			batch.segment.unionFind = true;
+			batch.segment.runs = true;
+		}
+		else if (arg == "-pyramid" && i + 1 < argc)
+		{
+			batch.segment.unionFind = true;
+			batch.segment.pyramidLevels = atoi(argv[++i]);
+			if (batch.segment.pyramidLevels <= 0)
 			{
-				numOfContainers++;
-				Container c;
-				addToContainer(c, merged, row, col, input, output);
+				cout << "Pyramid levels must be at least one" << endl;
+				return 1;
 			}
 		}
+		else if (arg == "-threads" && i + 1 < argc)
+			batch.segment.threads = atoi(argv[++i]);
+		else if (arg == "-minregion" && i + 1 < argc)
+			batch.segment.minRegion = atoi(argv[++i]);
+		else if (arg == "-merge" && i + 1 < argc)
+			batch.segment.mergeThreshold = atoi(argv[++i]);
+		else if (arg == "-threshold" && i + 1 < argc)
+			batch.segment.similarity.threshold = atoi(argv[++i]);
+		else if (arg == "-metric" && i + 1 < argc)
+		{
+			if (!parseMetric(argv[++i], batch.segment.similarity.metric))
+			{
+				cout << "Unknown metric " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-weights" && i + 1 < argc)
+		{
+			int* weights = batch.segment.similarity.weights;
+			if (sscanf(argv[++i], "%d,%d,%d", &weights[0], &weights[1], &weights[2]) != 3)
+			{
+				cout << "Weights must be given as r,g,b" << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-benchmark" && i + 1 < argc)
+			benchmarkRuns = atoi(argv[++i]);
+		else if (arg == "-suite" && i + 1 < argc)
+		{
+			if (!parseSizes(argv[++i], suiteSizes))
+			{
+				cout << "Sizes must be given as megapixels separated by commas" << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-trace" && i + 1 < argc)
+			traceFile = argv[++i];
+		else if (arg == "-jobs" && i + 1 < argc)
+			batch.jobs = atoi(argv[++i]);
+		else if (arg == "-maxmem" && i + 1 < argc)
+			batch.maxMemory = atoll(argv[++i]) * 1024 * 1024;
+		else if (arg == "-rawsize" && i + 1 < argc)
+		{
+			if (sscanf(argv[++i], "%dx%d", &batch.rawCols, &batch.rawRows) != 2 || batch.rawCols <= 0 || batch.rawRows <= 0)
+			{
+				cout << "Raw size must be given as WxH" << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-stream" && i + 1 < argc)
+		{
+			batch.streamRows = atoi(argv[++i]);
+			if (batch.streamRows <= 0)
+			{
+				cout << "Stream bands must be at least one row" << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-crop" && i + 1 < argc)
+		{
+			if (sscanf(argv[++i], "%dx%d+%d+%d", &batch.cropCols, &batch.cropRows, &batch.cropLeft, &batch.cropTop) != 4
+				|| batch.cropCols <= 0 || batch.cropRows <= 0 || batch.cropLeft < 0 || batch.cropTop < 0)
+			{
+				cout << "Crop must be given as WxH+X+Y" << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-transform" && i + 1 < argc)
+		{
+			if (!parseTransform(argv[++i], batch.transform))
+			{
+				cout << "Unknown transform " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-out" && i + 1 < argc)
+			batch.outputDir = argv[++i];
+		else if (arg == "-kernel" && i + 1 < argc)
+		{
+			if (!selectColorKernel(argv[++i]))
+			{
+				cout << "Kernel " << argv[i] << " is not supported" << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-compare" && i + 2 < argc)
+		{
+			compared.push_back(argv[++i]);
+			compared.push_back(argv[++i]);
+		}
+		else if (arg == "-diffmask" && i + 1 < argc)
+			diffMaskFile = argv[++i];
+		else if (arg == "-list" && i + 1 < argc)
+		{
+			listed = true;
+			if (!readFileList(argv[++i], files))
+			{
+				cout << "Could not open file list " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg[0] == '-')
+		{
+			printUsage();
+			return 1;
+		}
+		else
+		{
+			vector<string> expanded = expandInput(arg);
+			if (expanded.empty())
+				cout << "No files match " << arg << endl;
+			files.insert(files.end(), expanded.begin(), expanded.end());
+		}
 	}
 
-	cout << "Total number of segments found: " << numOfContainers << endl;
-	cout << "Total number of pixels in merged group: " << merged.getSize() << endl;
+	if (!compared.empty())
+		return runCompare(compared[0], compared[1], diffMaskFile, batch);
+	if (!suiteSizes.empty())
+	{
+		// progress goes to cerr so the JSON can be redirected to a file
+		benchmarkSuite(suiteSizes, batch.segment, cout, cerr);
+		return 0;
+	}
+	if (benchmarkRuns > 0)
+	{
+		Image input = Image(files.empty() ? "img.gif" : files[0]);
+		if (input.getRows() == 0)
+			return 1;
+		benchmarkMetrics(input, batch.segment, benchmarkRuns, cout);
+		return 0;
+	}
 
-	// Calculate average by iterating through the merged container
-	int red = 0;
-	int green = 0;
-	int blue = 0;
-	Container::Iterator it = Container::Iterator(merged);
-	while (!it.atEnd())
+	// a streamed image is never labeled as a whole
+	if (batch.writeLabels && batch.streamRows > 0)
 	{
-		red += it.getData().red;
-		green += it.getData().green;
-		blue += it.getData().blue;
-		it++;
+		cout << "-labels cannot be used with -stream" << endl;
+		return 1;
+	}
+	if ((batch.segment.minRegion > 1 || batch.segment.mergeThreshold > 0) && batch.streamRows > 0)
+	{
+		cout << "-minregion and -merge cannot be used with -stream" << endl;
+		return 1;
+	}
+	if ((batch.cropRows > 0 || batch.transform != Transform::None || batch.segment.pyramidLevels > 0
+		|| batch.segment.runs) && batch.streamRows > 0)
+	{
+		cout << "-crop, -transform, -pyramid and -runs cannot be used with -stream" << endl;
+		return 1;
+	}
+	if (batch.segment.pyramidLevels > 0 && batch.segment.runs)
+	{
+		cout << "-pyramid and -runs cannot be used together" << endl;
+		return 1;
+	}
+	if (!traceFile.empty() && !profilingEnabled())
+		cout << "Built without profiling, rebuild with make PROFILE=1 to write " << traceFile << endl;
+
+	// Without inputs segment img.gif the way the driver always has
+	int result = 0;
+	if (files.empty() && !listed)
+	{
+		batch.segment.verbose = true;
+		result = runSingle(batch);
+	}
+	else if (files.empty())
+	{
+		cout << "No input files" << endl;
+		return 1;
+	}
+	else
+	{
+		vector<FileReport> reports;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		runBatch(files, batch, reports);
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		printBatchSummary(reports, elapsed.count());
+
+		for (size_t i = 0; i < reports.size(); i++)
+		{
+			if (!reports[i].ok)
+				result = 1;
+		}
 	}
-	red /= merged.getSize();
-	green /= merged.getSize();
-	blue /= merged.getSize();
-	cout << "Average color of the merged group: " << red << "R, " << green << "G, " << blue << "B" << endl;
 
-	output.writeToDisk("output.gif");
-	system("pause");
-	return 0;
+	if (profilingEnabled())
+	{
+		cout << endl;
+		writeProfileReport(cout);
+		if (!traceFile.empty())
+		{
+			ofstream trace(traceFile);
+			writeChromeTrace(trace);
+		}
+	}
+	return result;
 }
 
-/*	add pixels to container recursively
-	@param	container to add pixels to
-	@param	container containing all currently processed containers
-	@param	row of pixel trying to add
-	@param	column of pixel trying to add
-	@param	image to draw pixels from
-	@param	image to write containers to
-	@pre	img must be a valid image object
-	@post	image is segmented into similar color groups	*/
-void addToContainer(Container& c, Container& merged, int row, int col, const Image& in, Image& out)
+/*	segments img.gif into output.gif
+	@param	batch options, the segmentation options and what to write are used
+	@pre	none
+	@post	the segmented image is written to output.gif and a summary is
+			written to the console, 0 is returned on success	*/
+int runSingle(const BatchOptions& batch)
 {
-	// if row,col is already in this container
-	if (out.getPixelColor(row, col, "red") == 255 &&
-		out.getPixelColor(row, col, "green") == 255 &&
-		out.getPixelColor(row, col, "blue") == 255)
-		return;
+	const SegmentOptions& options = batch.segment;
 
-	// if row,col is already in another container
-	if (!(out.getPixelColor(row, col, "red") == 0 &&
-		out.getPixelColor(row, col, "green") == 0 &&
-		out.getPixelColor(row, col, "blue") == 0))
-		return;
+	// Read image from disk
+	Image input = Image("img.gif");
+	if (input.getRows() == 0)
+		return 1;
+	if (!prepareImage(input, batch))
+	{
+		cout << "Crop does not fit inside the image" << endl;
+		return 1;
+	}
 
-	PixelData seed;
-	if (c.getSize() == 0)
-		seed = generatePixelData(row, col, in);
-	else
-		seed = c.getFirst();
-
-	// if this pixel is similar enough to the seed, add it to c
-	if ((av(seed.red - in.getPixelColor(row, col, "red")) +
-		av(seed.green - in.getPixelColor(row, col, "green")) +
-		av(seed.blue - in.getPixelColor(row, col, "blue"))) < 100)
-	{
-		c.addPixel(generatePixelData(row, col, in));
-		out.setPixelColor(row, col, "red", 255);
-		out.setPixelColor(row, col, "green", 255);
-		out.setPixelColor(row, col, "blue", 255);
-
-		if (row + 1 < in.getRows())
-			addToContainer(c, merged, row + 1, col, in, out);
-		if (col + 1 < in.getCols())
-			addToContainer(c, merged, row, col + 1, in, out);
-		if (row - 1 >= 0)
-			addToContainer(c, merged, row - 1, col, in, out);
-		if (col - 1 >= 0)
-			addToContainer(c, merged, row , col - 1, in, out);
+	// Create black image with same dimensions as input
+	Image output = Image(input.getRows(), input.getCols());
+
+	// Segment with the selected mode and time it
+	Segmentation seg;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (batch.writeLabels)
+	{
+		labelImage(input, options, seg);
+		paintLabels(seg.labels.data(), seg.stats, output);
 	}
 	else
-		return;
+		segmentImage(input, output, options, seg.stats);
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	const vector<SegmentStats>& stats = seg.stats;
+	printSummary(stats);
+	cout << "Segmentation took " << elapsed.count() << " ms ("
+		<< (options.pyramidLevels > 0 ? "pyramid union-find" : options.runs ? "run union-find"
+			: options.unionFind ? "union-find"
+			: options.reference == Reference::Mean ? "mean flood fill" : "flood fill")
+		<< ", " << colorKernelName() << " kernel)" << endl;
 
-	if (row == seed.row && col == seed.col)
+	if (batch.writeStats)
 	{
-		segmentContainer(c, out);
-		merged.merge(c);
+		ofstream table("output.csv");
+		writeSegmentTable(table, stats);
+	}
+	if (batch.writeLabels)
+	{
+		RegionGraph graph;
+		buildRegionGraph(input, seg, graph);
+		if (!writeSegmentation("output.seg", seg, graph))
+			return 1;
+		cout << "Region graph: " << graph.getEdges() << " adjacent pairs, written to output.seg" << endl;
 	}
-}
 
-/*	generates a PixelData struct as defined in Container.h
-	@param	row of pixel
-	@param	col of pixel
-	@param	image to draw pixel from
-	@pre	row,col must be a pixel within img
-	@post	a PixelData struct is returned with the corresponding pixel data */
-PixelData generatePixelData(int row, int col, const Image& img)
-{
-	PixelData p;
-	p.red = img.getPixelColor(row, col, "red");
-	p.green = img.getPixelColor(row, col, "green");
-	p.blue = img.getPixelColor(row, col, "blue");
-	p.row = row;
-	p.col = col;
-	return p;
+	return output.writeToDisk("output.gif") ? 0 : 1;
 }
 
-/*	set container equal to its average color in the image
-	@param	container to be segmented
-	@param	output for image to be segmented into
-	@pre	container must refer to pixels within the dismensions of image
-	@post	all pixels in c are now the average of the pixels in the previous image	*/
-void segmentContainer(const Container& c, Image& out)
+/*	compares two images
+	@param	first image file
+	@param	second image file
+	@param	file to write the diff mask to, empty for none
+	@param	batch options, the raw size is used
+	@pre	none
+	@post	the differences are written to the console, 0 is returned if the
+			images are identical	*/
+int runCompare(const string& first, const string& second, const string& maskFile, const BatchOptions& options)
 {
-	int red = 0;
-	int green = 0;
-	int blue = 0;
-	Container::Iterator it = Container::Iterator(c);
-	while (!it.atEnd())
+	Image a = loadImage(first, options);
+	Image b = loadImage(second, options);
+	if (a.getRows() == 0 || b.getRows() == 0)
+	{
+		cout << "Could not read " << (a.getRows() == 0 ? first : second) << endl;
+		return 1;
+	}
+	if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+	{
+		cout << "Images have different sizes: " << a.getCols() << "x" << a.getRows() << " and "
+			<< b.getCols() << "x" << b.getRows() << endl;
+		return 1;
+	}
+
+	// every hardware thread, the comparison only reads memory
+	Image mask(maskFile.empty() ? 0 : a.getRows(), maskFile.empty() ? 0 : a.getCols());
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	DiffReport report = diffImages(a, b, maskFile.empty() ? nullptr : &mask, 0);
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+	if (report.differing == 0)
+		cout << "Images are identical" << endl;
+	else
 	{
-		red += it.getData().red;
-		green += it.getData().green;
-		blue += it.getData().blue;
-		it++;
+		cout << "Differing pixels: " << report.differing << " ("
+			<< 100.0 * report.differing / ((double)a.getRows() * a.getCols()) << "%)" << endl;
+		cout << "Bounding box: rows " << report.top << "-" << report.bottom
+			<< ", columns " << report.left << "-" << report.right << endl;
+		cout << "Channel error: max " << report.maxError << ", mean " << report.meanError << endl;
 	}
-	red /= c.getSize();
-	green /= c.getSize();
-	blue /= c.getSize();
+	cout << "Comparison took " << elapsed.count() << " ms" << endl;
 
+	if (!maskFile.empty() && !mask.writeToDisk(maskFile))
+		return 1;
+	return report.differing == 0 ? 0 : 1;
+}
 
-	// Iterate through the container again
-	Container::Iterator it2 = Container::Iterator(c);
-	while (!it2.atEnd())
+/*	parses a list of image sizes
+	@param	megapixels separated by commas
+	@param	sizes to fill in
+	@pre	none
+	@post	sizes holds every size of list, false is returned if a size is
+			not a positive number	*/
+bool parseSizes(const string& list, vector<int>& sizes)
+{
+	sizes.clear();
+	size_t start = 0;
+	while (start <= list.size())
 	{
-		PixelData pixel = it2.getData();
+		size_t end = list.find(',', start);
+		if (end == string::npos)
+			end = list.size();
+		int size = atoi(list.substr(start, end - start).c_str());
+		if (size <= 0)
+			return false;
+		sizes.push_back(size);
+		start = end + 1;
+	}
+	return !sizes.empty();
+}
 
-		// Set the color at row, col equal to the average
-		out.setPixelColor(pixel.row, pixel.col, "red", red);
-		out.setPixelColor(pixel.row, pixel.col, "green", green);
-		out.setPixelColor(pixel.row, pixel.col, "blue", blue);
-		it2++;
+/*	prints a summary of a segmentation
+	@param	statistics of every segment
+	@pre	none
+	@post	segment count, pixel count, average color, largest segment and
+			number of fragments are written to the console	*/
+void printSummary(const vector<SegmentStats>& stats)
+{
+	// Totals over the whole image come straight from the segment statistics
+	SegmentStats total = totalStats(stats);
+	long long largest = 0;
+	int fragments = 0;
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		if (stats[i].count > largest)
+			largest = stats[i].count;
+		if (stats[i].count < FRAGMENT_SIZE)
+			fragments++;
 	}
+
+	cout << "Total number of segments found: " << stats.size() << endl;
+	cout << "Total number of pixels segmented: " << total.count << endl;
+	if (total.count == 0)
+		return;
+	pixel average = total.average();
+	cout << "Average color of the image: " << (int)average.red << "R, " << (int)average.green << "G, "
+		<< (int)average.blue << "B" << endl;
+	cout << "Largest segment: " << largest << " pixels" << endl;
+	cout << "Fragments under " << FRAGMENT_SIZE << " pixels: " << fragments << endl;
 }
 
-/*	calculates absolute value
-	@param	number to calculate
+/*	prints the command line options
 	@pre	none
-	@post	return absolute value of input */
-int av(int num)
+	@post	usage is written to the console	*/
+void printUsage()
 {
-	if (num < 0)
-		return num * -1;
-	return num;
-}
\ No newline at end of file
+	cout << "Usage: ImageSegmentation [options] [files or patterns...]" << endl
+		<< "  -list file     read more inputs from file, one per line" << endl
+		<< "  -out dir       write the segmented images to dir" << endl
+		<< "  -threshold n   color distance two pixels must be below to join (default 100)" << endl
+		<< "  -metric name   color distance: l1, l2, chebyshev, weighted or lab (default l1)" << endl
+		<< "  -weights r,g,b channel weights of the weighted metric (default 3,6,1)" << endl
+		<< "  -jobs n        images processed at once, 0 for every hardware thread (default 0)" << endl
+		<< "  -maxmem MB     image data held in flight by all jobs (default no limit)" << endl
+		<< "  -rawsize WxH   size of every .raw/.rgb input, .ppm and raw inputs are" << endl
+		<< "                 memory-mapped and written as mapped files of the same format" << endl
+		<< "  -stream rows   segment .ppm/.raw/.rgb inputs a band of rows at a time, like" << endl
+		<< "                 -unionfind but without holding the image in memory" << endl
+		<< "  -crop WxH+X+Y  segment only the W by H rectangle at column X, row Y of every input" << endl
+		<< "  -transform name flip, rotate or transpose every input (after -crop) before" << endl
+		<< "                 segmenting: fliph, flipv, rotate90, rotate180, rotate270, transpose" << endl
+		<< "  -threads n     threads to label one image on in union-find mode (default 1)" << endl
+		<< "  -unionfind     segment with union-find instead of flood fill" << endl
+		<< "  -pyramid n     union-find coarse to fine, labeling flat blocks of up to 2^n pixels" << endl
+		<< "                 square whole; the labels are the same as -unionfind" << endl
+		<< "  -runs          union-find over runs of similar pixels in a row, painting a run at" << endl
+		<< "                 a time; the labels are the same as -unionfind" << endl
+		<< "  -mean          grow flood fill regions by their running mean instead of the seed" << endl
+		<< "  -minregion n   merge segments under n pixels into their closest neighbour" << endl
+		<< "  -merge n       merge neighbouring segments whose mean colors are closer than n" << endl
+		<< "                 (in the metric's units)" << endl
+		<< "  -stats         write the segment statistics of every image to a CSV" << endl
+		<< "  -labels        write the label map and region adjacency graph of every" << endl
+		<< "                 image to a binary .seg file beside its output" << endl
+		<< "  -compare a b   compare two images, exits with 1 if they differ" << endl
+		<< "  -diffmask file write the pixels -compare found different to file, white" << endl
+		<< "  -kernel name   color distance kernel: avx2, ssse3, scalar or auto (default auto)" << endl
+		<< "  -benchmark n   time every metric n times on img.gif or the first input" << endl
+		<< "  -trace file    write the profile in Chrome trace format (make PROFILE=1 builds)" << endl
+		<< "  -suite sizes   run the benchmark suite on synthetic images of the given" << endl
+		<< "                 megapixels (e.g. 1,16,100), JSON results go to the console" << endl
+		<< "Without inputs img.gif is segmented into output.gif" << endl;
+}
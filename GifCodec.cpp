@@ -0,0 +1,688 @@
+/*	GifCodec.cpp
+	Jayden Fullerton
+
+	This file contains a GIF decoder and encoder that replace the prebuilt
+	ImageLib library. The decoder reads the file header first so the caller
+	can size its own buffer, then decodes the first frame's LZW stream
+	straight into the caller's rows. The encoder builds a palette (exact when
+	the image has 256 colors or fewer, otherwise a fast popularity palette
+	over a 15-bit color histogram) and LZW compresses the pixels with a
+	hash table dictionary, mapping each pixel to its palette index as it
+	goes so no index buffer is ever allocated.	*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "GifCodec.h"
+
+// Largest LZW code in a GIF, codes are at most 12 bits
+static const int MAX_CODES = 4096;
+
+/*	reads a little endian 16-bit value
+	@pre	p must point to two bytes
+	@post	the value is returned	*/
+static int readShort(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/*	Decoder helper that reads LZW codes of a given width from the data
+	sub-blocks of an image, crossing block boundaries as needed.	*/
+class CodeReader
+{
+	const std::vector<unsigned char>& data;
+	size_t& pos;
+	int blockLeft;
+	unsigned int bits;
+	int bitCount;
+	bool ended;
+public:
+	CodeReader(const std::vector<unsigned char>& data, size_t& pos) : data(data), pos(pos)
+	{
+		blockLeft = 0;
+		bits = 0;
+		bitCount = 0;
+		ended = false;
+	}
+
+	/*	reads one code
+		@param	width of the code in bits
+		@pre	none
+		@post	the code is returned, -1 if the data ran out	*/
+	int read(int size)
+	{
+		while (bitCount < size)
+		{
+			if (blockLeft == 0)
+			{
+				if (ended || pos >= data.size() || data[pos] == 0)
+				{
+					ended = true;
+					return -1;
+				}
+				blockLeft = data[pos++];
+			}
+			if (pos >= data.size())
+			{
+				ended = true;
+				return -1;
+			}
+			bits |= (unsigned int)data[pos++] << bitCount;
+			bitCount += 8;
+			blockLeft--;
+		}
+		int code = bits & ((1 << size) - 1);
+		bits >>= size;
+		bitCount -= size;
+		return code;
+	}
+
+	/*	moves past the rest of the image data
+		@pre	none
+		@post	pos is after the image's terminating zero length block	*/
+	void finish()
+	{
+		pos += blockLeft;
+		while (pos < data.size() && data[pos] != 0)
+			pos += data[pos] + 1;
+		if (pos < data.size())
+			pos++;
+	}
+};
+
+/*	GifReader constructor
+	@param	name of the GIF file
+	@pre	none
+	@post	the file is loaded and its header read, isValid() tells if
+			the file is a GIF	*/
+GifReader::GifReader(const std::string& filename)
+{
+	pos = 0;
+	rows = cols = 0;
+	globalColors = 0;
+	background = 0;
+	valid = false;
+
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (file == nullptr)
+		return;
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (length > 0)
+	{
+		data.resize(length);
+		if (fread(data.data(), 1, length, file) != (size_t)length)
+			data.clear();
+	}
+	fclose(file);
+	readHeader();
+}
+
+/*	reads the header and logical screen descriptor
+	@pre	data holds the file
+	@post	rows, cols and the global palette are read, valid is set	*/
+void GifReader::readHeader()
+{
+	if (data.size() < 13 || memcmp(data.data(), "GIF8", 4) != 0 ||
+		(data[4] != '7' && data[4] != '9') || data[5] != 'a')
+		return;
+	cols = readShort(&data[6]);
+	rows = readShort(&data[8]);
+	int packed = data[10];
+	background = data[11];
+	pos = 13;
+	if (packed & 0x80)
+	{
+		globalColors = 1 << ((packed & 7) + 1);
+		if (!readPalette(globalPalette, globalColors))
+			return;
+	}
+	valid = rows > 0 && cols > 0;
+}
+
+/*	reads a color table
+	@param	palette to read into
+	@param	number of colors in the table
+	@pre	pos is at the first entry of the table
+	@post	palette holds the colors, false is returned if the file is too short	*/
+bool GifReader::readPalette(pixel* palette, int colors)
+{
+	if (pos + 3 * colors > data.size())
+		return false;
+	for (int i = 0; i < colors; i++)
+	{
+		palette[i].red = data[pos++];
+		palette[i].green = data[pos++];
+		palette[i].blue = data[pos++];
+	}
+	return true;
+}
+
+/*	skips a run of data sub-blocks
+	@pre	pos is at the first sub-block's length byte
+	@post	pos is after the terminating zero length block	*/
+void GifReader::skipSubBlocks()
+{
+	while (pos < data.size() && data[pos] != 0)
+		pos += data[pos] + 1;
+	pos++;
+}
+
+/*	is the file a readable GIF
+	@pre	none
+	@post	true is returned if the header was read successfully	*/
+bool GifReader::isValid() const
+{
+	return valid;
+}
+
+/*	returns the height of the image
+	@pre	isValid() must be true
+	@post	number of rows is returned	*/
+int GifReader::getRows() const
+{
+	return rows;
+}
+
+/*	returns the width of the image
+	@pre	isValid() must be true
+	@post	number of columns is returned	*/
+int GifReader::getCols() const
+{
+	return cols;
+}
+
+/*	decodes the first frame of the GIF
+	@param	pointer to the first pixel of every row of the destination
+	@pre	isValid() must be true, rowPointers must hold getRows() rows of
+			getCols() pixels each
+	@post	every row is filled with the image, pixels outside the frame
+			are the background color. false is returned if the file is
+			corrupt, rows decoded before the error are kept	*/
+bool GifReader::read(pixel* const* rowPointers)
+{
+	// Pixels the frame does not cover are the background color
+	pixel fill = { 0, 0, 0 };
+	if (background < globalColors)
+		fill = globalPalette[background];
+	for (int row = 0; row < rows; row++)
+	{
+		for (int col = 0; col < cols; col++)
+			rowPointers[row][col] = fill;
+	}
+
+	// Skip extensions until the first image descriptor
+	while (pos < data.size() && data[pos] != 0x2C)
+	{
+		if (data[pos] == 0x21 && pos + 1 < data.size())
+		{
+			pos += 2;
+			skipSubBlocks();
+		}
+		else
+			return false; // trailer or garbage before any image
+	}
+	if (pos + 10 > data.size())
+		return false;
+
+	int left = readShort(&data[pos + 1]);
+	int top = readShort(&data[pos + 3]);
+	int width = readShort(&data[pos + 5]);
+	int height = readShort(&data[pos + 7]);
+	int packed = data[pos + 9];
+	pos += 10;
+
+	pixel localPalette[256];
+	const pixel* palette = globalPalette;
+	int colors = globalColors;
+	if (packed & 0x80)
+	{
+		colors = 1 << ((packed & 7) + 1);
+		if (!readPalette(localPalette, colors))
+			return false;
+		palette = localPalette;
+	}
+	bool interlaced = (packed & 0x40) != 0;
+
+	if (pos >= data.size())
+		return false;
+	int minCodeSize = data[pos++];
+	if (minCodeSize < 2 || minCodeSize > 8)
+		return false;
+
+	// Interlaced images store every 8th row from 0, every 8th from 4,
+	// every 4th from 2 and then every 2nd from 1
+	static const int passStart[4] = { 0, 4, 2, 1 };
+	static const int passStep[4] = { 8, 8, 4, 2 };
+	int pass = 0;
+	int y = 0;	// row within the frame
+	int x = 0;	// column within the frame
+
+	// LZW dictionary: a code is its prefix code followed by its suffix byte
+	unsigned short prefix[MAX_CODES];
+	unsigned char suffix[MAX_CODES];
+	unsigned char stack[MAX_CODES + 1];
+	int clear = 1 << minCodeSize;
+	int endOfInfo = clear + 1;
+	for (int i = 0; i < clear; i++)
+	{
+		prefix[i] = 0;
+		suffix[i] = (unsigned char)i;
+	}
+	int codeSize = minCodeSize + 1;
+	int next = clear + 2;
+	int prev = -1;
+	int firstByte = 0;
+
+	CodeReader reader(data, pos);
+	bool complete = false;
+	while (y < height)
+	{
+		int code = reader.read(codeSize);
+		if (code < 0)
+			break;
+		if (code == clear)
+		{
+			codeSize = minCodeSize + 1;
+			next = clear + 2;
+			prev = -1;
+			continue;
+		}
+		if (code == endOfInfo)
+			break;
+
+		// Unpack the code's bytes onto the stack, last byte first
+		int sp = 0;
+		if (prev < 0)
+		{
+			if (code >= clear)
+				break; // corrupt, first code must be a literal
+			stack[sp++] = (unsigned char)code;
+			firstByte = code;
+		}
+		else
+		{
+			int in = code;
+			if (code > next)
+				break; // corrupt
+			if (code == next)
+			{
+				// the code being defined is prev + first byte of prev
+				stack[sp++] = (unsigned char)firstByte;
+				code = prev;
+			}
+			while (code >= clear)
+			{
+				stack[sp++] = suffix[code];
+				code = prefix[code];
+			}
+			firstByte = code;
+			stack[sp++] = (unsigned char)firstByte;
+
+			if (next < MAX_CODES)
+			{
+				prefix[next] = (unsigned short)prev;
+				suffix[next] = (unsigned char)firstByte;
+				next++;
+				if (next == (1 << codeSize) && codeSize < 12)
+					codeSize++;
+			}
+			code = in;
+		}
+		prev = code;
+
+		// Write the bytes straight into the destination rows
+		while (sp > 0 && y < height)
+		{
+			int index = stack[--sp];
+			int row = top + (interlaced ? passStart[pass] + y * passStep[pass] : y);
+			int col = left + x;
+			if (row < rows && col < cols && index < colors)
+				rowPointers[row][col] = palette[index];
+			if (++x == width)
+			{
+				x = 0;
+				y++;
+				// move to the next interlace pass once this one runs off the frame
+				while (interlaced && pass < 4 && passStart[pass] + y * passStep[pass] >= height)
+				{
+					pass++;
+					y = 0;
+					if (pass == 4)
+						y = height;
+				}
+			}
+		}
+	}
+	complete = y >= height;
+	reader.finish();
+	return complete;
+}
+
+/*	Encoder helper that maps a pixel to its palette index. Images with 256
+	colors or fewer get an exact palette looked up through a small hash
+	table, others get the 256 most common 15-bit colors and a table from
+	every 15-bit color to its nearest palette entry.	*/
+class Palette
+{
+	static const int HASH_SIZE = 1024;	// power of two, 4x the colors it holds
+
+	int hashKey[HASH_SIZE];
+	unsigned char hashIndex[HASH_SIZE];
+	std::vector<unsigned char> nearest;	// 15-bit color to index when quantized
+	int lastKey;
+	int lastIndex;
+
+	static int key(const pixel& p)
+	{
+		return (p.red << 16) | (p.green << 8) | p.blue;
+	}
+
+	static int key15(const pixel& p)
+	{
+		return ((p.red >> 3) << 10) | ((p.green >> 3) << 5) | (p.blue >> 3);
+	}
+
+	/*	adds an exact color
+		@pre	colors must be less than 256
+		@post	false is returned if the color was already present	*/
+	bool insert(int k)
+	{
+		int h = (k * 2654435761u) >> 22 & (HASH_SIZE - 1);
+		while (hashKey[h] >= 0)
+		{
+			if (hashKey[h] == k)
+				return false;
+			h = (h + 1) & (HASH_SIZE - 1);
+		}
+		hashKey[h] = k;
+		hashIndex[h] = (unsigned char)size;
+		colors[size].red = (byte)(k >> 16);
+		colors[size].green = (byte)(k >> 8);
+		colors[size].blue = (byte)k;
+		size++;
+		return true;
+	}
+
+	/*	builds a popularity palette over a 15-bit histogram
+		@pre	none
+		@post	colors holds up to 256 colors and nearest maps every
+				15-bit color that occurs to its closest entry	*/
+	void quantize(const pixel* const* rowPointers, int rows, int cols)
+	{
+		std::vector<long long> count(1 << 15, 0), red(1 << 15, 0), green(1 << 15, 0), blue(1 << 15, 0);
+		for (int row = 0; row < rows; row++)
+		{
+			for (int col = 0; col < cols; col++)
+			{
+				const pixel& p = rowPointers[row][col];
+				int k = key15(p);
+				count[k]++;
+				red[k] += p.red;
+				green[k] += p.green;
+				blue[k] += p.blue;
+			}
+		}
+
+		std::vector<int> bins;
+		for (int k = 0; k < (1 << 15); k++)
+		{
+			if (count[k] > 0)
+				bins.push_back(k);
+		}
+		size_t keep = std::min<size_t>(256, bins.size());
+		std::partial_sort(bins.begin(), bins.begin() + keep, bins.end(),
+			[&count](int a, int b) { return count[a] > count[b]; });
+		size = (int)keep;
+		for (int i = 0; i < size; i++)
+		{
+			int k = bins[i];
+			colors[i].red = (byte)(red[k] / count[k]);
+			colors[i].green = (byte)(green[k] / count[k]);
+			colors[i].blue = (byte)(blue[k] / count[k]);
+		}
+
+		nearest.assign(1 << 15, 0);
+		for (size_t b = 0; b < bins.size(); b++)
+		{
+			int k = bins[b];
+			int r = (int)(red[k] / count[k]);
+			int g = (int)(green[k] / count[k]);
+			int bl = (int)(blue[k] / count[k]);
+			int best = 0;
+			int bestDistance = 1 << 30;
+			for (int i = 0; i < size; i++)
+			{
+				int dr = r - colors[i].red;
+				int dg = g - colors[i].green;
+				int db = bl - colors[i].blue;
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = i;
+				}
+			}
+			nearest[k] = (unsigned char)best;
+		}
+	}
+public:
+	pixel colors[256];
+	int size;
+
+	Palette(const pixel* const* rowPointers, int rows, int cols)
+	{
+		size = 0;
+		lastKey = -1;
+		lastIndex = 0;
+		for (int i = 0; i < HASH_SIZE; i++)
+			hashKey[i] = -1;
+
+		// Try for an exact palette first, segmented images rarely need more
+		for (int row = 0; row < rows; row++)
+		{
+			for (int col = 0; col < cols; col++)
+			{
+				int k = key(rowPointers[row][col]);
+				if (k == lastKey)
+					continue;
+				lastKey = k;
+				if (size == 256)
+				{
+					if (lookupExact(k) >= 0)
+						continue;
+					quantize(rowPointers, rows, cols);
+					lastKey = -1;
+					return;
+				}
+				insert(k);
+			}
+		}
+		lastKey = -1;
+	}
+
+	int lookupExact(int k) const
+	{
+		int h = (k * 2654435761u) >> 22 & (HASH_SIZE - 1);
+		while (hashKey[h] >= 0)
+		{
+			if (hashKey[h] == k)
+				return hashIndex[h];
+			h = (h + 1) & (HASH_SIZE - 1);
+		}
+		return -1;
+	}
+
+	/*	returns the palette index of a pixel
+		@pre	p must be from the image the palette was built for
+		@post	index of p's color or its nearest color is returned	*/
+	int indexOf(const pixel& p)
+	{
+		if (!nearest.empty())
+			return nearest[key15(p)];
+		int k = key(p);
+		if (k != lastKey)
+		{
+			lastKey = k;
+			lastIndex = lookupExact(k);
+		}
+		return lastIndex;
+	}
+};
+
+/*	Encoder helper that packs codes LSB first into 255 byte sub-blocks	*/
+class CodeWriter
+{
+	FILE* file;
+	unsigned char block[256];
+	int blockSize;
+	unsigned int bits;
+	int bitCount;
+
+	void flushBlock()
+	{
+		if (blockSize == 0)
+			return;
+		fputc(blockSize, file);
+		fwrite(block, 1, blockSize, file);
+		blockSize = 0;
+	}
+public:
+	CodeWriter(FILE* file)
+	{
+		this->file = file;
+		blockSize = 0;
+		bits = 0;
+		bitCount = 0;
+	}
+
+	void write(int code, int size)
+	{
+		bits |= (unsigned int)code << bitCount;
+		bitCount += size;
+		while (bitCount >= 8)
+		{
+			block[blockSize++] = (unsigned char)bits;
+			bits >>= 8;
+			bitCount -= 8;
+			if (blockSize == 255)
+				flushBlock();
+		}
+	}
+
+	void finish()
+	{
+		if (bitCount > 0)
+			block[blockSize++] = (unsigned char)bits;
+		bits = 0;
+		bitCount = 0;
+		flushBlock();
+		fputc(0, file); // block terminator
+	}
+};
+
+/*	encodes an image as a GIF file
+	@param	name of the file to write
+	@param	pointer to the first pixel of every row of the image
+	@param	number of rows
+	@param	number of columns
+	@pre	rowPointers must hold rows rows of cols pixels each
+	@post	the image is written to filename, colors are quantized to 256 if
+			there are more. false is returned if the file could not be
+			written or the image is too large for a GIF	*/
+bool writeGif(const std::string& filename, const pixel* const* rowPointers, int rows, int cols)
+{
+	if (rows <= 0 || cols <= 0 || rows > 0xFFFF || cols > 0xFFFF)
+		return false;
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+
+	Palette palette(rowPointers, rows, cols);
+	int depth = 1;
+	while ((1 << depth) < palette.size)
+		depth++;
+
+	// Header, logical screen descriptor and global color table
+	unsigned char header[13] = { 'G', 'I', 'F', '8', '9', 'a',
+		(unsigned char)cols, (unsigned char)(cols >> 8),
+		(unsigned char)rows, (unsigned char)(rows >> 8),
+		(unsigned char)(0x80 | ((depth - 1) << 4) | (depth - 1)), 0, 0 };
+	fwrite(header, 1, sizeof(header), file);
+	for (int i = 0; i < (1 << depth); i++)
+	{
+		pixel p = { 0, 0, 0 };
+		if (i < palette.size)
+			p = palette.colors[i];
+		fputc(p.red, file);
+		fputc(p.green, file);
+		fputc(p.blue, file);
+	}
+
+	// Image descriptor covering the whole screen, no local table
+	unsigned char descriptor[10] = { 0x2C, 0, 0, 0, 0,
+		(unsigned char)cols, (unsigned char)(cols >> 8),
+		(unsigned char)rows, (unsigned char)(rows >> 8), 0 };
+	fwrite(descriptor, 1, sizeof(descriptor), file);
+
+	// LZW compress the palette indices. The dictionary is an open addressing
+	// hash table from (prefix code, next index) to code
+	int minCodeSize = depth < 2 ? 2 : depth;
+	fputc(minCodeSize, file);
+	const int HASH_SIZE = 5003; // prime, about 1.2x the codes it holds
+	std::vector<int> hashKey(HASH_SIZE, -1);
+	std::vector<unsigned short> hashCode(HASH_SIZE);
+	int clear = 1 << minCodeSize;
+	int endOfInfo = clear + 1;
+	int codeSize = minCodeSize + 1;
+	int next = clear + 2;
+
+	CodeWriter writer(file);
+	writer.write(clear, codeSize);
+	int prefix = palette.indexOf(rowPointers[0][0]);
+	for (int row = 0; row < rows; row++)
+	{
+		const pixel* line = rowPointers[row];
+		for (int col = (row == 0 ? 1 : 0); col < cols; col++)
+		{
+			int index = palette.indexOf(line[col]);
+			int k = (prefix << 8) | index;
+			int h = ((index << 4) ^ prefix) % HASH_SIZE;
+			while (hashKey[h] >= 0 && hashKey[h] != k)
+				h = (h + 1) % HASH_SIZE;
+			if (hashKey[h] == k)
+			{
+				prefix = hashCode[h]; // the string so far is still in the dictionary
+				continue;
+			}
+
+			writer.write(prefix, codeSize);
+			if (next < MAX_CODES)
+			{
+				hashKey[h] = k;
+				hashCode[h] = (unsigned short)next++;
+				// the decoder defines codes one step behind us, so widen
+				// once it will have seen a code that needs the extra bit
+				if (next > (1 << codeSize) && codeSize < 12)
+					codeSize++;
+			}
+			else
+			{
+				// dictionary full, start over
+				writer.write(clear, codeSize);
+				std::fill(hashKey.begin(), hashKey.end(), -1);
+				codeSize = minCodeSize + 1;
+				next = clear + 2;
+			}
+			prefix = index;
+		}
+	}
+	writer.write(prefix, codeSize);
+	writer.write(endOfInfo, codeSize);
+	writer.finish();
+
+	fputc(0x3B, file); // trailer
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
@@ -0,0 +1,86 @@
+/*	GifCodec.h
+	Jayden Fullerton
+
+	This file contains a GIF decoder and encoder that replace the prebuilt
+	ImageLib library. The decoder reads the file header first so the caller
+	can size its own buffer, then decodes the first frame's LZW stream
+	straight into the caller's rows. The encoder builds a palette (exact when
+	the image has 256 colors or fewer, otherwise a fast popularity palette
+	over a 15-bit color histogram) and LZW compresses the pixels with a
+	hash table dictionary, mapping each pixel to its palette index as it
+	goes so no index buffer is ever allocated.	*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ImageLib.h"
+
+class GifReader
+{
+	/*	reads the header and logical screen descriptor
+		@pre	data holds the file
+		@post	rows, cols and the global palette are read, valid is set	*/
+	void readHeader();
+
+	/*	skips a run of data sub-blocks
+		@pre	pos is at the first sub-block's length byte
+		@post	pos is after the terminating zero length block	*/
+	void skipSubBlocks();
+
+	/*	reads a color table
+		@param	palette to read into
+		@param	number of colors in the table
+		@pre	pos is at the first entry of the table
+		@post	palette holds the colors, false is returned if the file is too short	*/
+	bool readPalette(pixel* palette, int colors);
+
+	std::vector<unsigned char> data;
+	size_t pos;
+	int rows, cols;
+	pixel globalPalette[256];
+	int globalColors;
+	int background;
+	bool valid;
+public:
+	/*	GifReader constructor
+		@param	name of the GIF file
+		@pre	none
+		@post	the file is loaded and its header read, isValid() tells if
+				the file is a GIF	*/
+	GifReader(const std::string& filename);
+
+	/*	is the file a readable GIF
+		@pre	none
+		@post	true is returned if the header was read successfully	*/
+	bool isValid() const;
+
+	/*	returns the height of the image
+		@pre	isValid() must be true
+		@post	number of rows is returned	*/
+	int getRows() const;
+
+	/*	returns the width of the image
+		@pre	isValid() must be true
+		@post	number of columns is returned	*/
+	int getCols() const;
+
+	/*	decodes the first frame of the GIF
+		@param	pointer to the first pixel of every row of the destination
+		@pre	isValid() must be true, rowPointers must hold getRows() rows of
+				getCols() pixels each
+		@post	every row is filled with the image, pixels outside the frame
+				are the background color. false is returned if the file is
+				corrupt, rows decoded before the error are kept	*/
+	bool read(pixel* const* rowPointers);
+};
+
+/*	encodes an image as a GIF file
+	@param	name of the file to write
+	@param	pointer to the first pixel of every row of the image
+	@param	number of rows
+	@param	number of columns
+	@pre	rowPointers must hold rows rows of cols pixels each
+	@post	the image is written to filename, colors are quantized to 256 if
+			there are more. false is returned if the file could not be
+			written or the image is too large for a GIF	*/
+bool writeGif(const std::string& filename, const pixel* const* rowPointers, int rows, int cols);
@@ -3,9 +3,78 @@
 // Info:	This class stores an image that is
 //			represented as an array of pixels
 //			with individual red green blue values
-//			for each pixel using the ImageLib
-//			library.
+//			for each pixel. Pixels are kept in one
+//			contiguous 64-byte aligned buffer with
+//			a fixed row stride. GIFs are decoded
+//			straight into the buffer and encoded
+//			from it by GifCodec.
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "Allocations.h"
 #include "Image.h"
+#include "ImageDiff.h"
+#include "Profile.h"
+#include "Transform.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Alignment of the pixel buffer and of the start of every row, in bytes
+static const int ALIGNMENT = 64;
+
+// Rows are padded to a multiple of this many pixels so that every row
+// starts on an ALIGNMENT boundary (64 pixels * 3 bytes = 3 cache lines)
+static const int STRIDE_PIXELS = 64;
+
+// Images with at least this many pixels are compared on every hardware
+// thread, smaller ones finish before the threads would start
+static const long long PARALLEL_COMPARE_PIXELS = 4 * 1024 * 1024;
+
+// void* alignedAlloc(size_t bytes)
+// Allocates memory aligned to ALIGNMENT bytes
+// Preconditions:	bytes must be greater than 0
+// Postconditions:	pointer to the memory is returned, nullptr if out of memory
+static void* alignedAlloc(size_t bytes)
+{
+	noteAllocation(bytes); // counted here since it bypasses operator new
+#ifdef _WIN32
+	return _aligned_malloc(bytes, ALIGNMENT);
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, ALIGNMENT, bytes) != 0)
+		return nullptr;
+	return p;
+#endif
+}
+
+// void alignedFree(void* p)
+// Frees memory from alignedAlloc
+// Preconditions:	p must be from alignedAlloc or nullptr
+// Postconditions:	memory is freed
+static void alignedFree(void* p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+// Channel toChannel(const string& color)
+// Converts a color name to a channel
+// Preconditions:	none
+// Postconditions:	Red for "red", Blue for "blue", Green otherwise
+static Channel toChannel(const string& color)
+{
+	if (color == "red")
+		return Channel::Red;
+	if (color == "blue")
+		return Channel::Blue;
+	return Channel::Green;
+}
 
 // Image(string filename)
 // Constructs an Image object based on a filename
@@ -13,11 +82,23 @@
 // Postconditions:	Image object will be created based on GIF file
 Image::Image(string filename)
 {
-	thisImage = ReadGIF(filename);
-	if (thisImage.rows == 0)
+	GifReader reader(filename);
+	decode(reader);
+	if (rows == 0)
 		cout << "Invalid filename, please try again.";
 }
 
+// Image(GifReader& reader)
+// Constructs an Image object from a GIF whose header has already been read,
+// so a caller can check the size of an image before decoding it
+// Preconditions:	none
+// Postconditions:	Image object will be created based on the GIF, or 0 by 0
+//					if the GIF is invalid
+Image::Image(GifReader& reader)
+{
+	decode(reader);
+}
+
 // Image(int rows, int cols)
 // Constructs an Image object with all black pixels with rows rows and cols columns
 // Preconditions:	rows and cols must be greater than 0
@@ -25,7 +106,24 @@ Image::Image(string filename)
 //					and cols columns
 Image::Image(int rows, int cols)
 {
-	thisImage = CreateImage(rows, cols);
+	allocate(rows, cols);
+}
+
+// Image(const shared_ptr<MappedFile>& file, size_t offset, int rows, int cols)
+// Constructs an Image object that is a view over packed RGB pixels in a
+// mapped file, the pixels are used where they are and the file is kept
+// mapped for as long as the Image uses it
+// Preconditions:	file must be valid and hold rows * cols pixels from offset
+// Postconditions:	Image object will be created with the pixels of the file,
+//					writes to it go wherever the file's mapping sends them
+Image::Image(const shared_ptr<MappedFile>& file, size_t offset, int rows, int cols)
+{
+	// pixel is 3 packed bytes, so the file's rows can be used unpadded
+	this->rows = rows;
+	this->cols = cols;
+	stride = cols;
+	pixels = (pixel*)(file->getData() + offset);
+	mapping = file;
 }
 
 // Image(const Image& img)
@@ -34,7 +132,23 @@ Image::Image(int rows, int cols)
 // Postconditions:	copy is created of img
 Image::Image(const Image& img)
 {
-	thisImage = CopyImage(img.thisImage);
+	allocate(img.rows, img.cols);
+	copyPixels(img);
+}
+
+// Image(Image&& img)
+// Move constructor for Image class, takes img's buffer without copying it
+// Preconditions:	none (compiler calls automatically when neccessary)
+// Postconditions:	this holds img's pixels, img is 0 by 0
+Image::Image(Image&& img) noexcept
+{
+	rows = img.rows;
+	cols = img.cols;
+	stride = img.stride;
+	pixels = img.pixels;
+	mapping = std::move(img.mapping);
+	img.pixels = nullptr;
+	img.rows = img.cols = img.stride = 0;
 }
 
 // ~Image
@@ -43,19 +157,47 @@ Image::Image(const Image& img)
 // Postconditions:	memory is deallocated from the current Image object (this)
 Image::~Image()
 {
-	DeallocateImage(thisImage);
+	deallocate();
 }
 
 // =
 // Overloads the assignment operator
 // Preconditions:	right operand must be an Image object
-// Postconditions:	left operand now points to the same memory address as the right operand
+// Postconditions:	left operand is a copy of the right operand, its buffer is
+//					reused if the dimensions match
 const Image& Image::operator=(const Image& img)
 {
-	if (*this != img)
+	// comparing addresses is enough, comparing the pixels would cost as
+	// much as copying them
+	if (this != &img)
 	{
-		DeallocateImage(thisImage);
-		thisImage = CopyImage(img.thisImage);
+		if (rows != img.rows || cols != img.cols)
+		{
+			deallocate();
+			allocate(img.rows, img.cols);
+		}
+		copyPixels(img);
+	}
+	return *this;
+}
+
+// =
+// Overloads the move assignment operator
+// Preconditions:	right operand must be an Image object
+// Postconditions:	left operand frees its buffer and takes the right operand's,
+//					the right operand is 0 by 0, unless it is self-assignment
+Image& Image::operator=(Image&& img) noexcept
+{
+	if (this != &img)
+	{
+		deallocate();
+		rows = img.rows;
+		cols = img.cols;
+		stride = img.stride;
+		pixels = img.pixels;
+		mapping = std::move(img.mapping);
+		img.pixels = nullptr;
+		img.rows = img.cols = img.stride = 0;
 	}
 	return *this;
 }
@@ -66,7 +208,7 @@ const Image& Image::operator=(const Image& img)
 // Postconditions:	number of rows in the Image is returned
 int Image::getRows() const
 {
-	return thisImage.rows;
+	return rows;
 }
 
 // int getCols() const
@@ -75,7 +217,7 @@ int Image::getRows() const
 // Postconditions:	number of columns in the Image is returned
 int Image::getCols() const
 {
-	return thisImage.cols;
+	return cols;
 }
 
 // int getPixelColor(int row, int col, string color) const
@@ -84,11 +226,7 @@ int Image::getCols() const
 // Postconditions:	returns the value of the color on the pixel requested
 int Image::getPixelColor(int row, int col, string color) const
 {
-	if (color == "red")
-		return thisImage.pixels[row][col].red;
-	if (color == "blue")
-		return thisImage.pixels[row][col].blue;
-	return thisImage.pixels[row][col].green;
+	return getChannel(row, col, toChannel(color));
 }
 
 // void setPixelColor(int row, int col, string color, int val)
@@ -97,21 +235,23 @@ int Image::getPixelColor(int row, int col, string color) const
 // Postconditions:	pixel in the image is changed based on color and number provided
 void Image::setPixelColor(int row, int col, string color, int val)
 {
-	if (color == "red")
-		thisImage.pixels[row][col].red = val;
-	else if (color == "blue")
-		thisImage.pixels[row][col].blue = val;
-	else
-		thisImage.pixels[row][col].green = val;
+	setChannel(row, col, toChannel(color), (byte)val);
 }
 
 // void writeToDisk(const string filename) const
 // Writes current image to disk based on a specified file name
 // Preconditions:	none
-// Postconditions:	this Image object is written to the disk with the name filename
-void Image::writeToDisk(const string filename = "output.gif") const
+// Postconditions:	this Image object is written to the disk with the name filename,
+//					false is returned if it could not be written
+bool Image::writeToDisk(const string filename = "output.gif") const
 {
-	WriteGIF(filename, thisImage);
+	PROFILE_SCOPE("encode");
+	// The encoder only needs row pointers, so point them into our buffer
+	// instead of copying the pixels into an ImageLib image
+	std::vector<const pixel*> rowPointers(rows);
+	for (int row = 0; row < rows; row++)
+		rowPointers[row] = getRow(row);
+	return writeGif(filename, rowPointers.data(), rows, cols);
 }
 
 // ==
@@ -121,23 +261,8 @@ void Image::writeToDisk(const string filename = "output.gif") const
 // Postconditions:	true if all pixels are the same, otherwise false
 bool Image::operator==(const Image& img) const
 {
-	if (thisImage.cols != img.thisImage.cols ||
-		thisImage.rows != img.thisImage.rows)
-		return false;
-	for (int row = 0; row < thisImage.rows; row++)
-	{
-		for (int col = 0; col < thisImage.cols; col++) // nested loops to reach all pixels
-		{
-			if (!(thisImage.pixels[row][col].red == img.thisImage.pixels[row][col].red ||
-				thisImage.pixels[row][col].blue == img.thisImage.pixels[row][col].blue || 
-				thisImage.pixels[row][col].green == img.thisImage.pixels[row][col].green))
-				// if left and right operand's pixel at row and col are not the same
-			{
-				return false;
-			}
-		}
-	}
-	return true; // if it never returned false all pixels are the same
+	// rows are compared whole, in bands that stop as soon as one differs
+	return imagesEqual(*this, img, (long long)rows * cols >= PARALLEL_COMPARE_PIXELS ? 0 : 1);
 }
 
 // !=
@@ -156,7 +281,7 @@ bool Image::operator!=(const Image& img) const
 // Postconditions:	true if there are less pixels in the image, false otherwise
 bool Image::operator<(const Image& img) const
 {
-	return (thisImage.rows * thisImage.cols) < (img.thisImage.rows * img.thisImage.cols);
+	return (rows * cols) < (img.rows * img.cols);
 }
 
 // >
@@ -165,7 +290,7 @@ bool Image::operator<(const Image& img) const
 // Postconditions:	true if there are more pixels in the image, false otherwise
 bool Image::operator>(const Image& img) const
 {
-	return (thisImage.rows * thisImage.cols) > (img.thisImage.rows * img.thisImage.cols);
+	return (rows * cols) > (img.rows * img.cols);
 }
 
 // <<
@@ -175,39 +300,118 @@ bool Image::operator>(const Image& img) const
 //					"x rows y columns"
 ostream& operator<<(ostream& ostream, const Image& img)
 {
-	ostream << img.thisImage.rows << " rows by " << img.thisImage.cols << " columns. ("
-		<< img.thisImage.rows * img.thisImage.cols << " total pixels)";
+	ostream << img.rows << " rows by " << img.cols << " columns. ("
+		<< img.rows * img.cols << " total pixels)";
 	return ostream;
 }
 
-// const Image mirror()
+// Image mirror() const
 // Creates and returns a mirror image
 // Preconditions:	this must be a valid Image
 // Postconditions:	returns a new Image with left and right side reversed
-const Image Image::mirror()
+Image Image::mirror() const
+{
+	// each row is written reversed straight into the new image
+	return transformImage(*this, Transform::FlipHorizontal);
+}
+
+// void mirrorInPlace()
+// Mirrors this image without allocating
+// Preconditions:	this must be a valid Image
+// Postconditions:	left and right side of this Image are reversed
+void Image::mirrorInPlace()
+{
+	transformInPlace(*this, Transform::FlipHorizontal);
+}
+
+// int getStride() const
+// Gets the distance in pixels between the start of two consecutive rows
+// Preconditions:	none
+// Postconditions:	row stride of the pixel buffer is returned, at least getCols()
+int Image::getStride() const
+{
+	return stride;
+}
+
+// pixel* getData()
+// Gets a pointer to the start of the pixel buffer, row r starts at
+// getData() + r * getStride()
+// Preconditions:	none
+// Postconditions:	pointer to pixel (0, 0) is returned, nullptr if the image is empty
+pixel* Image::getData()
 {
-	Image img = *this; // copy constructor is called here
-	for (int row = 0; row < img.thisImage.rows; row++)
+	return pixels;
+}
+
+const pixel* Image::getData() const
+{
+	return pixels;
+}
+
+// void allocate(int rows, int cols)
+// Allocates a zeroed pixel buffer for the given dimensions
+// Preconditions:	rows and cols must be non-negative, no buffer is held
+// Postconditions:	rows, cols, stride and pixels describe a black image
+void Image::allocate(int rows, int cols)
+{
+	this->rows = rows;
+	this->cols = cols;
+	stride = (cols + STRIDE_PIXELS - 1) / STRIDE_PIXELS * STRIDE_PIXELS;
+	pixels = nullptr;
+	size_t bytes = (size_t)rows * stride * sizeof(pixel);
+	if (bytes > 0)
+		pixels = (pixel*)alignedAlloc(bytes);
+	if (pixels == nullptr) // empty image or out of memory, same as CreateImage
 	{
-		for (int col = 0; col < img.thisImage.cols / 2; col++)
-			// nested loops only reach the left side of the image because
-			// they will be swapped with the appropriate pixel on the right
-			// side of the image
-		{
-			swapPixel(img.thisImage.pixels[row][col], 
-				img.thisImage.pixels[row][img.thisImage.cols - col - 1]);
-		}
+		this->rows = this->cols = stride = 0;
+		return;
 	}
-	return img;
+	memset(pixels, 0, bytes);
 }
 
-// void swapPixel(pixel& p1, pixel& p2)
-// Swaps two pixels
-// Preconditions:	p1 and p2 must be valid pixels
-// Postconditions:	p1 and p2 are now swapped
-void Image::swapPixel(pixel& p1, pixel& p2)
+// void copyPixels(const Image& img)
+// Copies the pixels of an image of the same size
+// Preconditions:	img must have the same dimensions as this
+// Postconditions:	every pixel of this equals the pixel of img
+void Image::copyPixels(const Image& img)
 {
-	pixel temp = p1;
-	p1 = p2;
-	p2 = temp;
-}
\ No newline at end of file
+	if (pixels == nullptr)
+		return;
+	if (stride == img.stride) // one block, padding included
+	{
+		memcpy(pixels, img.pixels, (size_t)rows * stride * sizeof(pixel));
+		return;
+	}
+	for (int row = 0; row < rows; row++) // a view and a buffer are padded differently
+		memcpy(getRow(row), img.getRow(row), (size_t)cols * sizeof(pixel));
+}
+
+// void deallocate()
+// Frees the pixel buffer, or lets go of the mapped file of a view
+// Preconditions:	none
+// Postconditions:	the buffer is freed and the image is 0 by 0
+void Image::deallocate()
+{
+	if (mapping != nullptr)
+		mapping.reset();
+	else
+		alignedFree(pixels);
+	pixels = nullptr;
+	rows = cols = stride = 0;
+}
+
+// void decode(GifReader& reader)
+// Allocates the buffer and decodes a GIF into it
+// Preconditions:	no buffer is held
+// Postconditions:	this Image holds the GIF, or is 0 by 0 if it is invalid
+void Image::decode(GifReader& reader)
+{
+	PROFILE_SCOPE("decode");
+	// Decode straight into our own buffer rather than through ReadGIF
+	allocate(reader.isValid() ? reader.getRows() : 0, reader.isValid() ? reader.getCols() : 0);
+	std::vector<pixel*> rowPointers(rows);
+	for (int row = 0; row < rows; row++)
+		rowPointers[row] = getRow(row);
+	if (rows == 0 || !reader.read(rowPointers.data()))
+		deallocate();
+}
@@ -3,15 +3,32 @@
 // Info:	This class stores an image that is
 //			represented as an array of pixels
 //			with individual red green blue values
-//			for each pixel using the ImageLib
-//			library.
+//			for each pixel. Pixels are kept in one
+//			contiguous 64-byte aligned buffer with
+//			a fixed row stride. GIFs are decoded
+//			straight into the buffer and encoded
+//			from it by GifCodec. An Image can also
+//			be a view over a memory-mapped file of
+//			packed RGB pixels, which is neither
+//			copied nor decoded.
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <string>
+#include "GifCodec.h"
 #include "ImageLib.h"
+#include "MappedFile.h"
 using namespace std;
 
+// The color channels of a pixel
+enum class Channel
+{
+	Red,
+	Green,
+	Blue
+};
+
 class Image
 {
 public:
@@ -21,6 +38,14 @@ public:
 	// Postconditions:	Image object will be created based on GIF file
 	Image(string filename);
 
+	// Image(GifReader& reader)
+	// Constructs an Image object from a GIF whose header has already been read,
+	// so a caller can check the size of an image before decoding it
+	// Preconditions:	none
+	// Postconditions:	Image object will be created based on the GIF, or 0 by 0
+	//					if the GIF is invalid
+	Image(GifReader& reader);
+
 	// Image(int rows, int cols)
 	// Constructs an Image object with all black pixels with rows rows and cols columns
 	// Preconditions:	rows and cols must be greater than 0
@@ -28,12 +53,27 @@ public:
 	//					and cols columns
 	Image(int rows, int cols);
 
+	// Image(const shared_ptr<MappedFile>& file, size_t offset, int rows, int cols)
+	// Constructs an Image object that is a view over packed RGB pixels in a
+	// mapped file, the pixels are used where they are and the file is kept
+	// mapped for as long as the Image uses it
+	// Preconditions:	file must be valid and hold rows * cols pixels from offset
+	// Postconditions:	Image object will be created with the pixels of the file,
+	//					writes to it go wherever the file's mapping sends them
+	Image(const shared_ptr<MappedFile>& file, size_t offset, int rows, int cols);
+
 	// Image(const Image& img)
 	// Copy constructor for Image class
 	// Preconditions:	none (compiler calls automatically when neccessary)
 	// Postconditions:	copy is created of img
 	Image(const Image& img);
 
+	// Image(Image&& img)
+	// Move constructor for Image class, takes img's buffer without copying it
+	// Preconditions:	none (compiler calls automatically when neccessary)
+	// Postconditions:	this holds img's pixels, img is 0 by 0
+	Image(Image&& img) noexcept;
+
 	// ~Image
 	// Destructor for Image class
 	// Preconditions:	none (compiler calls automatically when neccessary)
@@ -43,9 +83,18 @@ public:
 	// =
 	// Overloads the assignment operator
 	// Preconditions:	right operand must be an Image object
-	// Postconditions:	left operand now points to the same memory address as the right operand
+	// Postconditions:	left operand is a copy of the right operand, its buffer is
+	//					reused if the dimensions match (a view's pixels are
+	//					overwritten in place)
 	const Image& operator=(const Image& img);
 
+	// =
+	// Overloads the move assignment operator
+	// Preconditions:	right operand must be an Image object
+	// Postconditions:	left operand frees its buffer and takes the right operand's,
+	//					the right operand is 0 by 0, unless it is self-assignment
+	Image& operator=(Image&& img) noexcept;
+
 	// int getCols() const
 	// Gets the number of rows of pixels in the Image
 	// Preconditions:	none
@@ -60,21 +109,55 @@ public:
 
 	// int getPixelColor(int row, int col, string color) const
 	// Gets the red, green, or blue value at a specified pixel and returns it
+	// NOTE:	kept for compatibility, prefer getChannel or getPixel
 	// Preconditions:	row and col must refer to a pixel within the image
 	// Postconditions:	returns the value of the color on the pixel requested
 	int getPixelColor(int row, int col, string color) const;
 
 	// void setPixelColor(int row, int col, string color, int val)
 	// Changes the value of the red, green, and blue pixels within the image
+	// NOTE:	kept for compatibility, prefer setChannel or setPixel
 	// Preconditions:	row and col must refer to a pixel within the image
 	// Postconditions:	pixel in the image is changed based on color and number provided
 	void setPixelColor(int row, int col, string color, int val);
 
-	// void writeToDisk(const string filename) const
+	// byte getChannel(int row, int col, Channel color) const
+	// Gets one channel of a pixel
+	// Preconditions:	row and col must refer to a pixel within the image
+	// Postconditions:	returns the value of the channel requested
+	byte getChannel(int row, int col, Channel color) const;
+
+	// byte getChannel<C>(int row, int col) const
+	// Gets one channel of a pixel, the channel is chosen at compile time
+	// Preconditions:	row and col must refer to a pixel within the image
+	// Postconditions:	returns the value of channel C
+	template <Channel C>
+	byte getChannel(int row, int col) const;
+
+	// void setChannel(int row, int col, Channel color, byte val)
+	// Changes one channel of a pixel
+	// Preconditions:	row and col must refer to a pixel within the image
+	// Postconditions:	the channel requested is set to val
+	void setChannel(int row, int col, Channel color, byte val);
+
+	// pixel getPixel(int row, int col) const
+	// Gets all three channels of a pixel
+	// Preconditions:	row and col must refer to a pixel within the image
+	// Postconditions:	returns the pixel at row, col
+	pixel getPixel(int row, int col) const;
+
+	// void setPixel(int row, int col, const pixel& p)
+	// Changes all three channels of a pixel
+	// Preconditions:	row and col must refer to a pixel within the image
+	// Postconditions:	pixel at row, col is now p
+	void setPixel(int row, int col, const pixel& p);
+
+	// bool writeToDisk(const string filename) const
 	// Writes current image to disk based on a specified file name
 	// Preconditions:	none
-	// Postconditions:	this Image object is written to the disk with the name filename
-	void writeToDisk(const string filename) const;
+	// Postconditions:	this Image object is written to the disk with the name filename,
+	//					false is returned if it could not be written
+	bool writeToDisk(const string filename) const;
 
 	// ==
 	// Overloads the equals operator
@@ -109,19 +192,136 @@ public:
 	//					"x rows y columns"
 	friend ostream& operator<<(ostream& ostream, const Image& img);
 
-	// const Image mirror()
+	// int getStride() const
+	// Gets the distance in pixels between the start of two consecutive rows
+	// Preconditions:	none
+	// Postconditions:	row stride of the pixel buffer is returned, at least getCols()
+	int getStride() const;
+
+	// pixel* getRow(int row)
+	// Gets a pointer to the first pixel of a row, the row's pixels are contiguous.
+	// This is the unchecked fast path for loops over whole rows
+	// Preconditions:	row must be within the image
+	// Postconditions:	pointer to pixel (row, 0) is returned
+	pixel* getRow(int row);
+	const pixel* getRow(int row) const;
+
+	// pixel* getData()
+	// Gets a pointer to the start of the pixel buffer, row r starts at
+	// getData() + r * getStride()
+	// Preconditions:	none
+	// Postconditions:	pointer to pixel (0, 0) is returned, nullptr if the image is empty
+	pixel* getData();
+	const pixel* getData() const;
+
+	// Image mirror() const
 	// Creates and returns a mirror image
 	// Preconditions:	this must be a valid Image
 	// Postconditions:	returns a new Image with left and right side reversed
-	const Image mirror();
+	Image mirror() const;
+
+	// void mirrorInPlace()
+	// Mirrors this image without allocating
+	// Preconditions:	this must be a valid Image
+	// Postconditions:	left and right side of this Image are reversed
+	void mirrorInPlace();
 private:
-	// The image object from ImageLib.h
-	image thisImage;
-		
-	// void swapPixel(pixel& p1, pixel& p2)
-	// Swaps two pixels
-	// Preconditions:	p1 and p2 must be valid pixels
-	// Postconditions:	p1 and p2 are now swapped
-	void swapPixel(pixel& p1, pixel& p2);
+	// Size of the image and distance between rows, in pixels
+	int rows, cols, stride;
+
+	// Pixel buffer, rows * stride pixels aligned to 64 bytes, or the pixels
+	// of a mapped file with stride == cols
+	pixel* pixels;
+
+	// The file a view's pixels are in, nullptr if the Image owns its buffer
+	shared_ptr<MappedFile> mapping;
+
+	// void copyPixels(const Image& img)
+	// Copies the pixels of an image of the same size
+	// Preconditions:	img must have the same dimensions as this
+	// Postconditions:	every pixel of this equals the pixel of img
+	void copyPixels(const Image& img);
+
+	// void allocate(int rows, int cols)
+	// Allocates a zeroed pixel buffer for the given dimensions
+	// Preconditions:	rows and cols must be non-negative, no buffer is held
+	// Postconditions:	rows, cols, stride and pixels describe a black image
+	void allocate(int rows, int cols);
+
+	// void deallocate()
+	// Frees the pixel buffer, or lets go of the mapped file of a view
+	// Preconditions:	none
+	// Postconditions:	the buffer is freed and the image is 0 by 0
+	void deallocate();
+
+	// void decode(GifReader& reader)
+	// Allocates the buffer and decodes a GIF into it
+	// Preconditions:	no buffer is held
+	// Postconditions:	this Image holds the GIF, or is 0 by 0 if it is invalid
+	void decode(GifReader& reader);
+
+	// byte& channelOf(pixel& p, Channel color)
+	// Selects one channel of a pixel
+	// Preconditions:	none
+	// Postconditions:	reference to the requested channel of p is returned
+	static byte& channelOf(pixel& p, Channel color);
+	static const byte& channelOf(const pixel& p, Channel color);
 };
 
+// The accessors below are used once per pixel in the segmentation loops,
+// so they are defined here to be inlined
+
+inline byte& Image::channelOf(pixel& p, Channel color)
+{
+	if (color == Channel::Red)
+		return p.red;
+	if (color == Channel::Blue)
+		return p.blue;
+	return p.green;
+}
+
+inline const byte& Image::channelOf(const pixel& p, Channel color)
+{
+	if (color == Channel::Red)
+		return p.red;
+	if (color == Channel::Blue)
+		return p.blue;
+	return p.green;
+}
+
+inline byte Image::getChannel(int row, int col, Channel color) const
+{
+	return channelOf(pixels[(size_t)row * stride + col], color);
+}
+
+template <Channel C>
+inline byte Image::getChannel(int row, int col) const
+{
+	return channelOf(pixels[(size_t)row * stride + col], C);
+}
+
+inline void Image::setChannel(int row, int col, Channel color, byte val)
+{
+	channelOf(pixels[(size_t)row * stride + col], color) = val;
+}
+
+inline pixel Image::getPixel(int row, int col) const
+{
+	return pixels[(size_t)row * stride + col];
+}
+
+inline void Image::setPixel(int row, int col, const pixel& p)
+{
+	pixels[(size_t)row * stride + col] = p;
+}
+
+inline pixel* Image::getRow(int row)
+{
+	return pixels + (size_t)row * stride;
+}
+
+inline const pixel* Image::getRow(int row) const
+{
+	return pixels + (size_t)row * stride;
+}
+
@@ -0,0 +1,176 @@
+/*	ImageDiff.cpp
+	Jayden Fullerton
+
+	This file contains image comparison for regression checks. Equality is
+	tested a band of rows at a time on several threads, stopping every band
+	as soon as one of them finds a different pixel. A diff measures how two
+	images differ: how many pixels, where, and by how much, and can mark
+	the differing pixels in a mask image. Rows are compared with memcmp
+	first so that matching rows cost no more than reading them.	*/
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include "ColorKernel.h"
+#include "ImageDiff.h"
+#include "Profile.h"
+#include "ThreadPool.h"
+
+// Rows a worker takes at a time, enough to keep the counter uncontended
+static const int BAND_ROWS = 64;
+
+// Color of a differing pixel in the mask
+static const pixel MASK_COLOR = { 255, 255, 255 };
+
+/*	DiffReport constructor
+	@pre	none
+	@post	a report of two equal empty images is created	*/
+DiffReport::DiffReport()
+{
+	sameSize = true;
+	differing = 0;
+	top = 0;
+	left = 0;
+	bottom = -1;
+	right = -1;
+	maxError = 0;
+	meanError = 0;
+}
+
+/*	BandDiff struct
+
+	Differences found by one worker, added up once every band is done.	*/
+struct BandDiff
+{
+	long long differing;
+	int top, left, bottom, right;
+	int maxError;
+	long long errorSum;
+};
+
+/*	tests two images for equality
+	@param	first image
+	@param	second image
+	@param	threads to compare on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	true is returned if both images have the same size and pixels	*/
+bool imagesEqual(const Image& a, const Image& b, int threads)
+{
+	PROFILE_SCOPE("compare");
+	if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+		return false;
+
+	size_t rowBytes = (size_t)a.getCols() * sizeof(pixel);
+	std::atomic<bool> equal(true);
+	forEachBand(a.getRows(), BAND_ROWS, threads, [&](int, int first, int last)
+	{
+		for (int row = first; row < last; row++)
+		{
+			if (memcmp(a.getRow(row), b.getRow(row), rowBytes) != 0)
+			{
+				equal = false;
+				return false;
+			}
+		}
+		return true;
+	});
+	return equal;
+}
+
+/*	measures the differences between two images
+	@param	first image
+	@param	second image
+	@param	mask to write, or nullptr for none
+	@param	threads to compare on, 0 for every hardware thread
+	@pre	mask, if given, must have the size of a and b, threads must be
+			non-negative
+	@post	the differences are returned; if the images have the same size
+			mask is white at every differing pixel and black elsewhere	*/
+DiffReport diffImages(const Image& a, const Image& b, Image* mask, int threads)
+{
+	PROFILE_SCOPE("diff");
+	DiffReport report;
+	if (a.getRows() != b.getRows() || a.getCols() != b.getCols())
+	{
+		report.sameSize = false;
+		return report;
+	}
+
+	int rows = a.getRows();
+	int cols = a.getCols();
+	size_t rowBytes = (size_t)cols * sizeof(pixel);
+	int poolSize = resolveThreads(threads);
+	BandDiff empty = { 0, rows, cols, -1, -1, 0, 0 };
+	std::vector<BandDiff> partial(poolSize, empty);
+	std::vector<std::vector<uint64_t>> equalMasks(poolSize, std::vector<uint64_t>(maskWords(cols)));
+
+	int workers = forEachBand(rows, BAND_ROWS, threads, [&](int worker, int first, int last)
+	{
+		BandDiff& diff = partial[worker];
+		uint64_t* equalBits = equalMasks[worker].data();
+		for (int row = first; row < last; row++)
+		{
+			const pixel* x = a.getRow(row);
+			const pixel* y = b.getRow(row);
+			if (mask != nullptr)
+				memset(mask->getRow(row), 0, rowBytes);
+			if (memcmp(x, y, rowBytes) == 0)
+				continue;
+
+			// A pair is equal exactly when its L1 distance is below 1
+			pairDistanceMask(x, y, cols, 1, equalBits);
+			int firstCol = cols, lastCol = -1;
+			for (int word = 0; word < maskWords(cols); word++)
+			{
+				uint64_t differ = ~equalBits[word];
+				if (word == maskWords(cols) - 1 && cols % 64 != 0)
+					differ &= ((uint64_t)1 << (cols % 64)) - 1;
+				if (differ == 0)
+					continue;
+				diff.differing += countBits(differ);
+				firstCol = std::min(firstCol, word * 64 + lowestBit(differ));
+				lastCol = word * 64 + highestBit(differ);
+				if (mask != nullptr)
+				{
+					pixel* out = mask->getRow(row) + word * 64;
+					for (uint64_t bits = differ; bits != 0; bits &= bits - 1)
+						out[lowestBit(bits)] = MASK_COLOR;
+				}
+			}
+
+			// Equal pixels add nothing to the error, so only the span between
+			// the first and last differing pixel is measured
+			channelError(x + firstCol, y + firstCol, lastCol - firstCol + 1, diff.errorSum, diff.maxError);
+			diff.top = std::min(diff.top, row);
+			diff.bottom = row;
+			diff.left = std::min(diff.left, firstCol);
+			diff.right = std::max(diff.right, lastCol);
+		}
+		return true;
+	});
+
+	long long errorSum = 0;
+	for (int worker = 0; worker < workers; worker++)
+	{
+		const BandDiff& diff = partial[worker];
+		if (diff.differing == 0)
+			continue;
+		if (report.differing == 0)
+		{
+			report.top = diff.top;
+			report.left = diff.left;
+			report.bottom = diff.bottom;
+			report.right = diff.right;
+		}
+		report.differing += diff.differing;
+		report.top = std::min(report.top, diff.top);
+		report.left = std::min(report.left, diff.left);
+		report.bottom = std::max(report.bottom, diff.bottom);
+		report.right = std::max(report.right, diff.right);
+		report.maxError = std::max(report.maxError, diff.maxError);
+		errorSum += diff.errorSum;
+	}
+	if (rows > 0 && cols > 0)
+		report.meanError = (double)errorSum / ((double)rows * cols * 3);
+	return report;
+}
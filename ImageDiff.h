@@ -0,0 +1,51 @@
+/*	ImageDiff.h
+	Jayden Fullerton
+
+	This file contains image comparison for regression checks. Equality is
+	tested a band of rows at a time on several threads, stopping every band
+	as soon as one of them finds a different pixel. A diff measures how two
+	images differ: how many pixels, where, and by how much, and can mark
+	the differing pixels in a mask image. Rows are compared with memcmp
+	first so that matching rows cost no more than reading them.	*/
+#pragma once
+
+#include "Image.h"
+
+/*	DiffReport struct
+
+	Differences between two images. The bounding box is empty, with
+	top > bottom, when no pixel differs. Images of different sizes are not
+	compared at all.	*/
+struct DiffReport
+{
+	bool sameSize;
+	long long differing;	// pixels with at least one different channel
+	int top, left;			// bounding box of the differing pixels, inclusive
+	int bottom, right;
+	int maxError;			// largest difference of a single channel
+	double meanError;		// mean difference over every channel of every pixel
+
+	/*	DiffReport constructor
+		@pre	none
+		@post	a report of two equal empty images is created	*/
+	DiffReport();
+};
+
+/*	tests two images for equality
+	@param	first image
+	@param	second image
+	@param	threads to compare on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	true is returned if both images have the same size and pixels	*/
+bool imagesEqual(const Image& a, const Image& b, int threads = 1);
+
+/*	measures the differences between two images
+	@param	first image
+	@param	second image
+	@param	mask to write, or nullptr for none
+	@param	threads to compare on, 0 for every hardware thread
+	@pre	mask, if given, must have the size of a and b, threads must be
+			non-negative
+	@post	the differences are returned; if the images have the same size
+			mask is white at every differing pixel and black elsewhere	*/
+DiffReport diffImages(const Image& a, const Image& b, Image* mask = nullptr, int threads = 1);
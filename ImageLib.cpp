@@ -0,0 +1,146 @@
+/*****************************************************************/
+/* ImageLib.cpp
+/*
+/* This file implements the interface described in ImageLib.h
+/* in portable C++ so the library no longer has to be linked
+/* from a prebuilt Windows binary. GIF reading and writing is
+/* done by GifCodec. The pixels of an image are allocated as
+/* one block with the row pointers pointing into it, so a copy
+/* is a single memcpy.
+/*
+/*****************************************************************/
+
+#include <cstring>
+#include <new>
+#include "GifCodec.h"
+#include "ImageLib.h"
+
+
+/*
+ * emptyImage:
+ * Postconditions: returns an image with rows = 0, cols = 0, pixels = nullptr.
+ */
+
+static image emptyImage()
+{
+	image img;
+	img.rows = 0;
+	img.cols = 0;
+	img.pixels = nullptr;
+	return img;
+}
+
+
+
+/*
+ * ReadGIF:
+ * Preconditions:  filename refers to a file that stores a GIF image.
+ * Postconditions: returns the image contained in "filename" using the
+ *			conventions described for the image type above.
+ *		   If the load is unsuccessful, returns an image with
+ *		   rows = 0, cols = 0, pixels = nullptr.
+ */
+
+image ReadGIF(string filename)
+{
+	GifReader reader(filename);
+	if (!reader.isValid())
+		return emptyImage();
+
+	image img = CreateImage(reader.getRows(), reader.getCols());
+	if (img.pixels == nullptr || !reader.read(img.pixels))
+		DeallocateImage(img);
+	return img;
+}
+
+
+
+/*
+ * WriteGIF:
+ * Preconditions:  filename is valid filename to store a GIF image.
+ *		   inputImage holds an image using the conventions described
+ *			for the image type above.
+ * Postconditions: inputImage is saved as a GIF image at the location
+ *			specified by filename.
+ */
+
+void WriteGIF(string filename, image inputImage)
+{
+	writeGif(filename, inputImage.pixels, inputImage.rows, inputImage.cols);
+}
+
+
+
+/*
+ * DeallocateImage:
+ * Preconditions:  inputImage contains an image using the conventions
+ *		 	for the image type described above.
+ * Postconditions: the memory allocated to the pixels of inputImage has
+ *			been deallocated.  Also, the image values are set to:
+ *			rows = 0, cols = 0, pixels = nullptr.
+ */
+
+void DeallocateImage(image &inputImage)
+{
+	if (inputImage.pixels != nullptr)
+	{
+		delete[] inputImage.pixels[0];
+		delete[] inputImage.pixels;
+	}
+	inputImage = emptyImage();
+}
+
+
+
+/*
+ * CopyImage:
+ * Preconditions:  inputImage contains an image using the conventions
+ *		 	for the image type described above.
+ * Postconditions: if sufficient memory is available, a copy of inputImage
+ *			is returned using newly allocated memory.
+ *			Otherwise, the returned image has:
+ *			rows = 0, cols =0 , pixels = nullptr.
+ */
+
+image CopyImage(image inputImage)
+{
+	image img = CreateImage(inputImage.rows, inputImage.cols);
+	if (img.pixels != nullptr)
+		memcpy(img.pixels[0], inputImage.pixels[0], (size_t)img.rows * img.cols * sizeof(pixel));
+	return img;
+}
+
+
+
+/*
+ * CreateImage:
+ * Preconditions:  rows and cols describe the desired size of the new image.
+ * Postconditions: if sufficient memory is available, a new image
+ *			is returned using newly allocated memory.
+ *			Each pixel has red = 0, green =0, blue = 0.
+ *			Otherwise, the returned image has:
+ *			rows = 0, cols =0, pixels = nullptr.
+ */
+
+image CreateImage(int rows, int cols)
+{
+	if (rows <= 0 || cols <= 0)
+		return emptyImage();
+
+	image img;
+	img.pixels = new (nothrow) pixel*[rows];
+	if (img.pixels == nullptr)
+		return emptyImage();
+	pixel* block = new (nothrow) pixel[(size_t)rows * cols];
+	if (block == nullptr)
+	{
+		delete[] img.pixels;
+		return emptyImage();
+	}
+	memset(block, 0, (size_t)rows * cols * sizeof(pixel));
+	for (int row = 0; row < rows; row++)
+		img.pixels[row] = block + (size_t)row * cols;
+	img.rows = rows;
+	img.cols = cols;
+	return img;
+}
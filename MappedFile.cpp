@@ -0,0 +1,152 @@
+/*	MappedFile.cpp
+	Jayden Fullerton
+
+	This file contains a memory-mapped file. A file opened for reading is
+	mapped copy-on-write, so its bytes can be used in place without a copy
+	and writing to them never changes the file. A file opened for writing is
+	created at its final size and mapped shared, so whatever is written into
+	the mapping ends up in the file without a separate write pass.	*/
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*	MappedFile constructor
+	@param	name of the file
+	@param	how to open it
+	@param	size of the file in Write mode, ignored in Read mode
+	@pre	size must be positive in Write mode
+	@post	the file is mapped, isValid() tells if it could be	*/
+MappedFile::MappedFile(const std::string& filename, Mode mode, size_t size)
+{
+	data = nullptr;
+	this->size = 0;
+#ifdef _WIN32
+	file = nullptr;
+	mapping = nullptr;
+#else
+	file = -1;
+#endif
+	if (!map(filename, mode, size))
+		close();
+}
+
+/*	opens and maps the file
+	@param	name of the file
+	@param	how to open it
+	@param	size of the file in Write mode, ignored in Read mode
+	@pre	nothing is open
+	@post	true is returned if the file was mapped, whatever was opened
+			before a failure is left for close()	*/
+bool MappedFile::map(const std::string& filename, Mode mode, size_t size)
+{
+#ifdef _WIN32
+	HANDLE handle = mode == Mode::Read
+		? CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)
+		: CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+	file = handle;
+	if (mode == Mode::Read)
+	{
+		LARGE_INTEGER length;
+		if (!GetFileSizeEx(file, &length))
+			return false;
+		size = (size_t)length.QuadPart;
+	}
+	if (size == 0) // an empty file cannot be mapped
+		return false;
+	mapping = CreateFileMappingA(file, nullptr, mode == Mode::Read ? PAGE_WRITECOPY : PAGE_READWRITE,
+		(DWORD)((unsigned long long)size >> 32), (DWORD)size, nullptr);
+	if (mapping == nullptr)
+		return false;
+	data = (unsigned char*)MapViewOfFile(mapping, mode == Mode::Read ? FILE_MAP_COPY : FILE_MAP_WRITE, 0, 0, size);
+#else
+	file = mode == Mode::Read ? open(filename.c_str(), O_RDONLY) : open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0)
+		return false;
+	if (mode == Mode::Read)
+	{
+		struct stat info;
+		if (fstat(file, &info) != 0)
+			return false;
+		size = (size_t)info.st_size;
+	}
+	else if (size > 0 && ftruncate(file, (off_t)size) != 0)
+		return false;
+	if (size == 0) // an empty file cannot be mapped
+		return false;
+	// reads are mapped private so writing to the pixels never reaches the file
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, mode == Mode::Read ? MAP_PRIVATE : MAP_SHARED, file, 0);
+	if (p != MAP_FAILED)
+		data = (unsigned char*)p;
+#endif
+	this->size = data != nullptr ? size : 0;
+	return data != nullptr;
+}
+
+/*	MappedFile destructor
+	@pre	none
+	@post	the mapping is released, in Write mode its contents are in
+			the file	*/
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/*	unmaps and closes the file
+	@pre	none
+	@post	the mapping and file are released, isValid() is false	*/
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != nullptr)
+		CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data != nullptr)
+		munmap(data, size);
+	if (file >= 0)
+		::close(file);
+	file = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+/*	was the file mapped
+	@pre	none
+	@post	true is returned if getData() points to the file's bytes	*/
+bool MappedFile::isValid() const
+{
+	return data != nullptr;
+}
+
+/*	returns the mapped bytes
+	@pre	isValid() must be true
+	@post	pointer to the first byte of the file is returned	*/
+unsigned char* MappedFile::getData() const
+{
+	return data;
+}
+
+/*	returns the size of the mapping
+	@pre	none
+	@post	number of mapped bytes is returned, 0 if not valid	*/
+size_t MappedFile::getSize() const
+{
+	return size;
+}
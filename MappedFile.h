@@ -0,0 +1,80 @@
+/*	MappedFile.h
+	Jayden Fullerton
+
+	This file contains a memory-mapped file. A file opened for reading is
+	mapped copy-on-write, so its bytes can be used in place without a copy
+	and writing to them never changes the file. A file opened for writing is
+	created at its final size and mapped shared, so whatever is written into
+	the mapping ends up in the file without a separate write pass.	*/
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+public:
+	/*	Mode enum
+
+		Selects how the file is opened.	*/
+	enum class Mode
+	{
+		Read,	// map an existing file copy-on-write
+		Write	// create (or truncate) the file at size bytes and map it shared
+	};
+private:
+	unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* file;		// HANDLE of the file
+	void* mapping;	// HANDLE of the file mapping
+#else
+	int file;
+#endif
+
+	/*	opens and maps the file
+		@param	name of the file
+		@param	how to open it
+		@param	size of the file in Write mode, ignored in Read mode
+		@pre	nothing is open
+		@post	true is returned if the file was mapped, whatever was opened
+				before a failure is left for close()	*/
+	bool map(const std::string& filename, Mode mode, size_t size);
+
+	/*	unmaps and closes the file
+		@pre	none
+		@post	the mapping and file are released, isValid() is false	*/
+	void close();
+public:
+	/*	MappedFile constructor
+		@param	name of the file
+		@param	how to open it
+		@param	size of the file in Write mode, ignored in Read mode
+		@pre	size must be positive in Write mode
+		@post	the file is mapped, isValid() tells if it could be	*/
+	MappedFile(const std::string& filename, Mode mode, size_t size = 0);
+
+	/*	MappedFile destructor
+		@pre	none
+		@post	the mapping is released, in Write mode its contents are in
+				the file	*/
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/*	was the file mapped
+		@pre	none
+		@post	true is returned if getData() points to the file's bytes	*/
+	bool isValid() const;
+
+	/*	returns the mapped bytes
+		@pre	isValid() must be true
+		@post	pointer to the first byte of the file is returned	*/
+	unsigned char* getData() const;
+
+	/*	returns the size of the mapping
+		@pre	none
+		@post	number of mapped bytes is returned, 0 if not valid	*/
+	size_t getSize() const;
+};
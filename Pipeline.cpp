@@ -0,0 +1,200 @@
+/*	Pipeline.cpp
+	Jayden Fullerton
+
+	This file contains the segmentation step shared by the single image and
+	batch modes of the driver. An image is segmented with the mode selected
+	in SegmentOptions into a label map, optionally followed by merging small
+	or similar neighbouring regions, and every segment is painted its
+	average color. Union-find labels either pixel by pixel, on several
+	threads a tile at a time, coarse to fine a flat block at a time, or a
+	run of similar pixels at a time.	*/
+#include "Pipeline.h"
+#include "Profile.h"
+#include "PyramidSegmenter.h"
+#include "RegionGraph.h"
+#include "RegionGrower.h"
+#include "RegionMerger.h"
+#include "RunSegmenter.h"
+#include "TiledSegmenter.h"
+#include "UnionFindSegmenter.h"
+
+/*	SegmentOptions constructor
+	@pre	none
+	@post	options select single-threaded flood fill from the seed color
+			with the L1 metric and the default threshold, without merging	*/
+SegmentOptions::SegmentOptions()
+{
+	unionFind = false;
+	threads = 1;
+	pyramidLevels = 0;
+	runs = false;
+	reference = Reference::Seed;
+	minRegion = 0;
+	mergeThreshold = 0;
+	verbose = false;
+}
+
+/*	segments an image with the selected mode
+	@param	image to segment
+	@param	image to write segments to
+	@param	segmentation mode
+	@param	statistics of every segment, indexed by label
+	@pre	out must have the same dimensions as in
+	@post	every segment is written to out as its average color	*/
+void segmentImage(const Image& in, Image& out, const SegmentOptions& options, vector<SegmentStats>& stats)
+{
+	if (options.unionFind && options.runs && options.pyramidLevels == 0 && options.minRegion <= 1
+		&& options.mergeThreshold <= 0)
+	{
+		// Without merging the label map is never needed, runs are painted
+		// straight from the run list
+		PROFILE_SCOPE("segment");
+		RunSegmentation runs;
+		RunSegmenter(options.similarity).segment(in, runs);
+		if (options.verbose)
+			cout << "Labeled " << runs.runs.size() << " runs of similar pixels" << endl;
+		paintRuns(runs, out);
+		stats.swap(runs.stats);
+		PROFILE_COUNT(SegmentsCreated, stats.size());
+		for (size_t i = 0; i < stats.size(); i++)
+			PROFILE_MAX(MaxRegionSize, stats[i].count);
+		return;
+	}
+
+	Segmentation seg;
+	labelImage(in, options, seg);
+	paintLabels(seg.labels.data(), seg.stats, out);
+	stats.swap(seg.stats);
+}
+
+/*	labels an image with the selected mode
+	@param	image to segment
+	@param	segmentation mode
+	@param	segmentation to write the label map and statistics to
+	@pre	in must be a valid image object
+	@post	result holds the label of every pixel of in and the statistics
+			of every label, after merging if options ask for it	*/
+void labelImage(const Image& in, const SegmentOptions& options, Segmentation& result)
+{
+	PROFILE_SCOPE("segment");
+	if (options.unionFind)
+		runUnionFind(in, options, result);
+	else
+		runFloodFill(in, options.similarity, options.reference, result);
+
+	if (options.minRegion > 1 || options.mergeThreshold > 0)
+	{
+		RegionGraph graph;
+		buildRegionGraph(in, result, graph);
+		RegionMerger merger(options.similarity, options.minRegion, options.mergeThreshold);
+		merger.merge(result, graph);
+		if (options.verbose)
+			cout << "Merged " << merger.getMerges() << " regions into their neighbours" << endl;
+	}
+
+	PROFILE_COUNT(SegmentsCreated, result.stats.size());
+	for (size_t i = 0; i < result.stats.size(); i++)
+		PROFILE_MAX(MaxRegionSize, result.stats[i].count);
+}
+
+/*	labels an image by growing regions from seed pixels
+	@param	image to segment
+	@param	metric and distance a pixel must be below to join its region
+	@param	color candidates are compared to, the seed or the region mean
+	@param	segmentation to write the label map and statistics to
+	@pre	in must be a valid image object
+	@post	every region of pixels similar to its seed (or its running mean)
+			has its own label in result	*/
+void runFloodFill(const Image& in, const Similarity& similarity, Reference reference, Segmentation& result)
+{
+	int numOfRegions = 0;
+
+	// Grows each region iteratively, reusing its frontier for every region.
+	// The grower's label map records which region owns each pixel and its
+	// statistics are filled in as the region grows
+	RegionGrower grower(in, similarity, reference);
+
+	// Iterate through image
+	PROFILE_SCOPE("region_growing");
+	for (int row = 0; row < in.getRows(); row++)
+	{
+		for (int col = 0; col < in.getCols(); col++)
+		{
+			// if the current pixel is not in a region yet
+			if (!grower.isVisited(row, col))
+			{
+				grower.grow(row, col, in, numOfRegions);
+				numOfRegions++;
+			}
+		}
+	}
+
+	result.rows = in.getRows();
+	result.cols = in.getCols();
+	grower.takeResult(result.labels, result.stats);
+}
+
+/*	labels an image by connecting similar neighbours
+	@param	image to segment
+	@param	segmentation options, threads, pyramid levels, runs and similarity are used
+	@param	segmentation to write the label map and statistics to
+	@pre	in must be a valid image object
+	@post	every connected component has its own label in result	*/
+void runUnionFind(const Image& in, const SegmentOptions& options, Segmentation& result)
+{
+	if (options.pyramidLevels > 0)
+	{
+		// Flat blocks are labeled whole, the threads build the pyramids
+		PyramidSegmenter segmenter(options.similarity, options.pyramidLevels, options.threads);
+		segmenter.segment(in, result);
+		if (options.verbose && !result.labels.empty())
+			cout << "Pyramid labeled " << 100.0 * segmenter.getFlatPixels() / result.labels.size()
+				<< "% of pixels in flat blocks" << endl;
+	}
+	else if (options.runs)
+	{
+		RunSegmentation runs;
+		RunSegmenter(options.similarity).segment(in, runs);
+		if (options.verbose)
+			cout << "Labeled " << runs.runs.size() << " runs of similar pixels" << endl;
+		expandRuns(runs, result);
+	}
+	else if (options.threads == 1)
+	{
+		UnionFindSegmenter segmenter(options.similarity);
+		segmenter.segment(in, result);
+	}
+	else
+	{
+		// Tiles are labeled in parallel and merged across their seams
+		TiledSegmenter segmenter(options.threads, options.similarity);
+		segmenter.segment(in, result);
+		PhaseTimes times = segmenter.getPhaseTimes();
+		if (options.verbose)
+			cout << "Labeled on " << segmenter.getThreads() << " threads: " << times.label << " ms tiles, "
+				<< times.seams << " ms seams, " << times.relabel << " ms relabel" << endl;
+	}
+}
+
+/*	writes the average color of every label to an image
+	@param	label of every pixel in row-major order
+	@param	statistics of every label
+	@param	output for image to be segmented into
+	@pre	labels must hold one label per pixel of out, every label must
+			be an index into stats
+	@post	every pixel of out is the average color of its label	*/
+void paintLabels(const int32_t* labels, const vector<SegmentStats>& stats, Image& out)
+{
+	PROFILE_SCOPE("paint");
+	vector<pixel> colors(stats.size());
+	for (size_t i = 0; i < stats.size(); i++)
+		colors[i] = stats[i].average();
+
+	for (int row = 0; row < out.getRows(); row++)
+	{
+		pixel* line = out.getRow(row);
+		const int32_t* rowLabels = labels + (size_t)row * out.getCols();
+		for (int col = 0; col < out.getCols(); col++)
+			line[col] = colors[rowLabels[col]];
+	}
+}
@@ -0,0 +1,86 @@
+/*	Pipeline.h
+	Jayden Fullerton
+
+	This file contains the segmentation step shared by the single image and
+	batch modes of the driver. An image is segmented with the mode selected
+	in SegmentOptions into a label map, optionally followed by merging small
+	or similar neighbouring regions, and every segment is painted its
+	average color. Union-find labels either pixel by pixel, on several
+	threads a tile at a time, coarse to fine a flat block at a time, or a
+	run of similar pixels at a time.	*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ColorMetric.h"
+#include "Image.h"
+#include "RegionGrower.h"
+#include "SegmentStats.h"
+#include "UnionFindSegmenter.h"
+
+/*	SegmentOptions struct
+
+	Selects how an image is segmented.	*/
+struct SegmentOptions
+{
+	bool unionFind;			// union-find labeling instead of flood fill
+	int threads;			// threads to label one image on, 0 for every hardware thread
+	int pyramidLevels;		// union-find labels flat blocks up to 2^n pixels square at once, 0 for none
+	bool runs;				// union-find joins runs of similar pixels instead of single pixels
+	Similarity similarity;	// metric and distance two pixels must be below to join
+	Reference reference;	// color flood fill compares candidates to
+	int minRegion;			// regions with fewer pixels are merged into a neighbour, 0 for none
+	int mergeThreshold;		// neighbours with closer mean colors are merged, 0 for none
+	bool verbose;			// print the phase times of tiled labeling and merge counts
+
+	/*	SegmentOptions constructor
+		@pre	none
+		@post	options select single-threaded flood fill from the seed color
+				with the L1 metric and the default threshold, without merging	*/
+	SegmentOptions();
+};
+
+/*	segments an image with the selected mode
+	@param	image to segment
+	@param	image to write segments to
+	@param	segmentation mode
+	@param	statistics of every segment, indexed by label
+	@pre	out must have the same dimensions as in
+	@post	every segment is written to out as its average color	*/
+void segmentImage(const Image& in, Image& out, const SegmentOptions& options, std::vector<SegmentStats>& stats);
+
+/*	labels an image with the selected mode
+	@param	image to segment
+	@param	segmentation mode
+	@param	segmentation to write the label map and statistics to
+	@pre	in must be a valid image object
+	@post	result holds the label of every pixel of in and the statistics
+			of every label, after merging if options ask for it	*/
+void labelImage(const Image& in, const SegmentOptions& options, Segmentation& result);
+
+/*	labels an image by growing regions from seed pixels
+	@param	image to segment
+	@param	metric and distance a pixel must be below to join its region
+	@param	color candidates are compared to, the seed or the region mean
+	@param	segmentation to write the label map and statistics to
+	@pre	in must be a valid image object
+	@post	every region of pixels similar to its seed (or its running mean)
+			has its own label in result	*/
+void runFloodFill(const Image& in, const Similarity& similarity, Reference reference, Segmentation& result);
+
+/*	labels an image by connecting similar neighbours
+	@param	image to segment
+	@param	segmentation options, threads, pyramid levels, runs and similarity are used
+	@param	segmentation to write the label map and statistics to
+	@pre	in must be a valid image object
+	@post	every connected component has its own label in result	*/
+void runUnionFind(const Image& in, const SegmentOptions& options, Segmentation& result);
+
+/*	writes the average color of every label to an image
+	@param	label of every pixel in row-major order
+	@param	statistics of every label
+	@param	output for image to be segmented into
+	@pre	labels must hold one label per pixel of out, every label must
+			be an index into stats
+	@post	every pixel of out is the average color of its label	*/
+void paintLabels(const int32_t* labels, const std::vector<SegmentStats>& stats, Image& out);
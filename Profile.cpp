@@ -0,0 +1,224 @@
+/*	Profile.cpp
+	Jayden Fullerton
+
+	This file contains the instrumentation used to find where the time of a
+	run goes. Events are only recorded for phases, which last at least a
+	region or a strip, so they are kept in one vector behind a mutex.
+	Counters are relaxed atomics. Threads are numbered in the order they
+	first record an event so the trace shows pool workers as separate rows.	*/
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Allocations.h"
+#include "Profile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/*	ProfileEvent struct
+
+	One timed run of a phase, times in microseconds since the program
+	started.	*/
+struct ProfileEvent
+{
+	const char* name;
+	int thread;
+	double start, wall, cpu;
+	long long allocations;
+};
+
+// Names of the counters in reports, in Counter order
+static const char* const COUNTER_NAMES[] = { "pixels_visited", "pixels_rejected", "segments_created", "max_region_size" };
+
+static std::mutex eventLock;
+static std::vector<ProfileEvent> events;
+static std::atomic<long long> counters[(int)Counter::Count];
+static std::atomic<int> threadCount(0);
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+/*	returns the CPU time used by the calling thread
+	@pre	none
+	@post	CPU time in nanoseconds is returned, 0 if it is not available	*/
+static long long threadCpuNanos()
+{
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user))
+		return 0;
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (long long)(k.QuadPart + u.QuadPart) * 100;
+#else
+	timespec now;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0)
+		return 0;
+	return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+/*	returns the number of the calling thread
+	@pre	none
+	@post	threads are numbered from 1 in the order they first ask	*/
+static int threadNumber()
+{
+	static thread_local int number = ++threadCount;
+	return number;
+}
+
+/*	is instrumentation compiled in
+	@pre	none
+	@post	true is returned if SEGMENTATION_PROFILE was defined	*/
+bool profilingEnabled()
+{
+#ifdef SEGMENTATION_PROFILE
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*	adds to a counter
+	@param	counter to add to
+	@param	amount to add
+	@pre	none
+	@post	counter is increased by amount, safe to call from any thread	*/
+void addCount(Counter counter, long long amount)
+{
+	counters[(int)counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+/*	raises a counter to a value
+	@param	counter to raise
+	@param	value the counter must be at least
+	@pre	none
+	@post	counter is the larger of its value and value, safe to call from
+			any thread	*/
+void maxCount(Counter counter, long long value)
+{
+	std::atomic<long long>& current = counters[(int)counter];
+	long long seen = current.load(std::memory_order_relaxed);
+	while (seen < value && !current.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+		;
+}
+
+/*	clears every recorded event and counter
+	@pre	no ScopedTimer is alive
+	@post	the profile is empty	*/
+void resetProfile()
+{
+	std::lock_guard<std::mutex> guard(eventLock);
+	events.clear();
+	for (std::atomic<long long>& counter : counters)
+		counter.store(0, std::memory_order_relaxed);
+}
+
+/*	writes a summary of the profile
+	@param	stream to write to
+	@pre	none
+	@post	calls, wall time, CPU time and allocations of every phase and the
+			value of every counter are written to out	*/
+void writeProfileReport(std::ostream& out)
+{
+	// phases in the order they first ran
+	std::vector<ProfileEvent> phases;
+	std::vector<int> calls;
+	{
+		std::lock_guard<std::mutex> guard(eventLock);
+		for (const ProfileEvent& event : events)
+		{
+			size_t i = 0;
+			while (i < phases.size() && std::string(phases[i].name) != event.name)
+				i++;
+			if (i == phases.size())
+			{
+				phases.push_back(event);
+				calls.push_back(1);
+				continue;
+			}
+			phases[i].wall += event.wall;
+			phases[i].cpu += event.cpu;
+			phases[i].allocations += event.allocations;
+			calls[i]++;
+		}
+	}
+
+	out << std::left << std::setw(20) << "phase" << std::right << std::setw(8) << "calls" << std::setw(12)
+		<< "wall ms" << std::setw(12) << "cpu ms" << std::setw(14) << "allocations" << std::endl;
+	for (size_t i = 0; i < phases.size(); i++)
+	{
+		out << std::left << std::setw(20) << phases[i].name << std::right << std::setw(8) << calls[i]
+			<< std::fixed << std::setprecision(2) << std::setw(12) << phases[i].wall / 1000 << std::setw(12)
+			<< phases[i].cpu / 1000 << std::defaultfloat << std::setw(14) << phases[i].allocations << std::endl;
+	}
+	for (int i = 0; i < (int)Counter::Count; i++)
+		out << std::left << std::setw(20) << COUNTER_NAMES[i] << std::right << std::setw(20)
+			<< counters[i].load(std::memory_order_relaxed) << std::endl;
+}
+
+/*	writes the profile in Chrome trace event format
+	@param	stream to write to
+	@pre	none
+	@post	every recorded event is written as a complete event on the thread
+			that ran it, followed by the counters, as one JSON object	*/
+void writeChromeTrace(std::ostream& out)
+{
+	std::lock_guard<std::mutex> guard(eventLock);
+	double end = 0;
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+	out << std::fixed << std::setprecision(3);
+	for (const ProfileEvent& event : events)
+	{
+		out << "{\"name\": \"" << event.name << "\", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+			<< event.thread << ", \"ts\": " << event.start << ", \"dur\": " << event.wall
+			<< ", \"args\": {\"cpu_us\": " << event.cpu << ", \"allocations\": " << event.allocations << "}}," << std::endl;
+		if (event.start + event.wall > end)
+			end = event.start + event.wall;
+	}
+	out << "{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"tid\": 0, \"ts\": " << end << ", \"args\": {";
+	for (int i = 0; i < (int)Counter::Count; i++)
+		out << (i > 0 ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << counters[i].load(std::memory_order_relaxed);
+	out << "}}" << std::endl << "]}" << std::endl;
+	out << std::defaultfloat;
+}
+
+/*	ScopedTimer constructor
+	@param	name of the phase, must outlive the profile (a literal)
+	@pre	none
+	@post	the wall time, thread CPU time and allocation count are noted	*/
+ScopedTimer::ScopedTimer(const char* name)
+{
+	this->name = name;
+	allocationStart = allocationCount().count;
+	cpuStart = threadCpuNanos();
+	start = std::chrono::steady_clock::now();
+}
+
+/*	ScopedTimer destructor
+	@pre	none
+	@post	an event of the phase covering the timer's lifetime is recorded	*/
+ScopedTimer::~ScopedTimer()
+{
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	ProfileEvent event;
+	event.name = name;
+	event.thread = threadNumber();
+	event.start = std::chrono::duration<double, std::micro>(start - epoch).count();
+	event.wall = std::chrono::duration<double, std::micro>(end - start).count();
+	event.cpu = (threadCpuNanos() - cpuStart) / 1000.0;
+	// allocations are counted process wide, so phases running at the same
+	// time on other threads are included
+	event.allocations = allocationCount().count - allocationStart;
+
+	std::lock_guard<std::mutex> guard(eventLock);
+	events.push_back(event);
+}
@@ -0,0 +1,102 @@
+/*	Profile.h
+	Jayden Fullerton
+
+	This file contains the instrumentation used to find where the time of a
+	run goes. PROFILE_SCOPE times the enclosing block (wall time, CPU time of
+	the calling thread and heap allocations) and records it as an event of
+	the named phase, PROFILE_COUNT and PROFILE_MAX update run-wide counters.
+	The macros only do anything when SEGMENTATION_PROFILE is defined (make
+	PROFILE=1), otherwise they compile to nothing and the hot loops are
+	unchanged. The recorded events are summarized per phase by
+	writeProfileReport() or written in Chrome trace event format by
+	writeChromeTrace(), which chrome://tracing and Perfetto can open.	*/
+#pragma once
+
+#include <chrono>
+#include <ostream>
+
+/*	Counter enum
+
+	Counters kept over a whole run.	*/
+enum class Counter
+{
+	PixelsVisited,		// pixels tested against a region or neighbour
+	PixelsRejected,		// pixels flood fill tested and did not add
+	SegmentsCreated,	// segments found in every image
+	MaxRegionSize,		// pixels in the largest segment of any image
+	Count				// number of counters, not a counter
+};
+
+/*	is instrumentation compiled in
+	@pre	none
+	@post	true is returned if SEGMENTATION_PROFILE was defined	*/
+bool profilingEnabled();
+
+/*	adds to a counter
+	@param	counter to add to
+	@param	amount to add
+	@pre	none
+	@post	counter is increased by amount, safe to call from any thread	*/
+void addCount(Counter counter, long long amount);
+
+/*	raises a counter to a value
+	@param	counter to raise
+	@param	value the counter must be at least
+	@pre	none
+	@post	counter is the larger of its value and value, safe to call from
+			any thread	*/
+void maxCount(Counter counter, long long value);
+
+/*	clears every recorded event and counter
+	@pre	no ScopedTimer is alive
+	@post	the profile is empty	*/
+void resetProfile();
+
+/*	writes a summary of the profile
+	@param	stream to write to
+	@pre	none
+	@post	calls, wall time, CPU time and allocations of every phase and the
+			value of every counter are written to out	*/
+void writeProfileReport(std::ostream& out);
+
+/*	writes the profile in Chrome trace event format
+	@param	stream to write to
+	@pre	none
+	@post	every recorded event is written as a complete event on the thread
+			that ran it, followed by the counters, as one JSON object	*/
+void writeChromeTrace(std::ostream& out);
+
+class ScopedTimer
+{
+	const char* name;
+	std::chrono::steady_clock::time_point start;
+	long long cpuStart;
+	long long allocationStart;
+public:
+	/*	ScopedTimer constructor
+		@param	name of the phase, must outlive the profile (a literal)
+		@pre	none
+		@post	the wall time, thread CPU time and allocation count are noted	*/
+	ScopedTimer(const char* name);
+
+	/*	ScopedTimer destructor
+		@pre	none
+		@post	an event of the phase covering the timer's lifetime is recorded	*/
+	~ScopedTimer();
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+
+#ifdef SEGMENTATION_PROFILE
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, amount) addCount(Counter::counter, (long long)(amount))
+#define PROFILE_MAX(counter, value) maxCount(Counter::counter, (long long)(value))
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#define PROFILE_MAX(counter, value) ((void)0)
+#endif
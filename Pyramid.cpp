@@ -0,0 +1,75 @@
+/*	Pyramid.cpp
+	Jayden Fullerton
+
+	This file contains the image pyramid: an image followed by copies of it
+	halved again and again, each pixel of a level combining a 2 x 2 block
+	(or, for Gaussian, a weighted 3 x 3 neighbourhood) of the level below.
+	Besides the box and Gaussian means used to look at an image at lower
+	resolution, a level can hold the smallest or largest value of every
+	channel over its block, which tells the coarse-to-fine segmenter how
+	much the colors of a block vary. Rows are combined with the vector
+	halving kernels, and large levels are built on several threads.	*/
+#include <algorithm>
+#include "Profile.h"
+#include "Pyramid.h"
+#include "ThreadPool.h"
+
+// Output rows a worker takes at a time
+static const int BAND_ROWS = 32;
+
+/*	halves an image
+	@param	image to halve
+	@param	how neighbouring pixels are combined
+	@param	threads to run on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	an image of (rows + 1) / 2 by (cols + 1) / 2 pixels is returned,
+			the last row and column of an odd size combine a single pixel	*/
+Image halveImage(const Image& in, Reduction reduction, int threads)
+{
+	PROFILE_SCOPE("halve");
+	int rows = in.getRows();
+	int cols = in.getCols();
+	Image out((rows + 1) / 2, (cols + 1) / 2);
+	if (rows == 0 || cols == 0)
+		return out;
+
+	// each worker combines rows into its own scratch row before halving it
+	std::vector<std::vector<pixel>> scratch(resolveThreads(threads), std::vector<pixel>(cols));
+	forEachBand(out.getRows(), BAND_ROWS, threads, [&](int worker, int first, int last)
+	{
+		pixel* combined = scratch[worker].data();
+		for (int row = first; row < last; row++)
+		{
+			const pixel* above = in.getRow(std::max(2 * row - 1, 0));
+			const pixel* centre = in.getRow(2 * row);
+			const pixel* below = in.getRow(std::min(2 * row + 1, rows - 1));
+			combineRows(above, centre, below, cols, reduction, combined);
+			halveRow(combined, cols, reduction, out.getRow(row));
+		}
+		return true;
+	});
+	return out;
+}
+
+/*	builds an image pyramid
+	@param	image at the base of the pyramid
+	@param	number of levels to build above the base
+	@param	how neighbouring pixels are combined
+	@param	levels to write, levels[k] is halved k + 1 times
+	@param	threads to run on, 0 for every hardware thread
+	@pre	levels must be non-negative, threads must be non-negative
+	@post	pyramid holds the levels above in, stopping early once a level
+			is a single pixel. The base is not copied	*/
+void buildPyramid(const Image& in, int levels, Reduction reduction, std::vector<Image>& pyramid, int threads)
+{
+	pyramid.clear();
+	pyramid.reserve(levels);	// below points into pyramid, so it must not move
+	const Image* below = &in;
+	for (int level = 0; level < levels; level++)
+	{
+		if (below->getRows() <= 1 && below->getCols() <= 1)
+			break;
+		pyramid.push_back(halveImage(*below, reduction, threads));
+		below = &pyramid.back();
+	}
+}
@@ -0,0 +1,36 @@
+/*	Pyramid.h
+	Jayden Fullerton
+
+	This file contains the image pyramid: an image followed by copies of it
+	halved again and again, each pixel of a level combining a 2 x 2 block
+	(or, for Gaussian, a weighted 3 x 3 neighbourhood) of the level below.
+	Besides the box and Gaussian means used to look at an image at lower
+	resolution, a level can hold the smallest or largest value of every
+	channel over its block, which tells the coarse-to-fine segmenter how
+	much the colors of a block vary. Rows are combined with the vector
+	halving kernels, and large levels are built on several threads.	*/
+#pragma once
+
+#include <vector>
+#include "ColorKernel.h"
+#include "Image.h"
+
+/*	halves an image
+	@param	image to halve
+	@param	how neighbouring pixels are combined
+	@param	threads to run on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	an image of (rows + 1) / 2 by (cols + 1) / 2 pixels is returned,
+			the last row and column of an odd size combine a single pixel	*/
+Image halveImage(const Image& in, Reduction reduction, int threads = 1);
+
+/*	builds an image pyramid
+	@param	image at the base of the pyramid
+	@param	number of levels to build above the base
+	@param	how neighbouring pixels are combined
+	@param	levels to write, levels[k] is halved k + 1 times
+	@param	threads to run on, 0 for every hardware thread
+	@pre	levels must be non-negative, threads must be non-negative
+	@post	pyramid holds the levels above in, stopping early once a level
+			is a single pixel. The base is not copied	*/
+void buildPyramid(const Image& in, int levels, Reduction reduction, std::vector<Image>& pyramid, int threads = 1);
@@ -0,0 +1,399 @@
+/*	PyramidSegmenter.cpp
+	Jayden Fullerton
+
+	This file contains a coarse-to-fine version of the union-find
+	segmentation. Pyramids of the smallest and largest value of every
+	channel tell, for every block of 2^k x 2^k pixels, whether its two most
+	different colors are still similar. Such a block is flat: every pair of
+	its pixels is similar, so it is connected and is labeled as one unit
+	without looking at its pixels. Blocks are taken from the coarsest level
+	down, a block inside a flat block takes the label of its parent, and
+	only the pixels outside flat blocks become units of their own. Units
+	are then united across their boundaries by comparing the pixel pairs
+	there, exactly as union-find compares them, so the labels are the same
+	as those of UnionFindSegmenter while large uniform regions cost a few
+	block tests instead of a union per pixel. Images with too few flat
+	blocks for that to pay off are handed to UnionFindSegmenter.
+
+	Every metric grows with the difference of each channel, so no two
+	pixels of a block are further apart than the pixel of its smallest
+	channels and the pixel of its largest, and testing those two is enough.	*/
+#include <algorithm>
+#include "ColorKernel.h"
+#include "Profile.h"
+#include "Pyramid.h"
+#include "PyramidSegmenter.h"
+
+// Fraction of the pixels flat blocks must cover for the pyramid to pay off.
+// A pixel of its own costs several times a union-find pixel, so below this
+// the image is handed to union-find instead
+static const double MIN_FLAT_FRACTION = 0.875;
+
+/*	PyramidSegmenter constructor
+	@param	metric and threshold two neighbours must be similar by
+	@param	levels of blocks above single pixels, so the largest blocks
+			are 2^levels pixels square
+	@param	threads to build the pyramids on, 0 for every hardware thread
+	@pre	levels must be positive, threads must be non-negative
+	@post	an instance of PyramidSegmenter is created	*/
+PyramidSegmenter::PyramidSegmenter(const Similarity& similarity, int levels, int threads)
+{
+	this->similarity = similarity;
+	this->levels = levels;
+	this->threads = threads;
+	flatPixels = 0;
+}
+
+/*	labels the 4-connected components of an image
+	@param	image to segment
+	@param	segmentation to write the result to
+	@pre	in must be a valid image object
+	@post	result holds the same labels and statistics as
+			UnionFindSegmenter would give	*/
+void PyramidSegmenter::segment(const Image& in, Segmentation& result)
+{
+	PROFILE_SCOPE("pyramid_segment");
+	int rows = in.getRows();
+	int cols = in.getCols();
+	result.rows = rows;
+	result.cols = cols;
+	result.labels.resize((size_t)rows * cols);
+	result.stats.clear();
+	flatPixels = 0;
+	if (rows == 0 || cols == 0)
+		return;
+	PROFILE_COUNT(PixelsVisited, (long long)rows * cols);
+
+	Image converted(0, 0);
+	const Image& colors = comparisonImage(in, similarity, converted);
+	std::vector<Image> low, high;
+	{
+		PROFILE_SCOPE("pyramid_build");
+		buildPyramid(colors, levels, Reduction::Min, low, threads);
+		buildPyramid(colors, levels, Reduction::Max, high, threads);
+	}
+
+	// The label map holds the unit of every pixel outside flat blocks until
+	// units are labeled
+	int32_t* units = result.labels.data();
+	bool flat;
+	switch (similarity.metric)
+	{
+	case Metric::L2:
+		flat = findUnits(L2Policy(similarity), low, high, rows, cols, units);
+		if (flat)
+			uniteUnits(L2Policy(similarity), colors, units);
+		break;
+	case Metric::Chebyshev:
+		flat = findUnits(ChebyshevPolicy(similarity), low, high, rows, cols, units);
+		if (flat)
+			uniteUnits(ChebyshevPolicy(similarity), colors, units);
+		break;
+	case Metric::Weighted:
+		flat = findUnits(WeightedPolicy(similarity), low, high, rows, cols, units);
+		if (flat)
+			uniteUnits(WeightedPolicy(similarity), colors, units);
+		break;
+	case Metric::Lab:
+		flat = findUnits(LabPolicy(similarity), low, high, rows, cols, units);
+		if (flat)
+			uniteUnits(LabPolicy(similarity), colors, units);
+		break;
+	default:
+		flat = findUnits(L1Policy(similarity), low, high, rows, cols, units);
+		if (flat)
+			uniteUnits(L1Policy(similarity), colors, units);
+		break;
+	}
+	if (!flat)
+	{
+		// too few flat blocks, union-find gives the same labels faster
+		UnionFindSegmenter(similarity).segment(in, result);
+		return;
+	}
+	labelUnits(in, result);
+}
+
+/*	assigns every pixel to a unit, coarsest level first
+	@param	metric policy
+	@param	smallest channel values of every block, levels 1 and up
+	@param	largest channel values of every block, levels 1 and up
+	@param	unit of every pixel outside flat blocks to write
+	@pre	units must hold one entry per pixel of the base image
+	@post	blocks holds every unit, level by level and in raster order
+			within a level, levelUnits holds the unit covering every
+			block of levels 1 and up (-1 for none), and units holds the
+			unit of every pixel no flat block covers. False is returned,
+			leaving the pixels unassigned, if flat blocks cover too little
+			of the image to pay off	*/
+template <class Policy>
+bool PyramidSegmenter::findUnits(const Policy& policy, const std::vector<Image>& low, const std::vector<Image>& high,
+	int rows, int cols, int32_t* units)
+{
+	PROFILE_SCOPE("pyramid_units");
+	int top = (int)low.size();
+	forest.reset(0);
+	blocks.clear();
+	levelStart.clear();
+	levelUnits.resize(top + 1);
+
+	// a block is a new unit if it is flat and its parent is not; one inside
+	// a flat parent belongs to the parent's unit
+	const int32_t* parent = nullptr;
+	int parentCols = 0;
+	for (int level = top; level > 0; level--)
+	{
+		int levelRows = low[level - 1].getRows();
+		int levelCols = low[level - 1].getCols();
+		levelUnits[level].resize((size_t)levelRows * levelCols);
+		levelStart.push_back((int)blocks.size());
+		for (int row = 0; row < levelRows; row++)
+		{
+			const int32_t* above = parent != nullptr ? parent + (size_t)(row / 2) * parentCols : nullptr;
+			const pixel* smallest = low[level - 1].getRow(row);
+			const pixel* largest = high[level - 1].getRow(row);
+			int32_t* line = levelUnits[level].data() + (size_t)row * levelCols;
+			for (int col = 0; col < levelCols; col++)
+			{
+				int32_t unit = above != nullptr ? above[col / 2] : -1;
+				if (unit < 0 && policy(smallest[col], largest[col]))
+				{
+					unit = forest.add();
+					blocks.push_back({ level, row, col });
+				}
+				line[col] = unit;
+			}
+		}
+		parent = levelUnits[level].data();
+		parentCols = levelCols;
+	}
+
+	if (parent != nullptr)
+	{
+		long long covered = 0;
+		for (const int32_t unit : levelUnits[1])
+			covered += unit >= 0;
+		if (covered * 4 < MIN_FLAT_FRACTION * rows * cols)
+			return false;
+	}
+
+	// single pixels are only written where no flat block covers them
+	levelStart.push_back((int)blocks.size());
+	for (int row = 0; row < rows; row++)
+	{
+		int32_t* line = units + (size_t)row * cols;
+		if (parent == nullptr)
+		{
+			for (int col = 0; col < cols; col++)
+			{
+				line[col] = forest.add();
+				blocks.push_back({ 0, row, col });
+			}
+			continue;
+		}
+
+		const int32_t* above = parent + (size_t)(row / 2) * parentCols;
+		for (int pair = 0; pair < parentCols; pair++)
+		{
+			if (above[pair] >= 0)
+				continue;
+			for (int col = 2 * pair; col < std::min(cols, 2 * pair + 2); col++)
+			{
+				line[col] = forest.add();
+				blocks.push_back({ 0, row, col });
+			}
+		}
+	}
+	return true;
+}
+
+/*	unites neighbouring units across their boundaries
+	@param	metric policy
+	@param	image distances are measured on
+	@param	unit of every pixel outside flat blocks
+	@pre	findUnits must have run
+	@post	two units are in one set if a pixel of one is similar to a
+			neighbouring pixel of the other	*/
+template <class Policy>
+void PyramidSegmenter::uniteUnits(const Policy& policy, const Image& colors, const int32_t* units)
+{
+	PROFILE_SCOPE("pyramid_unite");
+	int rows = colors.getRows();
+	int cols = colors.getCols();
+
+	// A pixel pair joins two different units only where it crosses the
+	// right or bottom edge of the first one, so only the edges of every unit
+	// are walked. The pixels along an edge meet the same neighbour over and
+	// over, so a neighbour just united is skipped.
+	int count = (int)blocks.size();
+	for (int unit = 0; unit < count; unit++)
+	{
+		const Block& block = blocks[unit];
+		int top = block.row << block.level;
+		int left = block.col << block.level;
+		int bottom = std::min(rows, top + (1 << block.level));
+		int right = std::min(cols, left + (1 << block.level));
+		if (right < cols)
+		{
+			int32_t last = -1;
+			for (int row = top; row < bottom; row++)
+			{
+				const pixel* line = colors.getRow(row);
+				int32_t other = unitAt(units, row, right, cols);
+				if (other != last && policy(line[right - 1], line[right]))
+				{
+					forest.unite(unit, other);
+					last = other;
+				}
+			}
+		}
+		if (bottom < rows)
+		{
+			const pixel* up = colors.getRow(bottom - 1);
+			const pixel* down = colors.getRow(bottom);
+			int32_t last = -1;
+			for (int col = left; col < right; col++)
+			{
+				int32_t other = unitAt(units, bottom, col, cols);
+				if (other != last && policy(up[col], down[col]))
+				{
+					forest.unite(unit, other);
+					last = other;
+				}
+			}
+		}
+	}
+}
+
+/*	returns the unit of a pixel
+	@param	unit of every pixel outside flat blocks
+	@param	row of the pixel
+	@param	column of the pixel
+	@param	columns of the base image
+	@pre	findUnits must have run
+	@post	the unit covering the pixel is returned	*/
+inline int32_t PyramidSegmenter::unitAt(const int32_t* units, int row, int col, int cols) const
+{
+	// every flat block covers whole blocks of level 1, whose map holds the
+	// unit of the coarsest flat block around them
+	if (levelUnits.size() > 1)
+	{
+		int32_t unit = levelUnits[1][(size_t)(row >> 1) * ((cols + 1) / 2) + (col >> 1)];
+		if (unit >= 0)
+			return unit;
+	}
+	return units[(size_t)row * cols + col];
+}
+
+/*	labels every unit, in the raster order of the segments' first pixels
+	@param	image to segment
+	@param	segmentation to write the labels and statistics to
+	@pre	uniteUnits must have run
+	@post	every pixel of result holds its label and result.stats the
+			statistics of every label	*/
+void PyramidSegmenter::labelUnits(const Image& in, Segmentation& result)
+{
+	PROFILE_SCOPE("pyramid_label");
+	int cols = in.getCols();
+	int rows = in.getRows();
+
+	// The units of every level are in the raster order of their top left
+	// corners, so merging the levels visits them in the order a raster scan
+	// first meets them and numbers the segments as union-find does
+	int levelCount = (int)levelStart.size();
+	std::vector<int> next(levelStart), end(levelCount);
+	std::vector<long long> key(levelCount);
+	for (int i = 0; i < levelCount; i++)
+		end[i] = i + 1 < levelCount ? levelStart[i + 1] : (int)blocks.size();
+	auto cornerOf = [&](int i)
+	{
+		if (next[i] == end[i])
+			return (long long)rows * cols;
+		const Block& block = blocks[next[i]];
+		return (long long)(block.row << block.level) * cols + (block.col << block.level);
+	};
+	for (int i = 0; i < levelCount; i++)
+		key[i] = cornerOf(i);
+
+	std::vector<int32_t> rootLabels(blocks.size(), -1);
+	std::vector<SegmentStats>& stats = result.stats;
+	int32_t* labels = result.labels.data();
+	for (size_t done = 0; done < blocks.size(); done++)
+	{
+		int level = 0;
+		for (int i = 1; i < levelCount; i++)
+		{
+			if (key[i] < key[level])
+				level = i;
+		}
+		int unit = next[level]++;
+		key[level] = cornerOf(level);
+
+		int root = forest.find(unit);
+		int32_t label = rootLabels[root];
+		if (label < 0)
+		{
+			label = (int32_t)stats.size();
+			rootLabels[root] = label;
+			stats.push_back(SegmentStats());
+		}
+		const Block& block = blocks[unit];
+		addUnit(in, block, stats[label]);
+
+		int top = block.row << block.level;
+		int left = block.col << block.level;
+		int bottom = std::min(rows, top + (1 << block.level));
+		int width = std::min(cols, left + (1 << block.level)) - left;
+		for (int row = top; row < bottom; row++)
+			std::fill_n(labels + (size_t)row * cols + left, width, label);
+	}
+}
+
+/*	adds the pixels of a unit to the statistics of its segment
+	@param	image to segment
+	@param	unit to add
+	@param	statistics of the unit's segment
+	@pre	none
+	@post	stats include every pixel of the unit	*/
+void PyramidSegmenter::addUnit(const Image& in, const Block& block, SegmentStats& stats)
+{
+	if (block.level == 0)
+	{
+		stats.add(in.getRow(block.row)[block.col], block.row, block.col);
+		return;
+	}
+
+	int top = block.row << block.level;
+	int left = block.col << block.level;
+	int bottom = std::min(in.getRows(), top + (1 << block.level));
+	int right = std::min(in.getCols(), left + (1 << block.level));
+	long long height = bottom - top, width = right - left;
+	long long sums[3] = { 0, 0, 0 }, squares[3] = { 0, 0, 0 };
+	for (int row = top; row < bottom; row++)
+		channelSums(in.getRow(row) + left, (int)width, sums, squares);
+	SegmentStats s;
+	s.count = height * width;
+	s.red = sums[0];
+	s.green = sums[1];
+	s.blue = sums[2];
+	s.redSq = squares[0];
+	s.greenSq = squares[1];
+	s.blueSq = squares[2];
+	// the coordinates of a rectangle sum in closed form
+	s.rowSum = width * (top + bottom - 1) * height / 2;
+	s.colSum = height * (left + right - 1) * width / 2;
+	s.minRow = top;
+	s.maxRow = bottom - 1;
+	s.minCol = left;
+	s.maxCol = right - 1;
+	stats.merge(s);
+	flatPixels += s.count;
+}
+
+/*	returns the pixels of the last image that were inside flat blocks
+	@pre	none
+	@post	number of pixels labeled a block at a time is returned	*/
+long long PyramidSegmenter::getFlatPixels() const
+{
+	return flatPixels;
+}
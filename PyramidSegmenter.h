@@ -0,0 +1,120 @@
+/*	PyramidSegmenter.h
+	Jayden Fullerton
+
+	This file contains a coarse-to-fine version of the union-find
+	segmentation. Pyramids of the smallest and largest value of every
+	channel tell, for every block of 2^k x 2^k pixels, whether its two most
+	different colors are still similar. Such a block is flat: every pair of
+	its pixels is similar, so it is connected and is labeled as one unit
+	without looking at its pixels. Blocks are taken from the coarsest level
+	down, a block inside a flat block takes the label of its parent, and
+	only the pixels outside flat blocks become units of their own. Units
+	are then united across their boundaries by comparing the pixel pairs
+	there, exactly as union-find compares them, so the labels are the same
+	as those of UnionFindSegmenter while large uniform regions cost a few
+	block tests instead of a union per pixel. Images with too few flat
+	blocks for that to pay off are handed to UnionFindSegmenter.	*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ColorMetric.h"
+#include "DisjointSet.h"
+#include "Image.h"
+#include "UnionFindSegmenter.h"
+
+class PyramidSegmenter
+{
+	/*	Block struct
+
+		The pixels a unit covers: a block of level k covers rows
+		row * 2^k to (row + 1) * 2^k - 1, and columns likewise, clipped to
+		the image.	*/
+	struct Block
+	{
+		int level;
+		int row, col;
+	};
+
+	/*	assigns every pixel to a unit, coarsest level first
+		@param	metric policy
+		@param	smallest channel values of every block, levels 1 and up
+		@param	largest channel values of every block, levels 1 and up
+		@param	unit of every pixel outside flat blocks to write
+		@pre	units must hold one entry per pixel of the base image
+		@post	blocks holds every unit, level by level and in raster order
+				within a level, levelUnits holds the unit covering every
+				block of levels 1 and up (-1 for none), and units holds the
+				unit of every pixel no flat block covers. False is returned,
+				leaving the pixels unassigned, if flat blocks cover too
+				little of the image to pay off	*/
+	template <class Policy>
+	bool findUnits(const Policy& policy, const std::vector<Image>& low, const std::vector<Image>& high,
+		int rows, int cols, int32_t* units);
+
+	/*	unites neighbouring units across their boundaries
+		@param	metric policy
+		@param	image distances are measured on
+		@param	unit of every pixel outside flat blocks
+		@pre	findUnits must have run
+		@post	two units are in one set if a pixel of one is similar to a
+				neighbouring pixel of the other	*/
+	template <class Policy>
+	void uniteUnits(const Policy& policy, const Image& colors, const int32_t* units);
+
+	/*	returns the unit of a pixel
+		@param	unit of every pixel outside flat blocks
+		@param	row of the pixel
+		@param	column of the pixel
+		@param	columns of the base image
+		@pre	findUnits must have run
+		@post	the unit covering the pixel is returned	*/
+	int32_t unitAt(const int32_t* units, int row, int col, int cols) const;
+
+	/*	labels every unit, in the raster order of the segments' first pixels
+		@param	image to segment
+		@param	segmentation to write the labels and statistics to
+		@pre	uniteUnits must have run
+		@post	every pixel of result holds its label and result.stats the
+				statistics of every label	*/
+	void labelUnits(const Image& in, Segmentation& result);
+
+	/*	adds the pixels of a unit to the statistics of its segment
+		@param	image to segment
+		@param	unit to add
+		@param	statistics of the unit's segment
+		@pre	none
+		@post	stats include every pixel of the unit	*/
+	void addUnit(const Image& in, const Block& block, SegmentStats& stats);
+
+	DisjointSet forest;
+	std::vector<Block> blocks;
+	std::vector<int> levelStart;				// first unit of every level, coarsest first
+	std::vector<std::vector<int32_t>> levelUnits;
+	Similarity similarity;
+	int levels;
+	int threads;
+	long long flatPixels;
+public:
+	/*	PyramidSegmenter constructor
+		@param	metric and threshold two neighbours must be similar by
+		@param	levels of blocks above single pixels, so the largest blocks
+				are 2^levels pixels square
+		@param	threads to build the pyramids on, 0 for every hardware thread
+		@pre	levels must be positive, threads must be non-negative
+		@post	an instance of PyramidSegmenter is created	*/
+	PyramidSegmenter(const Similarity& similarity = Similarity(), int levels = 4, int threads = 1);
+
+	/*	labels the 4-connected components of an image
+		@param	image to segment
+		@param	segmentation to write the result to
+		@pre	in must be a valid image object
+		@post	result holds the same labels and statistics as
+				UnionFindSegmenter would give	*/
+	void segment(const Image& in, Segmentation& result);
+
+	/*	returns the pixels of the last image that were inside flat blocks
+		@pre	none
+		@post	number of pixels labeled a block at a time is returned	*/
+	long long getFlatPixels() const;
+};
@@ -0,0 +1,185 @@
+/*	RawImage.cpp
+	Jayden Fullerton
+
+	This file contains the zero-copy input and output path for images that
+	are already uncompressed: binary PPM (P6) files and headerless raw RGB
+	frames. Input files are memory-mapped and the Image is a view over their
+	pixels, so nothing is decoded or copied. Output files are created at
+	their final size and mapped, so segmenting into the returned Image writes
+	the file directly and there is no encode step.	*/
+#include <cstdio>
+#include <cstring>
+#include "RawImage.h"
+
+/*	skips whitespace and comments in a PPM header
+	@param	file contents
+	@param	size of the file
+	@param	position to skip from
+	@pre	none
+	@post	pos is at the next header token or the end of the file	*/
+static void skipSpace(const unsigned char* data, size_t size, size_t& pos)
+{
+	while (pos < size)
+	{
+		if (data[pos] == '#')
+		{
+			while (pos < size && data[pos] != '\n')
+				pos++;
+		}
+		else if (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n')
+			pos++;
+		else
+			return;
+	}
+}
+
+/*	reads a number from a PPM header
+	@param	file contents
+	@param	size of the file
+	@param	position of the number, whitespace before it is skipped
+	@param	number read
+	@pre	none
+	@post	true is returned if a positive number that fits an int was read,
+			pos is after it	*/
+static bool readNumber(const unsigned char* data, size_t size, size_t& pos, int& value)
+{
+	skipSpace(data, size, pos);
+	long long number = 0;
+	size_t start = pos;
+	while (pos < size && data[pos] >= '0' && data[pos] <= '9' && number <= 0x7fffffff)
+		number = number * 10 + (data[pos++] - '0');
+	value = (int)number;
+	return pos > start && number > 0 && number <= 0x7fffffff;
+}
+
+/*	wraps the pixels of a mapped file in an Image
+	@param	mapped file
+	@param	offset of the first pixel
+	@param	number of rows
+	@param	number of columns
+	@pre	none
+	@post	an Image viewing the pixels is returned, 0 by 0 if the file is
+			invalid or too short	*/
+static Image view(const shared_ptr<MappedFile>& file, size_t offset, int rows, int cols)
+{
+	if (!file->isValid() || rows <= 0 || cols <= 0 || file->getSize() < offset
+		|| (file->getSize() - offset) / 3 / (size_t)cols < (size_t)rows)
+		return Image(0, 0);
+	return Image(file, offset, rows, cols);
+}
+
+/*	maps a binary PPM file as an Image
+	@param	name of the file
+	@pre	none
+	@post	an Image viewing the file's pixels is returned, 0 by 0 if the file
+			is not a P6 file with a maximum value of 255 or is too short.
+			Writing to the Image does not change the file	*/
+Image mapPpm(const std::string& filename)
+{
+	shared_ptr<MappedFile> file = make_shared<MappedFile>(filename, MappedFile::Mode::Read);
+	if (!file->isValid() || file->getSize() < 2 || memcmp(file->getData(), "P6", 2) != 0)
+		return Image(0, 0);
+
+	const unsigned char* data = file->getData();
+	size_t size = file->getSize();
+	size_t pos = 2;
+	int cols, rows, maxValue;
+	if (!readNumber(data, size, pos, cols) || !readNumber(data, size, pos, rows)
+		|| !readNumber(data, size, pos, maxValue) || maxValue != 255 || pos >= size)
+		return Image(0, 0);
+	// exactly one whitespace byte separates the header from the pixels
+	return view(file, pos + 1, rows, cols);
+}
+
+/*	reads a number from the header of an open PPM file
+	@param	file to read from
+	@param	number read
+	@pre	none
+	@post	true is returned if a positive number that fits an int was read,
+			the file is at the byte after it	*/
+static bool readNumber(FILE* file, int& value)
+{
+	int c = fgetc(file);
+	while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+	{
+		if (c == '#')
+		{
+			while (c != EOF && c != '\n')
+				c = fgetc(file);
+		}
+		c = fgetc(file);
+	}
+
+	long long number = 0;
+	bool digits = false;
+	while (c >= '0' && c <= '9' && number <= 0x7fffffff)
+	{
+		number = number * 10 + (c - '0');
+		digits = true;
+		c = fgetc(file);
+	}
+	// the byte after the number is whitespace, and after the last number
+	// it is the one byte that separates the header from the pixels
+	value = (int)number;
+	return digits && c != EOF && number > 0 && number <= 0x7fffffff;
+}
+
+/*	reads the header of a binary PPM file
+	@param	file open for reading at its start
+	@param	number of rows read
+	@param	number of columns read
+	@pre	none
+	@post	true is returned if the file starts with a P6 header with a maximum
+			value of 255, the file is then at the first pixel	*/
+bool readPpmHeader(FILE* file, int& rows, int& cols)
+{
+	int maxValue;
+	return fgetc(file) == 'P' && fgetc(file) == '6' && readNumber(file, cols) && readNumber(file, rows)
+		&& readNumber(file, maxValue) && maxValue == 255;
+}
+
+/*	maps a raw RGB file as an Image
+	@param	name of the file
+	@param	number of rows
+	@param	number of columns
+	@pre	none
+	@post	an Image viewing the file's pixels is returned, 0 by 0 if the file
+			holds fewer than rows * cols pixels. Writing to the Image does not
+			change the file	*/
+Image mapRaw(const std::string& filename, int rows, int cols)
+{
+	return view(make_shared<MappedFile>(filename, MappedFile::Mode::Read), 0, rows, cols);
+}
+
+/*	creates a binary PPM file to write an Image into
+	@param	name of the file
+	@param	number of rows
+	@param	number of columns
+	@pre	rows and cols must be positive
+	@post	the file is created with a P6 header and black pixels, and an Image
+			viewing its pixels is returned (0 by 0 if the file could not be
+			created). The file is complete once the Image is destroyed	*/
+Image createPpm(const std::string& filename, int rows, int cols)
+{
+	char header[64];
+	int length = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", cols, rows);
+	size_t pixels = (size_t)rows * cols * 3;
+	shared_ptr<MappedFile> file = make_shared<MappedFile>(filename, MappedFile::Mode::Write, length + pixels);
+	if (!file->isValid())
+		return Image(0, 0);
+	memcpy(file->getData(), header, length);
+	return view(file, length, rows, cols);
+}
+
+/*	creates a raw RGB file to write an Image into
+	@param	name of the file
+	@param	number of rows
+	@param	number of columns
+	@pre	rows and cols must be positive
+	@post	the file is created with black pixels and an Image viewing them is
+			returned (0 by 0 if the file could not be created). The file is
+			complete once the Image is destroyed	*/
+Image createRaw(const std::string& filename, int rows, int cols)
+{
+	return view(make_shared<MappedFile>(filename, MappedFile::Mode::Write, (size_t)rows * cols * 3), 0, rows, cols);
+}
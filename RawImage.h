@@ -0,0 +1,61 @@
+/*	RawImage.h
+	Jayden Fullerton
+
+	This file contains the zero-copy input and output path for images that
+	are already uncompressed: binary PPM (P6) files and headerless raw RGB
+	frames. Input files are memory-mapped and the Image is a view over their
+	pixels, so nothing is decoded or copied. Output files are created at
+	their final size and mapped, so segmenting into the returned Image writes
+	the file directly and there is no encode step.	*/
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include "Image.h"
+
+/*	maps a binary PPM file as an Image
+	@param	name of the file
+	@pre	none
+	@post	an Image viewing the file's pixels is returned, 0 by 0 if the file
+			is not a P6 file with a maximum value of 255 or is too short.
+			Writing to the Image does not change the file	*/
+Image mapPpm(const std::string& filename);
+
+/*	reads the header of a binary PPM file
+	@param	file open for reading at its start
+	@param	number of rows read
+	@param	number of columns read
+	@pre	none
+	@post	true is returned if the file starts with a P6 header with a maximum
+			value of 255, the file is then at the first pixel	*/
+bool readPpmHeader(FILE* file, int& rows, int& cols);
+
+/*	maps a raw RGB file as an Image
+	@param	name of the file
+	@param	number of rows
+	@param	number of columns
+	@pre	none
+	@post	an Image viewing the file's pixels is returned, 0 by 0 if the file
+			holds fewer than rows * cols pixels. Writing to the Image does not
+			change the file	*/
+Image mapRaw(const std::string& filename, int rows, int cols);
+
+/*	creates a binary PPM file to write an Image into
+	@param	name of the file
+	@param	number of rows
+	@param	number of columns
+	@pre	rows and cols must be positive
+	@post	the file is created with a P6 header and black pixels, and an Image
+			viewing its pixels is returned (0 by 0 if the file could not be
+			created). The file is complete once the Image is destroyed	*/
+Image createPpm(const std::string& filename, int rows, int cols);
+
+/*	creates a raw RGB file to write an Image into
+	@param	name of the file
+	@param	number of rows
+	@param	number of columns
+	@pre	rows and cols must be positive
+	@post	the file is created with black pixels and an Image viewing them is
+			returned (0 by 0 if the file could not be created). The file is
+			complete once the Image is destroyed	*/
+Image createRaw(const std::string& filename, int rows, int cols);
@@ -0,0 +1,348 @@
+/*	RegionGraph.cpp
+	Jayden Fullerton
+
+	This file contains the region adjacency graph of a segmentation, built in
+	one pass over its label map. Regions are the vertices, and two regions
+	are adjacent when a pixel of one is a 4-connected neighbour of a pixel of
+	the other. The graph is kept in compressed sparse row form: the
+	neighbours of every region are one sorted slice of a single array, and
+	every adjacency carries the length of the boundary the two regions share
+	and the color contrast across it. A segmentation and its graph can be
+	written to a binary file and read back, so other tools can reuse a
+	segmentation without recomputing it.	*/
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "MappedFile.h"
+#include "Profile.h"
+#include "RegionGraph.h"
+
+// Start of a segmentation file, followed by a version number
+static const char FILE_MAGIC[4] = { 'S', 'E', 'G', 'M' };
+static const int32_t FILE_VERSION = 1;
+
+// Bytes of the header: magic, version, rows, cols, regions and adjacency entries
+static const size_t HEADER_SIZE = 6 * sizeof(int32_t);
+
+// Values stored for the statistics of each region
+static const size_t STATS_FIELDS = 13;
+
+/*	Boundary struct
+
+	Pixel sides shared by two regions, found while scanning the label map.	*/
+struct Boundary
+{
+	int32_t a, b;	// a < b
+	int32_t length;
+	int64_t contrast;
+};
+
+/*	records one pixel side shared by two regions
+	@param	boundaries found so far
+	@param	label of one pixel
+	@param	label of the other pixel
+	@param	color of one pixel
+	@param	color of the other pixel
+	@pre	a and b must differ
+	@post	the side is added to the last boundary if it is between the same
+			regions, otherwise a new boundary is started	*/
+static void addBoundary(std::vector<Boundary>& found, int32_t a, int32_t b, const pixel& p, const pixel& q)
+{
+	if (a > b)
+		std::swap(a, b);
+	int contrast = abs(p.red - q.red) + abs(p.green - q.green) + abs(p.blue - q.blue);
+	// boundaries run along rows and columns, so the same pair usually repeats
+	if (!found.empty() && found.back().a == a && found.back().b == b)
+	{
+		found.back().length++;
+		found.back().contrast += contrast;
+		return;
+	}
+	Boundary edge;
+	edge.a = a;
+	edge.b = b;
+	edge.length = 1;
+	edge.contrast = contrast;
+	found.push_back(edge);
+}
+
+/*	RegionGraph constructor
+	@pre	none
+	@post	a graph with no regions is created	*/
+RegionGraph::RegionGraph()
+{
+	regions = 0;
+	offsets.assign(1, 0);
+}
+
+/*	returns the number of adjacent region pairs
+	@pre	none
+	@post	number of edges, each counted once, is returned	*/
+int RegionGraph::getEdges() const
+{
+	return (int)neighbours.size() / 2;
+}
+
+/*	finds the adjacency between two regions
+	@param	first region
+	@param	second region
+	@pre	a must be a region of the graph
+	@post	index into neighbours of b in a's slice is returned, -1 if
+			the regions are not adjacent	*/
+int RegionGraph::findEdge(int a, int b) const
+{
+	const int32_t* first = neighbours.data() + offsets[a];
+	const int32_t* last = neighbours.data() + offsets[a + 1];
+	const int32_t* found = std::lower_bound(first, last, b);
+	return found != last && *found == b ? (int)(found - neighbours.data()) : -1;
+}
+
+/*	builds the region adjacency graph of a segmentation
+	@param	image that was segmented
+	@param	segmentation of in
+	@param	graph to write to
+	@pre	seg must be a segmentation of in
+	@post	graph holds every adjacency of seg with its boundary statistics	*/
+void buildRegionGraph(const Image& in, const Segmentation& seg, RegionGraph& graph)
+{
+	PROFILE_SCOPE("region_graph");
+	int rows = seg.rows;
+	int cols = seg.cols;
+	graph.regions = (int)seg.stats.size();
+	graph.perimeter.assign(graph.regions, 0);
+
+	// Collect every differing pair of neighbours, left then up, a row at a time
+	std::vector<Boundary> found;
+	for (int row = 0; row < rows; row++)
+	{
+		const int32_t* labels = seg.labels.data() + (size_t)row * cols;
+		const pixel* colors = in.getRow(row);
+		graph.perimeter[labels[0]]++;
+		graph.perimeter[labels[cols - 1]]++;
+		for (int col = 1; col < cols; col++)
+		{
+			if (labels[col] != labels[col - 1])
+			{
+				graph.perimeter[labels[col]]++;
+				graph.perimeter[labels[col - 1]]++;
+				addBoundary(found, labels[col], labels[col - 1], colors[col], colors[col - 1]);
+			}
+		}
+
+		if (row == 0 || row == rows - 1)
+		{
+			for (int col = 0; col < cols; col++)
+				graph.perimeter[labels[col]] += rows == 1 ? 2 : 1;
+		}
+		if (row == 0)
+			continue;
+		const int32_t* upLabels = labels - cols;
+		const pixel* upColors = in.getRow(row - 1);
+		for (int col = 0; col < cols; col++)
+		{
+			if (labels[col] != upLabels[col])
+			{
+				graph.perimeter[labels[col]]++;
+				graph.perimeter[upLabels[col]]++;
+				addBoundary(found, labels[col], upLabels[col], colors[col], upColors[col]);
+			}
+		}
+	}
+
+	// Combine the pieces of every boundary: bucket them by their smaller
+	// region, then sort each (short) bucket by the larger one
+	std::vector<int32_t> start(graph.regions + 1, 0);
+	for (size_t i = 0; i < found.size(); i++)
+		start[found[i].a + 1]++;
+	for (int r = 0; r < graph.regions; r++)
+		start[r + 1] += start[r];
+	std::vector<Boundary> bucketed(found.size());
+	{
+		std::vector<int32_t> next(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < found.size(); i++)
+			bucketed[next[found[i].a]++] = found[i];
+	}
+	size_t edges = 0;
+	for (int r = 0; r < graph.regions; r++)
+	{
+		Boundary* first = bucketed.data() + start[r];
+		Boundary* last = bucketed.data() + start[r + 1];
+		std::sort(first, last, [](const Boundary& x, const Boundary& y) { return x.b < y.b; });
+		for (Boundary* piece = first; piece != last; piece++)
+		{
+			if (piece != first && found[edges - 1].b == piece->b)
+			{
+				found[edges - 1].length += piece->length;
+				found[edges - 1].contrast += piece->contrast;
+			}
+			else
+				found[edges++] = *piece;
+		}
+	}
+	found.resize(edges);
+	std::vector<Boundary>().swap(bucketed);
+
+	// Lay out both directions of every edge. Edges are sorted by (a, b), so
+	// a region's smaller neighbours are placed before its larger ones and
+	// each slice comes out sorted
+	graph.offsets.assign(graph.regions + 1, 0);
+	for (size_t i = 0; i < edges; i++)
+	{
+		graph.offsets[found[i].a + 1]++;
+		graph.offsets[found[i].b + 1]++;
+	}
+	for (int r = 0; r < graph.regions; r++)
+		graph.offsets[r + 1] += graph.offsets[r];
+	graph.neighbours.resize(edges * 2);
+	graph.edgeLength.resize(edges * 2);
+	graph.edgeContrast.resize(edges * 2);
+	std::vector<int32_t> next(graph.offsets.begin(), graph.offsets.end() - 1);
+	for (size_t i = 0; i < edges; i++)
+	{
+		const Boundary& edge = found[i];
+		int32_t forward = next[edge.a]++;
+		int32_t backward = next[edge.b]++;
+		graph.neighbours[forward] = edge.b;
+		graph.neighbours[backward] = edge.a;
+		graph.edgeLength[forward] = graph.edgeLength[backward] = edge.length;
+		graph.edgeContrast[forward] = graph.edgeContrast[backward] = edge.contrast;
+	}
+}
+
+/*	returns the size of a segmentation file
+	@param	number of rows
+	@param	number of columns
+	@param	number of regions
+	@param	number of adjacency entries, two per edge
+	@pre	all counts must be non-negative
+	@post	bytes of a file holding a segmentation of that size are returned	*/
+static unsigned long long fileSize(long long rows, long long cols, long long regions, long long entries)
+{
+	return HEADER_SIZE + rows * cols * sizeof(int32_t) + regions * STATS_FIELDS * sizeof(int64_t)
+		+ (regions + 1) * sizeof(int32_t) + entries * (2 * sizeof(int32_t) + sizeof(int64_t))
+		+ regions * sizeof(int32_t);
+}
+
+/*	writes a segmentation and its graph to a binary file
+	@param	name of the file
+	@param	segmentation to write
+	@param	region adjacency graph of seg
+	@pre	graph must have been built from seg
+	@post	the file holds the label map, statistics and graph in host byte
+			order, true is returned if it was written	*/
+bool writeSegmentation(const std::string& filename, const Segmentation& seg, const RegionGraph& graph)
+{
+	int32_t header[6] = { 0, FILE_VERSION, seg.rows, seg.cols, graph.regions, (int32_t)graph.neighbours.size() };
+	memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+	MappedFile file(filename, MappedFile::Mode::Write,
+		(size_t)fileSize(seg.rows, seg.cols, graph.regions, graph.neighbours.size()));
+	if (!file.isValid())
+		return false;
+
+	// The file is sized up front, so every section is copied into the mapping
+	unsigned char* out = file.getData();
+	auto put = [&](const void* data, size_t bytes)
+	{
+		if (bytes > 0)
+			memcpy(out, data, bytes);
+		out += bytes;
+	};
+	put(header, sizeof(header));
+	put(seg.labels.data(), seg.labels.size() * sizeof(int32_t));
+	for (int r = 0; r < graph.regions; r++)
+	{
+		const SegmentStats& s = seg.stats[r];
+		int64_t fields[STATS_FIELDS] = { s.count, s.red, s.green, s.blue, s.redSq, s.greenSq, s.blueSq,
+			s.rowSum, s.colSum, s.minRow, s.maxRow, s.minCol, s.maxCol };
+		put(fields, sizeof(fields));
+	}
+	put(graph.offsets.data(), graph.offsets.size() * sizeof(int32_t));
+	put(graph.neighbours.data(), graph.neighbours.size() * sizeof(int32_t));
+	put(graph.edgeLength.data(), graph.edgeLength.size() * sizeof(int32_t));
+	put(graph.edgeContrast.data(), graph.edgeContrast.size() * sizeof(int64_t));
+	put(graph.perimeter.data(), graph.perimeter.size() * sizeof(int32_t));
+	return true;
+}
+
+/*	reads a segmentation and its graph from a binary file
+	@param	name of the file
+	@param	segmentation to read into
+	@param	graph to read into
+	@pre	none
+	@post	seg and graph hold the contents of the file, false is returned
+			if it is not a well-formed file written by writeSegmentation()	*/
+bool readSegmentation(const std::string& filename, Segmentation& seg, RegionGraph& graph)
+{
+	MappedFile file(filename, MappedFile::Mode::Read);
+	if (!file.isValid() || file.getSize() < HEADER_SIZE || memcmp(file.getData(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+		return false;
+	int32_t header[6];
+	memcpy(header, file.getData(), sizeof(header));
+	int rows = header[2], cols = header[3], regions = header[4], entries = header[5];
+	if (header[1] != FILE_VERSION || rows <= 0 || cols <= 0 || regions < 0 || entries < 0
+		|| fileSize(rows, cols, regions, entries) != file.getSize())
+		return false;
+
+	const unsigned char* in = file.getData() + HEADER_SIZE;
+	auto get = [&](void* data, size_t bytes)
+	{
+		if (bytes > 0)
+			memcpy(data, in, bytes);
+		in += bytes;
+	};
+	seg.rows = rows;
+	seg.cols = cols;
+	seg.labels.resize((size_t)rows * cols);
+	get(seg.labels.data(), seg.labels.size() * sizeof(int32_t));
+	seg.stats.resize(regions);
+	for (int r = 0; r < regions; r++)
+	{
+		int64_t fields[STATS_FIELDS];
+		get(fields, sizeof(fields));
+		SegmentStats& s = seg.stats[r];
+		s.count = fields[0];
+		s.red = fields[1];
+		s.green = fields[2];
+		s.blue = fields[3];
+		s.redSq = fields[4];
+		s.greenSq = fields[5];
+		s.blueSq = fields[6];
+		s.rowSum = fields[7];
+		s.colSum = fields[8];
+		s.minRow = (int)fields[9];
+		s.maxRow = (int)fields[10];
+		s.minCol = (int)fields[11];
+		s.maxCol = (int)fields[12];
+	}
+	graph.regions = regions;
+	graph.offsets.resize(regions + 1);
+	get(graph.offsets.data(), graph.offsets.size() * sizeof(int32_t));
+	graph.neighbours.resize(entries);
+	get(graph.neighbours.data(), graph.neighbours.size() * sizeof(int32_t));
+	graph.edgeLength.resize(entries);
+	get(graph.edgeLength.data(), graph.edgeLength.size() * sizeof(int32_t));
+	graph.edgeContrast.resize(entries);
+	get(graph.edgeContrast.data(), graph.edgeContrast.size() * sizeof(int64_t));
+	graph.perimeter.resize(regions);
+	get(graph.perimeter.data(), graph.perimeter.size() * sizeof(int32_t));
+
+	// Every index must be in range so the result can be used without checks
+	if (graph.offsets[0] != 0 || graph.offsets[regions] != entries)
+		return false;
+	for (int r = 0; r < regions; r++)
+	{
+		if (graph.offsets[r + 1] < graph.offsets[r])
+			return false;
+	}
+	for (int i = 0; i < entries; i++)
+	{
+		if (graph.neighbours[i] < 0 || graph.neighbours[i] >= regions)
+			return false;
+	}
+	for (size_t i = 0; i < seg.labels.size(); i++)
+	{
+		if (seg.labels[i] < 0 || seg.labels[i] >= regions)
+			return false;
+	}
+	return true;
+}
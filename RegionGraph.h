@@ -0,0 +1,79 @@
+/*	RegionGraph.h
+	Jayden Fullerton
+
+	This file contains the region adjacency graph of a segmentation, built in
+	one pass over its label map. Regions are the vertices, and two regions
+	are adjacent when a pixel of one is a 4-connected neighbour of a pixel of
+	the other. The graph is kept in compressed sparse row form: the
+	neighbours of every region are one sorted slice of a single array, and
+	every adjacency carries the length of the boundary the two regions share
+	and the color contrast across it. A segmentation and its graph can be
+	written to a binary file and read back, so other tools can reuse a
+	segmentation without recomputing it.	*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Image.h"
+#include "UnionFindSegmenter.h"
+
+/*	RegionGraph struct
+
+	Adjacency of the regions of a segmentation. The neighbours of region r
+	are neighbours[offsets[r]] to neighbours[offsets[r + 1] - 1] in
+	increasing order, and every adjacency is stored once for each of its two
+	regions. edgeLength and edgeContrast run parallel to neighbours.	*/
+struct RegionGraph
+{
+	int regions;
+	std::vector<int32_t> offsets;		// regions + 1 entries
+	std::vector<int32_t> neighbours;
+	std::vector<int32_t> edgeLength;	// pixel sides the two regions share
+	std::vector<int64_t> edgeContrast;	// sum of the L1 color differences across those sides
+	std::vector<int32_t> perimeter;		// pixel sides of each region that face another region or the image border
+
+	/*	RegionGraph constructor
+		@pre	none
+		@post	a graph with no regions is created	*/
+	RegionGraph();
+
+	/*	returns the number of adjacent region pairs
+		@pre	none
+		@post	number of edges, each counted once, is returned	*/
+	int getEdges() const;
+
+	/*	finds the adjacency between two regions
+		@param	first region
+		@param	second region
+		@pre	a must be a region of the graph
+		@post	index into neighbours of b in a's slice is returned, -1 if
+				the regions are not adjacent	*/
+	int findEdge(int a, int b) const;
+};
+
+/*	builds the region adjacency graph of a segmentation
+	@param	image that was segmented
+	@param	segmentation of in
+	@param	graph to write to
+	@pre	seg must be a segmentation of in
+	@post	graph holds every adjacency of seg with its boundary statistics	*/
+void buildRegionGraph(const Image& in, const Segmentation& seg, RegionGraph& graph);
+
+/*	writes a segmentation and its graph to a binary file
+	@param	name of the file
+	@param	segmentation to write
+	@param	region adjacency graph of seg
+	@pre	graph must have been built from seg
+	@post	the file holds the label map, statistics and graph in host byte
+			order, true is returned if it was written	*/
+bool writeSegmentation(const std::string& filename, const Segmentation& seg, const RegionGraph& graph);
+
+/*	reads a segmentation and its graph from a binary file
+	@param	name of the file
+	@param	segmentation to read into
+	@param	graph to read into
+	@pre	none
+	@post	seg and graph hold the contents of the file, false is returned
+			if it is not a well-formed file written by writeSegmentation()	*/
+bool readSegmentation(const std::string& filename, Segmentation& seg, RegionGraph& graph);
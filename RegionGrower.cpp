@@ -0,0 +1,374 @@
+/*	RegionGrower.cpp
+	Jayden Fullerton
+
+	This file contains the region growing engine used to segment an Image into
+	groups of similar color. A region is grown from a seed pixel using an
+	iterative scanline flood fill: horizontal spans are filled at once and the
+	rows above and below are queued on an explicit frontier stack instead of
+	recursing once per pixel. The frontier is kept between regions so its
+	memory is allocated once per image. Which region owns each pixel is kept
+	in a label map, so the output image is only written once at the end, and
+	the statistics of each region are accumulated as its pixels are taken.
+	Spans are tested for similarity to the seed a block at a time, and the
+	color metric is a policy chosen once per region so its test is inlined
+	into the fill. In mean mode the reference color is refreshed from the
+	region's channel sums after every pixel is taken, so a region follows a
+	gradual shading instead of stopping a threshold away from its seed, and
+	spans are extended a pixel at a time so that each pixel is tested
+	against the mean of every pixel taken before it.	*/
+#include "Profile.h"
+#include "RegionGrower.h"
+
+// Pixels tested on each side of a span before the block grows to 64 in seed
+// mode, most spans of a fragmented image are short
+static const int FIRST_BLOCK = 8;
+
+/*	RegionGrower constructor
+	@param	image that will be segmented
+	@param	metric and threshold a pixel must be similar to the seed by
+	@param	color candidates are compared to
+	@pre	img must be a valid image object
+	@post	an instance of RegionGrower is created with every pixel of img
+			unvisited and its frontier preallocated for img's dimensions. img
+			is converted for the metric now if it needs it	*/
+RegionGrower::RegionGrower(const Image& img, const Similarity& similarity, Reference reference) : converted(0, 0)
+{
+	this->similarity = similarity;
+	this->reference = reference;
+	meanSum[0] = meanSum[1] = meanSum[2] = 0;
+	meanCount = 0;
+	compared = &comparisonImage(img, similarity, converted);
+	cols = img.getCols();
+	labels.assign((size_t)img.getRows() * cols, -1);
+	// a scanline fill queues at most a few runs per row, so this is
+	// enough for all but the most fragmented regions
+	frontier.reserve(2 * (img.getRows() + img.getCols()));
+	mask.resize(maskWords(cols));
+}
+
+/*	returns the similarity
+	@pre	none
+	@post	metric and threshold of this are returned	*/
+const Similarity& RegionGrower::getSimilarity() const
+{
+	return similarity;
+}
+
+/*	returns the reference color mode
+	@pre	none
+	@post	whether candidates are compared to the seed or the region mean
+			is returned	*/
+Reference RegionGrower::getReference() const
+{
+	return reference;
+}
+
+/*	is the pixel part of a region yet
+	@param	row of pixel
+	@param	column of pixel
+	@pre	row,col must be a pixel within the image
+	@post	true is returned if the pixel has been labeled, false otherwise	*/
+bool RegionGrower::isVisited(int row, int col) const
+{
+	return labels[(size_t)row * cols + col] >= 0;
+}
+
+/*	returns the label map
+	@pre	none
+	@post	label of every pixel in row-major order is returned, -1 for
+			pixels that are not in a region yet	*/
+const std::vector<int32_t>& RegionGrower::getLabels() const
+{
+	return labels;
+}
+
+/*	returns the statistics of every region
+	@pre	none
+	@post	statistics of every region grown so far are returned,
+			indexed by label	*/
+const std::vector<SegmentStats>& RegionGrower::getStats() const
+{
+	return stats;
+}
+
+/*	moves the label map and statistics out of the grower
+	@param	label map to swap into
+	@param	statistics to swap into
+	@pre	none
+	@post	labels and stats hold what getLabels() and getStats() held,
+			the grower holds whatever they held before	*/
+void RegionGrower::takeResult(std::vector<int32_t>& labels, std::vector<SegmentStats>& stats)
+{
+	this->labels.swap(labels);
+	this->stats.swap(stats);
+}
+
+/*	can the pixel be added to the current region
+	@param	metric policy
+	@param	seed color of the current region
+	@param	row of pixel
+	@param	column of pixel
+	@pre	row,col must be a pixel within the image
+	@post	true is returned if the pixel is unvisited and similar to seed	*/
+template <class Policy>
+bool RegionGrower::accepts(const Policy& policy, const pixel& seed, int row, int col) const
+{
+	return !isVisited(row, col) && policy(compared->getRow(row)[col], seed);
+}
+
+/*	adds a single pixel to the current region
+	@pre	row,col must be a pixel within in
+	@post	pixel is labeled with label and added to the label's
+			statistics	*/
+void RegionGrower::take(int row, int col, const Image& in, int32_t label)
+{
+	labels[(size_t)row * cols + col] = label;
+	stats[label].add(in.getRow(row)[col], row, col);
+	if (reference == Reference::Mean)
+	{
+		const pixel& p = compared->getRow(row)[col];
+		meanSum[0] += p.red;
+		meanSum[1] += p.green;
+		meanSum[2] += p.blue;
+		meanCount++;
+	}
+}
+
+/*	returns the color candidates are compared to
+	@param	seed color of the current region
+	@pre	at least one pixel of the current region has been taken
+	@post	seed is returned in seed mode, the rounded mean of the region's
+			compared colors in mean mode	*/
+pixel RegionGrower::regionColor(const pixel& seed) const
+{
+	if (reference == Reference::Seed)
+		return seed;
+	long long half = meanCount / 2;
+	pixel mean;
+	mean.red = (byte)((meanSum[0] + half) / meanCount);
+	mean.green = (byte)((meanSum[1] + half) / meanCount);
+	mean.blue = (byte)((meanSum[2] + half) / meanCount);
+	return mean;
+}
+
+/*	marks which pixels of a span can be added to the current region
+	@param	metric policy
+	@param	seed color of the current region
+	@param	row to scan
+	@param	first column of the span
+	@param	last column of the span
+	@pre	row must be within the image, left..right must be within the image
+	@post	bit i of mask is set if pixel left + i is unvisited and
+			similar to seed	*/
+template <class Policy>
+void RegionGrower::acceptMask(const Policy& policy, const pixel& seed, int row, int left, int right)
+{
+	int count = right - left + 1;
+	seedMask(policy, compared->getRow(row) + left, count, seed, mask.data());
+
+	// only the similar pixels need their label checked
+	const int32_t* rowLabels = labels.data() + (size_t)row * cols + left;
+	for (int w = 0; w < maskWords(count); w++)
+	{
+		uint64_t similar = mask[w];
+		while (similar != 0)
+		{
+			int bit = lowestBit(similar);
+			similar &= similar - 1;
+			if (rowLabels[w * 64 + bit] >= 0)
+				mask[w] &= ~((uint64_t)1 << bit);
+		}
+	}
+}
+
+/*	counts the accepted pixels at the start of a span
+	@param	metric policy
+	@param	seed color of the current region
+	@param	row to scan
+	@param	first column of the span
+	@param	last column of the span
+	@pre	row must be within the image, left..right must be within the
+			image and hold at most 64 pixels
+	@post	number of consecutive accepted pixels from left is returned	*/
+template <class Policy>
+int RegionGrower::rightRun(const Policy& policy, const pixel& seed, int row, int left, int right)
+{
+	seedMask(policy, compared->getRow(row) + left, right - left + 1, seed, mask.data());
+	int run = trailingOnes(mask[0]);
+	const int32_t* rowLabels = labels.data() + (size_t)row * cols + left;
+	for (int k = 0; k < run; k++)
+	{
+		if (rowLabels[k] >= 0)
+			return k;
+	}
+	return run;
+}
+
+/*	counts the accepted pixels at the end of a span
+	@param	metric policy
+	@param	seed color of the current region
+	@param	row to scan
+	@param	first column of the span
+	@param	last column of the span
+	@pre	row must be within the image, left..right must be within the
+			image and hold at most 64 pixels
+	@post	number of consecutive accepted pixels ending at right is returned	*/
+template <class Policy>
+int RegionGrower::leftRun(const Policy& policy, const pixel& seed, int row, int left, int right)
+{
+	seedMask(policy, compared->getRow(row) + left, right - left + 1, seed, mask.data());
+	const int32_t* rowLabels = labels.data() + (size_t)row * cols;
+	int col = right;
+	while (col >= left && (mask[0] >> (col - left) & 1) != 0 && rowLabels[col] < 0)
+		col--;
+	return right - col;
+}
+
+/*	queues one pixel for every run of accepted pixels on a row
+	@param	metric policy
+	@param	seed color of the current region
+	@param	row to scan
+	@param	first column of the span to scan
+	@param	last column of the span to scan
+	@pre	row must be within the image, left..right must be within the image
+	@post	frontier contains one entry per run of accepted pixels	*/
+template <class Policy>
+void RegionGrower::queueRuns(const Policy& policy, const pixel& seed, int row, int left, int right)
+{
+	acceptMask(policy, seed, row, left, right);
+
+	// a run starts at an accepted pixel whose left neighbour is not accepted,
+	// the rest of the run is picked up when that pixel's span is filled
+	uint64_t carry = 0;
+	PROFILE_COUNT(PixelsVisited, right - left + 1);
+	PROFILE_COUNT(PixelsRejected, right - left + 1);
+	for (int w = 0; w < maskWords(right - left + 1); w++)
+	{
+		PROFILE_COUNT(PixelsRejected, -countBits(mask[w]));
+		uint64_t starts = mask[w] & ~((mask[w] << 1) | carry);
+		carry = mask[w] >> 63;
+		while (starts != 0)
+		{
+			frontier.push_back({ row, left + w * 64 + lowestBit(starts) });
+			starts &= starts - 1;
+		}
+	}
+}
+
+/*	grows a region from a seed pixel
+	@param	row of the seed pixel
+	@param	column of the seed pixel
+	@param	image to draw pixels from
+	@param	label to give the pixels of the region
+	@pre	in must be the image the grower was made for, row,col must
+			be an unvisited pixel, label must be non-negative
+	@post	every unvisited pixel 4-connected to the seed whose color is
+			similar to the seed is labeled with label, and the statistics of
+			label are filled in. In mean mode a pixel is only taken if it is
+			similar to the mean of every pixel taken before it, so which
+			pixels join depends on the order the fill reaches them in	*/
+void RegionGrower::grow(int row, int col, const Image& in, int32_t label)
+{
+	switch (similarity.metric)
+	{
+	case Metric::L2:
+		fill(L2Policy(similarity), row, col, in, label);
+		break;
+	case Metric::Chebyshev:
+		fill(ChebyshevPolicy(similarity), row, col, in, label);
+		break;
+	case Metric::Weighted:
+		fill(WeightedPolicy(similarity), row, col, in, label);
+		break;
+	case Metric::Lab:
+		fill(LabPolicy(similarity), row, col, in, label);
+		break;
+	default:
+		fill(L1Policy(similarity), row, col, in, label);
+		break;
+	}
+}
+
+/*	grows a region from a seed pixel with a metric
+	@param	metric policy
+	@param	row of the seed pixel
+	@param	column of the seed pixel
+	@param	image to draw pixels from
+	@param	label to give the pixels of the region
+	@pre	see grow()
+	@post	see grow()	*/
+template <class Policy>
+void RegionGrower::fill(const Policy& policy, int row, int col, const Image& in, int32_t label)
+{
+	const pixel seed = compared->getRow(row)[col];
+	pixel color = seed;		// the reference color, the seed or the running mean
+	bool atSeed = true;
+	if ((size_t)label >= stats.size())
+		stats.resize(label + 1);
+	meanSum[0] = meanSum[1] = meanSum[2] = 0;
+	meanCount = 0;
+
+	frontier.clear();
+	frontier.push_back({ row, col });
+	while (!frontier.empty())
+	{
+		Span s = frontier.back();
+		frontier.pop_back();
+
+		// pixel may have been filled by another span since it was queued
+		if (!atSeed && !accepts(policy, color, s.row, s.col))
+		{
+			PROFILE_COUNT(PixelsVisited, 1);
+			PROFILE_COUNT(PixelsRejected, 1);
+			continue;
+		}
+		atSeed = false;
+
+		// fill the whole horizontal span containing this pixel, testing a
+		// block of pixels on each side at a time
+		take(s.row, s.col, in, label);
+		color = regionColor(seed);
+		// In mean mode the reference moves with every pixel taken, so a span
+		// is extended a pixel at a time and each pixel is tested against the
+		// mean of every pixel taken before it
+		int firstBlock = reference == Reference::Mean ? 1 : FIRST_BLOCK;
+		int nextBlock = reference == Reference::Mean ? 1 : 64;
+		int left = s.col;
+		int right = s.col;
+		int block = firstBlock;
+		while (left > 0 && accepts(policy, color, s.row, left - 1))
+		{
+			int first = left > block ? left - block : 0;
+			int run = leftRun(policy, color, s.row, first, left - 1);
+			for (int k = 0; k < run; k++)
+				take(s.row, --left, in, label);
+			color = regionColor(seed);
+			if (left != first)
+				break;
+			block = nextBlock;
+		}
+		// the pixel that stopped the span, if any, was rejected
+		PROFILE_COUNT(PixelsVisited, s.col - left + (left > 0));
+		PROFILE_COUNT(PixelsRejected, left > 0);
+		block = firstBlock;
+		while (right + 1 < in.getCols() && accepts(policy, color, s.row, right + 1))
+		{
+			int last = right + block < in.getCols() ? right + block : in.getCols() - 1;
+			int run = rightRun(policy, color, s.row, right + 1, last);
+			for (int k = 0; k < run; k++)
+				take(s.row, ++right, in, label);
+			color = regionColor(seed);
+			if (right != last)
+				break;
+			block = nextBlock;
+		}
+		PROFILE_COUNT(PixelsVisited, right - s.col + 1 + (right + 1 < in.getCols()));
+		PROFILE_COUNT(PixelsRejected, right + 1 < in.getCols());
+
+		// queue the runs above and below the span
+		if (s.row - 1 >= 0)
+			queueRuns(policy, color, s.row - 1, left, right);
+		if (s.row + 1 < in.getRows())
+			queueRuns(policy, color, s.row + 1, left, right);
+	}
+}
@@ -0,0 +1,202 @@
+/*	RegionGrower.h
+	Jayden Fullerton
+
+	This file contains the region growing engine used to segment an Image into
+	groups of similar color. A region is grown from a seed pixel using an
+	iterative scanline flood fill: horizontal spans are filled at once and the
+	rows above and below are queued on an explicit frontier stack instead of
+	recursing once per pixel. The frontier is kept between regions so its
+	memory is allocated once per image. Which region owns each pixel is kept
+	in a label map, so the output image is only written once at the end, and
+	the statistics of each region are accumulated as its pixels are taken.
+	Candidates are compared either to the seed pixel or to the running mean
+	of the region, which is kept as channel sums updated as each pixel is
+	taken so it never has to re-read the region's pixels.	*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ColorMetric.h"
+#include "Image.h"
+#include "SegmentStats.h"
+
+/*	Reference enum
+
+	Selects the color a candidate pixel is compared to.	*/
+enum class Reference
+{
+	Seed,	// the color of the region's seed pixel
+	Mean	// the mean color of the pixels taken so far
+};
+
+class RegionGrower
+{
+	/*	Span struct
+
+		A pixel queued on the frontier. Only one pixel is queued for every run
+		of accepted pixels found on a neighbouring row, which keeps the stack
+		small even for very large regions.	*/
+	struct Span
+	{
+		int row, col;
+	};
+
+	/*	can the pixel be added to the current region
+		@param	metric policy
+		@param	seed color of the current region
+		@param	row of pixel
+		@param	column of pixel
+		@pre	row,col must be a pixel within the image
+		@post	true is returned if the pixel is unvisited and similar to seed	*/
+	template <class Policy>
+	bool accepts(const Policy& policy, const pixel& seed, int row, int col) const;
+
+	/*	adds a single pixel to the current region
+		@pre	row,col must be a pixel within in
+		@post	pixel is labeled with label and added to the label's
+				statistics	*/
+	void take(int row, int col, const Image& in, int32_t label);
+
+	/*	returns the color candidates are compared to
+		@param	seed color of the current region
+		@pre	at least one pixel of the current region has been taken
+		@post	seed is returned in seed mode, the rounded mean of the region's
+				compared colors in mean mode	*/
+	pixel regionColor(const pixel& seed) const;
+
+	/*	marks which pixels of a span can be added to the current region
+		@param	metric policy
+		@param	seed color of the current region
+		@param	row to scan
+		@param	first column of the span
+		@param	last column of the span
+		@pre	row must be within the image, left..right must be within the image
+		@post	bit i of mask is set if pixel left + i is unvisited and
+				similar to seed	*/
+	template <class Policy>
+	void acceptMask(const Policy& policy, const pixel& seed, int row, int left, int right);
+
+	/*	counts the accepted pixels at the start of a span
+		@param	metric policy
+		@param	seed color of the current region
+		@param	row to scan
+		@param	first column of the span
+		@param	last column of the span
+		@pre	row must be within the image, left..right must be within the
+				image and hold at most 64 pixels
+		@post	number of consecutive accepted pixels from left is returned	*/
+	template <class Policy>
+	int rightRun(const Policy& policy, const pixel& seed, int row, int left, int right);
+
+	/*	counts the accepted pixels at the end of a span
+		@param	metric policy
+		@param	seed color of the current region
+		@param	row to scan
+		@param	first column of the span
+		@param	last column of the span
+		@pre	row must be within the image, left..right must be within the
+				image and hold at most 64 pixels
+		@post	number of consecutive accepted pixels ending at right is returned	*/
+	template <class Policy>
+	int leftRun(const Policy& policy, const pixel& seed, int row, int left, int right);
+
+	/*	queues one pixel for every run of accepted pixels on a row
+		@param	metric policy
+		@param	seed color of the current region
+		@param	row to scan
+		@param	first column of the span to scan
+		@param	last column of the span to scan
+		@pre	row must be within the image, left..right must be within the image
+		@post	frontier contains one entry per run of accepted pixels	*/
+	template <class Policy>
+	void queueRuns(const Policy& policy, const pixel& seed, int row, int left, int right);
+
+	/*	grows a region from a seed pixel with a metric
+		@param	metric policy
+		@param	row of the seed pixel
+		@param	column of the seed pixel
+		@param	image to draw pixels from
+		@param	label to give the pixels of the region
+		@pre	see grow()
+		@post	see grow()	*/
+	template <class Policy>
+	void fill(const Policy& policy, int row, int col, const Image& in, int32_t label);
+
+	std::vector<Span> frontier;
+	std::vector<uint64_t> mask;
+	std::vector<int32_t> labels;
+	std::vector<SegmentStats> stats;
+	Similarity similarity;
+	Image converted;		// the image converted for the metric, if it needs it
+	const Image* compared;	// the image distances are measured on
+	int cols;
+	Reference reference;
+	long long meanSum[3];	// channel sums of the current region in compared colors
+	int meanCount;
+public:
+	/*	RegionGrower constructor
+		@param	image that will be segmented
+		@param	metric and threshold a pixel must be similar to the seed by
+		@param	color candidates are compared to
+		@pre	img must be a valid image object
+		@post	an instance of RegionGrower is created with every pixel of img
+				unvisited and its frontier preallocated for img's dimensions. img
+				is converted for the metric now if it needs it	*/
+	RegionGrower(const Image& img, const Similarity& similarity = Similarity(), Reference reference = Reference::Seed);
+
+	// compared may point into the grower, so it is not copied
+	RegionGrower(const RegionGrower&) = delete;
+	RegionGrower& operator=(const RegionGrower&) = delete;
+
+	/*	grows a region from a seed pixel
+		@param	row of the seed pixel
+		@param	column of the seed pixel
+		@param	image to draw pixels from
+		@param	label to give the pixels of the region
+		@pre	in must be the image the grower was made for, row,col must
+				be an unvisited pixel, label must be non-negative
+		@post	every unvisited pixel 4-connected to the seed whose color is
+				similar to the seed is labeled with label, and the statistics of
+				label are filled in. In mean mode a pixel is only taken if it is
+				similar to the mean of every pixel taken before it, so which
+				pixels join depends on the order the fill reaches them in	*/
+	void grow(int row, int col, const Image& in, int32_t label);
+
+	/*	is the pixel part of a region yet
+		@param	row of pixel
+		@param	column of pixel
+		@pre	row,col must be a pixel within the image
+		@post	true is returned if the pixel has been labeled, false otherwise	*/
+	bool isVisited(int row, int col) const;
+
+	/*	returns the label map
+		@pre	none
+		@post	label of every pixel in row-major order is returned, -1 for
+				pixels that are not in a region yet	*/
+	const std::vector<int32_t>& getLabels() const;
+
+	/*	returns the statistics of every region
+		@pre	none
+		@post	statistics of every region grown so far are returned,
+				indexed by label	*/
+	const std::vector<SegmentStats>& getStats() const;
+
+	/*	moves the label map and statistics out of the grower
+		@param	label map to swap into
+		@param	statistics to swap into
+		@pre	none
+		@post	labels and stats hold what getLabels() and getStats() held,
+				the grower holds whatever they held before	*/
+	void takeResult(std::vector<int32_t>& labels, std::vector<SegmentStats>& stats);
+
+	/*	returns the similarity
+		@pre	none
+		@post	metric and threshold of this are returned	*/
+	const Similarity& getSimilarity() const;
+
+	/*	returns the reference color mode
+		@pre	none
+		@post	whether candidates are compared to the seed or the region mean
+				is returned	*/
+	Reference getReference() const;
+};
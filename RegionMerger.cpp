@@ -0,0 +1,310 @@
+/*	RegionMerger.cpp
+	Jayden Fullerton
+
+	This file contains an optional post-pass that collapses the small
+	fragments a fixed threshold leaves on noisy or dithered images. Working
+	on the region adjacency graph rather than on pixels, adjacent regions are
+	merged closest mean color first while one of them is smaller than a
+	minimum size or their mean colors are closer than a merge threshold.
+	Candidate pairs wait in a priority queue keyed by their distance: every
+	pair closer than the threshold, and every small region with its closest
+	neighbour. A merge only combines the two regions' statistics and splices
+	their lists of original regions together, and only re-measures the
+	neighbours of its smaller side, so draining the queue runs in
+	O(E log E) for E adjacencies and allocates nothing per merge. A pair on
+	the larger side may have come under the threshold as the merged mean
+	moved, so once the queue is empty every adjacency is measured again and
+	the queue drained again until no pair is closer than the threshold. The
+	label map is rewritten once at the end.	*/
+#include <utility>
+#include "Profile.h"
+#include "RegionMerger.h"
+
+/*	RegionMerger constructor
+	@param	metric mean colors are compared with, its threshold is unused
+	@param	regions with fewer pixels are merged into their closest
+			neighbour, 0 for no minimum
+	@param	neighbours whose mean colors are closer are merged, 0 to
+			merge by size only
+	@pre	none
+	@post	an instance of RegionMerger is created	*/
+RegionMerger::RegionMerger(const Similarity& similarity, int minSize, int threshold)
+{
+	this->similarity = similarity;
+	this->minSize = minSize;
+	this->threshold = threshold;
+	graph = nullptr;
+	merges = 0;
+}
+
+/*	measures the distance between the mean colors of two regions
+	@param	first region's root
+	@param	second region's root
+	@pre	a and b must be roots of the forest
+	@post	distance in the metric's units is returned	*/
+double RegionMerger::distance(int a, int b) const
+{
+	return colorDistance(similarity, colors[a], colors[b]);
+}
+
+/*	is a region below the minimum size
+	@param	region's root
+	@pre	r must be a root of the forest
+	@post	true is returned if r has fewer pixels than the minimum	*/
+bool RegionMerger::small(int r) const
+{
+	return sizes[r] < minSize;
+}
+
+/*	queues two regions if their mean colors are close enough
+	@param	first region's root
+	@param	second region's root
+	@pre	a and b must be roots of the forest
+	@post	the pair is queued if it differs and its distance is below
+			the merge threshold	*/
+void RegionMerger::offer(int a, int b)
+{
+	if (a == b || threshold <= 0)
+		return;
+	Candidate c;
+	c.distance = distance(a, b);
+	c.a = a;
+	c.b = b;
+	if (c.distance < threshold)
+		queue.push(c);
+}
+
+/*	queues a small region with its closest neighbour
+	@param	region's root
+	@pre	r must be a root of the forest
+	@post	if r is below the minimum size and has a neighbour, the pair
+			of r and its closest neighbour is queued	*/
+void RegionMerger::offerClosest(int r)
+{
+	if (!small(r))
+		return;
+
+	// a small region is made of fewer original regions than the minimum
+	// size, so walking all of their neighbours is cheap
+	Candidate best;
+	best.a = r;
+	best.b = -1;
+	best.distance = 0;
+	int member = r;
+	do
+	{
+		for (int i = graph->offsets[member]; i < graph->offsets[member + 1]; i++)
+		{
+			int n = forest.find(graph->neighbours[i]);
+			if (n == r)
+				continue;
+			double d = distance(r, n);
+			if (best.b < 0 || d < best.distance)
+			{
+				best.b = n;
+				best.distance = d;
+			}
+		}
+		member = nextMember[member];
+	} while (member != r);
+
+	if (best.b >= 0)
+		queue.push(best);
+}
+
+/*	merges two regions
+	@param	first region's root
+	@param	second region's root
+	@pre	a and b must be different roots of the forest
+	@post	the regions are one with combined statistics and neighbours,
+			and the pairs the merged region is now in are queued	*/
+void RegionMerger::absorb(int a, int b)
+{
+	int root = forest.unite(a, b);
+	int other = root == a ? b : a;
+	stats[root].merge(stats[other]);
+	sizes[root] = stats[root].count;
+	colors[root] = comparisonColor(similarity, stats[root].average());
+	merges++;
+
+	// The neighbours of the side with fewer adjacency entries are new to
+	// the merged region and are queued if they are close, so an entry is
+	// walked O(log E) times. The pairs already in the queue are measured
+	// again when they leave it. Neighbours of the larger side that were not
+	// queued are not measured here, merge() finds them with rescan()
+	if (threshold > 0)
+	{
+		int walked = entries[root] < entries[other] ? root : other;
+		int member = walked;
+		do
+		{
+			for (int i = graph->offsets[member]; i < graph->offsets[member + 1]; i++)
+			{
+				// neighbours of several original regions are queued once
+				int n = forest.find(graph->neighbours[i]);
+				if (offered[n] != merges)
+				{
+					offered[n] = merges;
+					offer(root, n);
+				}
+			}
+			member = nextMember[member];
+		} while (member != walked);
+	}
+
+	// Swapping one successor of each circular list joins them into one
+	std::swap(nextMember[root], nextMember[other]);
+	entries[root] += entries[other];
+	offerClosest(root);
+}
+
+/*	merges queued pairs until the queue is empty
+	@pre	none
+	@post	every queued pair that may still be merged when it leaves
+			the queue is merged	*/
+void RegionMerger::drain()
+{
+	while (!queue.empty())
+	{
+		Candidate c = queue.top();
+		queue.pop();
+		int a = forest.find(c.a);
+		int b = forest.find(c.b);
+		if (a == b)
+			continue;
+
+		// A merge since the pair was queued may have moved either mean
+		// color away, then the pair goes back in at its real distance and
+		// a small region looks for its closest neighbour again
+		double d = distance(a, b);
+		if (d > c.distance)
+		{
+			offer(a, b);
+			offerClosest(a);
+			offerClosest(b);
+		}
+		else if (d < threshold || small(a) || small(b))
+			absorb(a, b);
+	}
+}
+
+/*	queues every adjacent pair of regions that is close enough
+	@pre	none
+	@post	every pair of different adjacent regions whose distance is
+			below the merge threshold is queued, true is returned if
+			any was	*/
+bool RegionMerger::rescan()
+{
+	bool queued = false;
+	for (int r = 0; r < graph->regions; r++)
+	{
+		int a = forest.find(r);
+		for (int i = graph->offsets[r]; i < graph->offsets[r + 1]; i++)
+		{
+			// every adjacency of original regions is measured once, an
+			// adjacency inside a merged region is skipped
+			Candidate c;
+			c.a = a;
+			c.b = forest.find(graph->neighbours[i]);
+			if (graph->neighbours[i] < r || c.a == c.b)
+				continue;
+			c.distance = distance(c.a, c.b);
+			if (c.distance < threshold)
+			{
+				queue.push(c);
+				queued = true;
+			}
+		}
+	}
+	return queued;
+}
+
+/*	merges the regions of a segmentation
+	@param	segmentation to merge, rewritten in place
+	@param	region adjacency graph of seg
+	@pre	graph must have been built from seg
+	@post	no region of seg is below the minimum size unless it has no
+			neighbour, no two adjacent regions are closer than the merge
+			threshold, labels are dense and numbered in the order their
+			first pixel appears in a raster scan	*/
+void RegionMerger::merge(Segmentation& seg, const RegionGraph& graph)
+{
+	PROFILE_SCOPE("region_merge");
+	int regions = graph.regions;
+	this->graph = &graph;
+	merges = 0;
+	forest.reset(regions);
+	stats = seg.stats;
+	sizes.resize(regions);
+	colors.resize(regions);
+	nextMember.resize(regions);
+	entries.resize(regions);
+	offered.assign(regions, 0);
+	for (int r = 0; r < regions; r++)
+	{
+		sizes[r] = stats[r].count;
+		colors[r] = comparisonColor(similarity, stats[r].average());
+		nextMember[r] = r;
+		entries[r] = graph.offsets[r + 1] - graph.offsets[r];
+	}
+
+	// Every pair closer than the threshold is queued, heapified in one pass,
+	// then every small region with its closest neighbour
+	std::vector<Candidate> initial;
+	for (int r = 0; r < regions && threshold > 0; r++)
+	{
+		for (int i = graph.offsets[r]; i < graph.offsets[r + 1]; i++)
+		{
+			Candidate c;
+			c.a = r;
+			c.b = graph.neighbours[i];
+			c.distance = distance(c.a, c.b);
+			if (c.b > r && c.distance < threshold)
+				initial.push_back(c);
+		}
+	}
+	queue = std::priority_queue<Candidate>(std::less<Candidate>(), std::move(initial));
+	for (int r = 0; r < regions; r++)
+		offerClosest(r);
+
+	// Every pass that queues a pair merges at least that pair, so this ends
+	drain();
+	while (threshold > 0 && rescan())
+		drain();
+	if (merges == 0)
+		return;
+
+	// A merged region takes the smallest label in it, which is the one whose
+	// first pixel comes first, so the new labels keep raster order
+	std::vector<int32_t> relabel(regions, -1);
+	std::vector<SegmentStats> merged;
+	merged.reserve(regions - merges);
+	for (int r = 0; r < regions; r++)
+	{
+		int root = forest.find(r);
+		if (relabel[root] < 0)
+		{
+			relabel[root] = (int32_t)merged.size();
+			merged.push_back(stats[root]);
+		}
+		relabel[r] = relabel[root];
+	}
+	for (size_t i = 0; i < seg.labels.size(); i++)
+		seg.labels[i] = relabel[seg.labels[i]];
+	seg.stats.swap(merged);
+
+	stats.clear();
+	sizes.clear();
+	colors.clear();
+	nextMember.clear();
+	entries.clear();
+	offered.clear();
+}
+
+/*	returns the number of merges done by the last merge()
+	@pre	none
+	@post	number of regions merged away is returned	*/
+int RegionMerger::getMerges() const
+{
+	return merges;
+}
@@ -0,0 +1,136 @@
+/*	RegionMerger.h
+	Jayden Fullerton
+
+	This file contains an optional post-pass that collapses the small
+	fragments a fixed threshold leaves on noisy or dithered images. Working
+	on the region adjacency graph rather than on pixels, adjacent regions are
+	merged closest mean color first while one of them is smaller than a
+	minimum size or their mean colors are closer than a merge threshold.
+	Candidate pairs wait in a priority queue keyed by their distance: every
+	pair closer than the threshold, and every small region with its closest
+	neighbour. A merge only combines the two regions' statistics and splices
+	their lists of original regions together, and only re-measures the
+	neighbours of its smaller side, so draining the queue runs in
+	O(E log E) for E adjacencies and allocates nothing per merge. A pair on
+	the larger side may have come under the threshold as the merged mean
+	moved, so once the queue is empty every adjacency is measured again and
+	the queue drained again until no pair is closer than the threshold. The
+	label map is rewritten once at the end.	*/
+#pragma once
+
+#include <cstdint>
+#include <queue>
+#include <vector>
+#include "ColorMetric.h"
+#include "DisjointSet.h"
+#include "RegionGraph.h"
+#include "SegmentStats.h"
+#include "UnionFindSegmenter.h"
+
+class RegionMerger
+{
+	/*	Candidate struct
+
+		A pair of adjacent regions that may be merged. Regions are looked up
+		in the forest when the pair leaves the queue, and distance is what it
+		was when the pair was queued.	*/
+	struct Candidate
+	{
+		double distance;
+		int32_t a, b;
+
+		// orders std::priority_queue closest pair first
+		bool operator<(const Candidate& other) const
+		{
+			return distance > other.distance;
+		}
+	};
+
+	/*	measures the distance between the mean colors of two regions
+		@param	first region's root
+		@param	second region's root
+		@pre	a and b must be roots of the forest
+		@post	distance in the metric's units is returned	*/
+	double distance(int a, int b) const;
+
+	/*	is a region below the minimum size
+		@param	region's root
+		@pre	r must be a root of the forest
+		@post	true is returned if r has fewer pixels than the minimum	*/
+	bool small(int r) const;
+
+	/*	queues two regions if their mean colors are close enough
+		@param	first region's root
+		@param	second region's root
+		@pre	a and b must be roots of the forest
+		@post	the pair is queued if it differs and its distance is below
+				the merge threshold	*/
+	void offer(int a, int b);
+
+	/*	queues a small region with its closest neighbour
+		@param	region's root
+		@pre	r must be a root of the forest
+		@post	if r is below the minimum size and has a neighbour, the pair
+				of r and its closest neighbour is queued	*/
+	void offerClosest(int r);
+
+	/*	merges two regions
+		@param	first region's root
+		@param	second region's root
+		@pre	a and b must be different roots of the forest
+		@post	the regions are one with combined statistics and neighbours,
+				and the pairs the merged region is now in are queued	*/
+	void absorb(int a, int b);
+
+	/*	merges queued pairs until the queue is empty
+		@pre	none
+		@post	every queued pair that may still be merged when it leaves
+				the queue is merged	*/
+	void drain();
+
+	/*	queues every adjacent pair of regions that is close enough
+		@pre	none
+		@post	every pair of different adjacent regions whose distance is
+				below the merge threshold is queued, true is returned if
+				any was	*/
+	bool rescan();
+
+	DisjointSet forest;
+	const RegionGraph* graph;				// adjacency of the original regions
+	std::vector<SegmentStats> stats;		// at a root, statistics of the merged region
+	std::vector<long long> sizes;					// at a root, pixels of the merged region
+	std::vector<pixel> colors;				// at a root, mean color converted for the metric
+	std::vector<int32_t> nextMember;		// circular list of the original regions in a merged region
+	std::vector<int32_t> entries;			// at a root, adjacency entries of its original regions
+	std::vector<int32_t> offered;			// merge that last queued a region, to skip repeats
+	std::priority_queue<Candidate> queue;
+	Similarity similarity;
+	int minSize;
+	int threshold;
+	int merges;
+public:
+	/*	RegionMerger constructor
+		@param	metric mean colors are compared with, its threshold is unused
+		@param	regions with fewer pixels are merged into their closest
+				neighbour, 0 for no minimum
+		@param	neighbours whose mean colors are closer are merged, 0 to
+				merge by size only
+		@pre	none
+		@post	an instance of RegionMerger is created	*/
+	RegionMerger(const Similarity& similarity, int minSize, int threshold);
+
+	/*	merges the regions of a segmentation
+		@param	segmentation to merge, rewritten in place
+		@param	region adjacency graph of seg
+		@pre	graph must have been built from seg
+		@post	no region of seg is below the minimum size unless it has no
+				neighbour, no two adjacent regions are closer than the merge
+				threshold, labels are dense and numbered in the order their
+				first pixel appears in a raster scan	*/
+	void merge(Segmentation& seg, const RegionGraph& graph);
+
+	/*	returns the number of merges done by the last merge()
+		@pre	none
+		@post	number of regions merged away is returned	*/
+	int getMerges() const;
+};
@@ -0,0 +1,223 @@
+/*	RunSegmenter.cpp
+	Jayden Fullerton
+
+	This file contains a run-length version of the union-find segmentation.
+	Every row is cut into runs of neighbours that are similar to each other,
+	so a run is a (row, colStart, colEnd) span that is connected by itself.
+	Runs of neighbouring rows that overlap are united if any column of the
+	overlap holds a similar vertical pair, which joins exactly the pixels
+	union-find would join, and a region is the list of runs in one set.
+	Statistics are summed and segments are painted a run at a time, so
+	large flat areas cost a handful of runs per row instead of a union and
+	a label per pixel.	*/
+#include <algorithm>
+#include "ColorKernel.h"
+#include "Profile.h"
+#include "RunSegmenter.h"
+
+/*	tests whether any bit of a range is set
+	@param	mask to test, bit i of mask[i / 64] is column i
+	@param	first bit of the range
+	@param	one past the last bit of the range
+	@pre	first must be less than last
+	@post	true is returned if a bit from first to last - 1 is set	*/
+static bool anyBit(const uint64_t* mask, int first, int last)
+{
+	int word = first / 64;
+	int end = (last - 1) / 64;
+	uint64_t low = ~0ULL << (first % 64);
+	uint64_t high = ~0ULL >> (63 - (last - 1) % 64);
+	if (word == end)
+		return (mask[word] & low & high) != 0;
+	if ((mask[word] & low) != 0)
+		return true;
+	for (word++; word < end; word++)
+	{
+		if (mask[word] != 0)
+			return true;
+	}
+	return (mask[end] & high) != 0;
+}
+
+/*	RunSegmenter constructor
+	@param	metric and threshold two neighbours must be similar by
+	@pre	none
+	@post	an instance of RunSegmenter is created	*/
+RunSegmenter::RunSegmenter(const Similarity& similarity)
+{
+	this->similarity = similarity;
+}
+
+/*	labels the 4-connected components of an image as runs
+	@param	image to segment
+	@param	segmentation to write the result to
+	@pre	in must be a valid image object
+	@post	result holds the runs of in, the label of every run and the
+			statistics of every label; the labels are the same as those
+			of UnionFindSegmenter	*/
+void RunSegmenter::segment(const Image& in, RunSegmentation& result)
+{
+	PROFILE_SCOPE("run_segment");
+	result.rows = in.getRows();
+	result.cols = in.getCols();
+	result.runs.clear();
+	result.rowStart.assign(1, 0);
+	result.labels.clear();
+	result.stats.clear();
+	if (result.rows == 0 || result.cols == 0)
+		return;
+	PROFILE_COUNT(PixelsVisited, (long long)result.rows * result.cols);
+
+	Image converted(0, 0);
+	const Image& colors = comparisonImage(in, similarity, converted);
+	switch (similarity.metric)
+	{
+	case Metric::L2:
+		joinRuns(L2Policy(similarity), colors, result);
+		break;
+	case Metric::Chebyshev:
+		joinRuns(ChebyshevPolicy(similarity), colors, result);
+		break;
+	case Metric::Weighted:
+		joinRuns(WeightedPolicy(similarity), colors, result);
+		break;
+	case Metric::Lab:
+		joinRuns(LabPolicy(similarity), colors, result);
+		break;
+	default:
+		joinRuns(L1Policy(similarity), colors, result);
+		break;
+	}
+
+	// Number the roots in the raster order of the runs, which is that of
+	// their first pixels. As in union-find a root's slot holds its label
+	// once assigned and every other slot is only written by its own run.
+	PROFILE_SCOPE("run_label");
+	std::vector<Run>& runs = result.runs;
+	std::vector<int32_t>& labels = result.labels;
+	std::vector<SegmentStats>& stats = result.stats;
+	labels.assign(runs.size(), -1);
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		int root = forest.find((int)i);
+		int32_t label = labels[root];
+		if (label < 0)
+		{
+			label = (int32_t)stats.size();
+			labels[root] = label;
+			stats.push_back(SegmentStats());
+		}
+		labels[i] = label;
+		const Run& run = runs[i];
+		stats[label].addRun(in.getRow(run.row), run.row, run.colStart, run.colEnd);
+	}
+}
+
+/*	cuts every row into runs and unites overlapping runs
+	@param	metric policy
+	@param	image to measure distances on
+	@param	segmentation to write the runs to
+	@pre	none
+	@post	result holds the runs of every row and the forest one set
+			per connected group of runs	*/
+template <class Policy>
+void RunSegmenter::joinRuns(const Policy& policy, const Image& in, RunSegmentation& result)
+{
+	PROFILE_SCOPE("run_join");
+	int rows = in.getRows();
+	int cols = in.getCols();
+	std::vector<Run>& runs = result.runs;
+	across.resize(maskWords(cols));
+	down.resize(maskWords(cols));
+	forest.reset(0);
+	for (int row = 0; row < rows; row++)
+	{
+		const pixel* cur = in.getRow(row);
+		int first = (int)runs.size();
+
+		// bit col - 1 of across joins col to col - 1, a run ends at every
+		// clear bit
+		int start = 0;
+		if (cols > 1)
+		{
+			pairMask(policy, cur + 1, cur, cols - 1, across.data());
+			int words = maskWords(cols - 1);
+			for (int w = 0; w < words; w++)
+			{
+				uint64_t breaks = ~across[w];
+				if (w == words - 1 && (cols - 1) % 64 != 0)
+					breaks &= (1ULL << (cols - 1) % 64) - 1;
+				for (; breaks != 0; breaks &= breaks - 1)
+				{
+					int col = w * 64 + lowestBit(breaks) + 1;
+					runs.push_back({ row, start, col });
+					forest.add();
+					start = col;
+				}
+			}
+		}
+		runs.push_back({ row, start, cols });
+		forest.add();
+		result.rowStart.push_back((int32_t)runs.size());
+		if (row == 0)
+			continue;
+
+		// bit col of down joins col to the pixel above it. The runs of both
+		// rows are swept together, each overlapping pair is tested once
+		pairMask(policy, cur, in.getRow(row - 1), cols, down.data());
+		int above = result.rowStart[row - 1];
+		int below = first;
+		int last = (int)runs.size();
+		while (above < first && below < last)
+		{
+			const Run& a = runs[above];
+			const Run& b = runs[below];
+			if (anyBit(down.data(), std::max(a.colStart, b.colStart), std::min(a.colEnd, b.colEnd)))
+				forest.unite(above, below);
+			if (a.colEnd <= b.colEnd)
+				above++;
+			if (b.colEnd <= a.colEnd)
+				below++;
+		}
+	}
+}
+
+/*	writes the average color of every label to an image, a run at a time
+	@param	segmentation to draw
+	@param	image to draw into
+	@pre	out must have the same dimensions as seg
+	@post	every pixel of out is the average color of its label	*/
+void paintRuns(const RunSegmentation& seg, Image& out)
+{
+	PROFILE_SCOPE("paint");
+	std::vector<pixel> colors(seg.stats.size());
+	for (size_t i = 0; i < seg.stats.size(); i++)
+		colors[i] = seg.stats[i].average();
+
+	for (size_t i = 0; i < seg.runs.size(); i++)
+	{
+		const Run& run = seg.runs[i];
+		std::fill(out.getRow(run.row) + run.colStart, out.getRow(run.row) + run.colEnd, colors[seg.labels[i]]);
+	}
+}
+
+/*	expands runs into a label map
+	@param	segmentation to expand, its statistics are moved to result
+	@param	segmentation to write the label map to
+	@pre	none
+	@post	result holds the label of every pixel and the statistics of
+			every label	*/
+void expandRuns(RunSegmentation& runs, Segmentation& result)
+{
+	result.rows = runs.rows;
+	result.cols = runs.cols;
+	result.labels.resize((size_t)runs.rows * runs.cols);
+	for (size_t i = 0; i < runs.runs.size(); i++)
+	{
+		const Run& run = runs.runs[i];
+		int32_t* line = result.labels.data() + (size_t)run.row * runs.cols;
+		std::fill(line + run.colStart, line + run.colEnd, runs.labels[i]);
+	}
+	result.stats.swap(runs.stats);
+	runs.stats.clear();
+}
@@ -0,0 +1,92 @@
+/*	RunSegmenter.h
+	Jayden Fullerton
+
+	This file contains a run-length version of the union-find segmentation.
+	Every row is cut into runs of neighbours that are similar to each other,
+	so a run is a (row, colStart, colEnd) span that is connected by itself.
+	Runs of neighbouring rows that overlap are united if any column of the
+	overlap holds a similar vertical pair, which joins exactly the pixels
+	union-find would join, and a region is the list of runs in one set.
+	Statistics are summed and segments are painted a run at a time, so
+	large flat areas cost a handful of runs per row instead of a union and
+	a label per pixel.	*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ColorMetric.h"
+#include "DisjointSet.h"
+#include "Image.h"
+#include "SegmentStats.h"
+#include "UnionFindSegmenter.h"
+
+/*	Run struct
+
+	Pixels colStart to colEnd - 1 of one row.	*/
+struct Run
+{
+	int32_t row;
+	int32_t colStart, colEnd;
+};
+
+/*	RunSegmentation struct
+
+	Result of labeling an image as runs. runs holds every run in raster
+	order, rowStart[r] is the first run of row r and rowStart[rows] is one
+	past the last run. labels holds the label of every run, numbered like
+	the labels of Segmentation.	*/
+struct RunSegmentation
+{
+	int rows, cols;
+	std::vector<Run> runs;
+	std::vector<int32_t> rowStart;
+	std::vector<int32_t> labels;
+	std::vector<SegmentStats> stats;
+};
+
+class RunSegmenter
+{
+	/*	cuts every row into runs and unites overlapping runs
+		@param	metric policy
+		@param	image to measure distances on
+		@param	segmentation to write the runs to
+		@pre	none
+		@post	result holds the runs of every row and the forest one set
+				per connected group of runs	*/
+	template <class Policy>
+	void joinRuns(const Policy& policy, const Image& in, RunSegmentation& result);
+
+	DisjointSet forest;
+	std::vector<uint64_t> across, down;
+	Similarity similarity;
+public:
+	/*	RunSegmenter constructor
+		@param	metric and threshold two neighbours must be similar by
+		@pre	none
+		@post	an instance of RunSegmenter is created	*/
+	RunSegmenter(const Similarity& similarity = Similarity());
+
+	/*	labels the 4-connected components of an image as runs
+		@param	image to segment
+		@param	segmentation to write the result to
+		@pre	in must be a valid image object
+		@post	result holds the runs of in, the label of every run and the
+				statistics of every label; the labels are the same as those
+				of UnionFindSegmenter	*/
+	void segment(const Image& in, RunSegmentation& result);
+};
+
+/*	writes the average color of every label to an image, a run at a time
+	@param	segmentation to draw
+	@param	image to draw into
+	@pre	out must have the same dimensions as seg
+	@post	every pixel of out is the average color of its label	*/
+void paintRuns(const RunSegmentation& seg, Image& out);
+
+/*	expands runs into a label map
+	@param	segmentation to expand, its statistics are moved to result
+	@param	segmentation to write the label map to
+	@pre	none
+	@post	result holds the label of every pixel and the statistics of
+			every label	*/
+void expandRuns(RunSegmentation& runs, Segmentation& result);
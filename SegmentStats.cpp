@@ -0,0 +1,174 @@
+/*	SegmentStats.cpp
+	Jayden Fullerton
+
+	This file contains an accumulator for the statistics of one segment:
+	pixel count, running channel sums and sums of squares, coordinate sums
+	and a bounding box. A pixel is added in O(1) as a segment grows, or a
+	run of a row at once, so the average color, color variance, centroid
+	and extent of every segment can be read without storing or revisiting
+	its pixels. Two accumulators can be merged, which gives the statistics
+	of the union of their segments.	*/
+#include <climits>
+#include "ColorKernel.h"
+#include "SegmentStats.h"
+
+/*	SegmentStats constructor
+	@pre	none
+	@post	statistics of an empty segment are created	*/
+SegmentStats::SegmentStats()
+{
+	count = 0;
+	red = green = blue = 0;
+	redSq = greenSq = blueSq = 0;
+	rowSum = colSum = 0;
+	minRow = minCol = INT_MAX;
+	maxRow = maxCol = -1;
+}
+
+/*	adds a run of pixels of one row to the segment
+	@param	pixels of the row
+	@param	row of the run
+	@param	first column of the run
+	@param	one past the last column of the run
+	@pre	colStart must be less than colEnd
+	@post	the statistics include every pixel of the run	*/
+void SegmentStats::addRun(const pixel* line, int row, int colStart, int colEnd)
+{
+	long long width = colEnd - colStart;
+	long long sums[3] = { 0, 0, 0 }, squares[3] = { 0, 0, 0 };
+	channelSums(line + colStart, (int)width, sums, squares);
+	count += width;
+	red += sums[0];
+	green += sums[1];
+	blue += sums[2];
+	redSq += squares[0];
+	greenSq += squares[1];
+	blueSq += squares[2];
+
+	// the columns of a run sum in closed form
+	rowSum += row * width;
+	colSum += (colStart + colEnd - 1) * width / 2;
+	if (row < minRow)
+		minRow = row;
+	if (row > maxRow)
+		maxRow = row;
+	if (colStart < minCol)
+		minCol = colStart;
+	if (colEnd - 1 > maxCol)
+		maxCol = colEnd - 1;
+}
+
+/*	adds the pixels of another segment
+	@param	statistics of the other segment
+	@pre	none
+	@post	the statistics are those of the union of both segments	*/
+void SegmentStats::merge(const SegmentStats& s)
+{
+	count += s.count;
+	red += s.red;
+	green += s.green;
+	blue += s.blue;
+	redSq += s.redSq;
+	greenSq += s.greenSq;
+	blueSq += s.blueSq;
+	rowSum += s.rowSum;
+	colSum += s.colSum;
+	if (s.minRow < minRow)
+		minRow = s.minRow;
+	if (s.maxRow > maxRow)
+		maxRow = s.maxRow;
+	if (s.minCol < minCol)
+		minCol = s.minCol;
+	if (s.maxCol > maxCol)
+		maxCol = s.maxCol;
+}
+
+/*	returns the average color
+	@pre	count must be greater than 0
+	@post	the average color of the segment is returned	*/
+pixel SegmentStats::average() const
+{
+	pixel p;
+	p.red = (byte)(red / count);
+	p.green = (byte)(green / count);
+	p.blue = (byte)(blue / count);
+	return p;
+}
+
+/*	returns the color variance
+	@pre	count must be greater than 0
+	@post	the sum of the red, green and blue variances is returned	*/
+double SegmentStats::variance() const
+{
+	// E[x^2] - E[x]^2 for each channel
+	double n = count;
+	double r = red / n;
+	double g = green / n;
+	double b = blue / n;
+	return (redSq / n - r * r) + (greenSq / n - g * g) + (blueSq / n - b * b);
+}
+
+/*	returns the centroid row
+	@pre	count must be greater than 0
+	@post	the average row of the segment's pixels is returned	*/
+double SegmentStats::centroidRow() const
+{
+	return (double)rowSum / count;
+}
+
+/*	returns the centroid column
+	@pre	count must be greater than 0
+	@post	the average column of the segment's pixels is returned	*/
+double SegmentStats::centroidCol() const
+{
+	return (double)colSum / count;
+}
+
+/*	combines the statistics of every segment
+	@param	per-segment statistics
+	@pre	none
+	@post	statistics of all segments together are returned	*/
+SegmentStats totalStats(const std::vector<SegmentStats>& table)
+{
+	SegmentStats total;
+	for (size_t i = 0; i < table.size(); i++)
+		total.merge(table[i]);
+	return total;
+}
+
+/*	writes the header line of a per-segment CSV table
+	@param	stream to write to
+	@pre	out must be a valid stream
+	@post	the column names are written	*/
+void writeSegmentHeader(std::ostream& out)
+{
+	out << "label,pixels,red,green,blue,variance,centroidRow,centroidCol,"
+		<< "minRow,minCol,maxRow,maxCol\n";
+}
+
+/*	writes one line of a per-segment CSV table
+	@param	stream to write to
+	@param	label of the segment
+	@param	statistics of the segment
+	@pre	out must be a valid stream, s must hold at least one pixel
+	@post	the segment's line is written	*/
+void writeSegmentRow(std::ostream& out, long long label, const SegmentStats& s)
+{
+	pixel p = s.average();
+	out << label << ',' << s.count << ',' << (int)p.red << ',' << (int)p.green << ','
+		<< (int)p.blue << ',' << s.variance() << ',' << s.centroidRow() << ','
+		<< s.centroidCol() << ',' << s.minRow << ',' << s.minCol << ','
+		<< s.maxRow << ',' << s.maxCol << '\n';
+}
+
+/*	writes a per-segment table as CSV
+	@param	stream to write to
+	@param	per-segment statistics, indexed by segment label
+	@pre	out must be a valid stream
+	@post	a header line and one line per segment are written	*/
+void writeSegmentTable(std::ostream& out, const std::vector<SegmentStats>& table)
+{
+	writeSegmentHeader(out);
+	for (size_t i = 0; i < table.size(); i++)
+		writeSegmentRow(out, (long long)i, table[i]);
+}
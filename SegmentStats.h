@@ -0,0 +1,123 @@
+/*	SegmentStats.h
+	Jayden Fullerton
+
+	This file contains an accumulator for the statistics of one segment:
+	pixel count, running channel sums and sums of squares, coordinate sums
+	and a bounding box. A pixel is added in O(1) as a segment grows, or a
+	run of a row at once, so the average color, color variance, centroid
+	and extent of every segment can be read without storing or revisiting
+	its pixels. Two accumulators can be merged, which gives the statistics
+	of the union of their segments.	*/
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include "ImageLib.h"
+
+struct SegmentStats
+{
+	long long count;
+	long long red, green, blue;
+	long long redSq, greenSq, blueSq;
+	long long rowSum, colSum;
+	int minRow, maxRow, minCol, maxCol;
+
+	/*	SegmentStats constructor
+		@pre	none
+		@post	statistics of an empty segment are created	*/
+	SegmentStats();
+
+	/*	adds a pixel to the segment
+		@param	color of the pixel
+		@param	row of the pixel
+		@param	column of the pixel
+		@pre	none
+		@post	the statistics include the pixel	*/
+	void add(const pixel& p, int row, int col);
+
+	/*	adds a run of pixels of one row to the segment
+		@param	pixels of the row
+		@param	row of the run
+		@param	first column of the run
+		@param	one past the last column of the run
+		@pre	colStart must be less than colEnd
+		@post	the statistics include every pixel of the run	*/
+	void addRun(const pixel* line, int row, int colStart, int colEnd);
+
+	/*	adds the pixels of another segment
+		@param	statistics of the other segment
+		@pre	none
+		@post	the statistics are those of the union of both segments	*/
+	void merge(const SegmentStats& s);
+
+	/*	returns the average color
+		@pre	count must be greater than 0
+		@post	the average color of the segment is returned	*/
+	pixel average() const;
+
+	/*	returns the color variance
+		@pre	count must be greater than 0
+		@post	the sum of the red, green and blue variances is returned	*/
+	double variance() const;
+
+	/*	returns the centroid row
+		@pre	count must be greater than 0
+		@post	the average row of the segment's pixels is returned	*/
+	double centroidRow() const;
+
+	/*	returns the centroid column
+		@pre	count must be greater than 0
+		@post	the average column of the segment's pixels is returned	*/
+	double centroidCol() const;
+};
+
+/*	combines the statistics of every segment
+	@param	per-segment statistics
+	@pre	none
+	@post	statistics of all segments together are returned	*/
+SegmentStats totalStats(const std::vector<SegmentStats>& table);
+
+/*	writes the header line of a per-segment CSV table
+	@param	stream to write to
+	@pre	out must be a valid stream
+	@post	the column names are written	*/
+void writeSegmentHeader(std::ostream& out);
+
+/*	writes one line of a per-segment CSV table
+	@param	stream to write to
+	@param	label of the segment
+	@param	statistics of the segment
+	@pre	out must be a valid stream, s must hold at least one pixel
+	@post	the segment's line is written	*/
+void writeSegmentRow(std::ostream& out, long long label, const SegmentStats& s);
+
+/*	writes a per-segment table as CSV
+	@param	stream to write to
+	@param	per-segment statistics, indexed by segment label
+	@pre	out must be a valid stream
+	@post	a header line and one line per segment are written	*/
+void writeSegmentTable(std::ostream& out, const std::vector<SegmentStats>& table);
+
+// add() is called once per pixel while segmenting, so it is defined here
+// to be inlined
+
+inline void SegmentStats::add(const pixel& p, int row, int col)
+{
+	count++;
+	red += p.red;
+	green += p.green;
+	blue += p.blue;
+	redSq += p.red * p.red;
+	greenSq += p.green * p.green;
+	blueSq += p.blue * p.blue;
+	rowSum += row;
+	colSum += col;
+	if (row < minRow)
+		minRow = row;
+	if (row > maxRow)
+		maxRow = row;
+	if (col < minCol)
+		minCol = col;
+	if (col > maxCol)
+		maxCol = col;
+}
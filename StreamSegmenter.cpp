@@ -0,0 +1,460 @@
+/*	StreamSegmenter.cpp
+	Jayden Fullerton
+
+	This file contains a streaming segmentation mode for images larger than
+	memory. Rows are fed in bands and labeled as they arrive with the same
+	neighbour test as the union-find mode, but only the previous row's labels
+	and the records of segments that can still change (or that a queued
+	output row refers to) are kept. A segment is closed as soon as a row
+	passes without touching it, and an output row is written as soon as
+	every segment on it is closed. Output rows that are still waiting are
+	queued as labels, and the queue spills to a temporary file past a fixed
+	number of rows, so memory stays O(width x band height + open segments).	*/
+#include "StreamSegmenter.h"
+
+/*	moves a file to a byte offset
+	@param	file to seek
+	@param	offset from the start of the file
+	@pre	none
+	@post	true is returned if the file is at offset	*/
+static bool seekTo(FILE* file, long long offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+/*	LabelQueue constructor
+	@param	labels in a row
+	@param	rows kept in memory before rows spill to a temporary file
+	@pre	cols and maxRows must be positive
+	@post	an empty queue is created	*/
+LabelQueue::LabelQueue(int cols, int maxRows)
+{
+	this->cols = cols;
+	this->maxRows = (size_t)maxRows;
+	spill = nullptr;
+	readRow = 0;
+	writeRow = 0;
+}
+
+/*	LabelQueue destructor
+	@pre	none
+	@post	the temporary file is closed and removed	*/
+LabelQueue::~LabelQueue()
+{
+	if (spill != nullptr)
+		fclose(spill);
+}
+
+/*	adds a row to the back of the queue
+	@param	cols labels
+	@pre	none
+	@post	the row is queued, in memory if there is room and nothing is
+			spilled, otherwise in the temporary file	*/
+void LabelQueue::push(const int32_t* labels)
+{
+	// once a row is spilled every later row is too, so the file stays in order
+	if (readRow < writeRow || rows.size() >= maxRows)
+	{
+		if (spill == nullptr)
+			spill = tmpfile();
+		if (spill != nullptr && seekTo(spill, writeRow * cols * (long long)sizeof(int32_t))
+			&& fwrite(labels, sizeof(int32_t), cols, spill) == (size_t)cols)
+		{
+			writeRow++;
+			return;
+		}
+		// without a usable temporary file rows stay in memory
+		if (readRow < writeRow)
+		{
+			while (readRow < writeRow)
+				load();
+		}
+	}
+	rows.emplace_back(labels, labels + cols);
+}
+
+/*	moves the oldest spilled row into memory
+	@pre	a row is spilled
+	@post	the row is at the back of rows	*/
+void LabelQueue::load()
+{
+	rows.emplace_back(cols);
+	if (!seekTo(spill, readRow * cols * (long long)sizeof(int32_t))
+		|| fread(rows.back().data(), sizeof(int32_t), cols, spill) != (size_t)cols)
+		rows.back().assign(cols, 0);
+	readRow++;
+	if (readRow == writeRow) // the file is empty again, reuse it from the start
+		readRow = writeRow = 0;
+}
+
+/*	returns the oldest row
+	@pre	the queue must not be empty
+	@post	the labels of the oldest row are returned	*/
+const std::vector<int32_t>& LabelQueue::front()
+{
+	if (rows.empty())
+		load();
+	return rows.front();
+}
+
+/*	removes the oldest row
+	@pre	the queue must not be empty
+	@post	the oldest row is removed	*/
+void LabelQueue::pop()
+{
+	if (rows.empty())
+		load();
+	rows.pop_front();
+}
+
+/*	returns the number of queued rows
+	@pre	none
+	@post	number of rows in memory and spilled is returned	*/
+long long LabelQueue::size() const
+{
+	return (long long)rows.size() + writeRow - readRow;
+}
+
+/*	StreamSegmenter constructor
+	@param	width of the image
+	@param	metric and threshold two neighbours must be similar by
+	@param	receives every output row, in order
+	@param	receives the statistics of every segment as it closes, may
+			be empty
+	@param	output rows kept in memory while they wait for their
+			segments to close, later ones spill to a temporary file
+	@pre	cols must be positive
+	@post	an instance of StreamSegmenter is created at row 0	*/
+StreamSegmenter::StreamSegmenter(int cols, const Similarity& similarity, const RowSink& rowSink,
+	const SegmentSink& segmentSink, int bufferedRows) : pending(cols, bufferedRows), converted(0, 0)
+{
+	this->cols = cols;
+	this->similarity = similarity;
+	this->rowSink = rowSink;
+	this->segmentSink = segmentSink;
+	above.resize(cols);
+	current.resize(cols);
+	aboveCompared.resize(cols);
+	across.resize(maskWords(cols));
+	down.resize(maskWords(cols));
+	output.resize(cols);
+	row = 0;
+	blocking = -1;
+	segments = 0;
+	largest = 0;
+	openRecords = 0;
+	peakRecords = 0;
+	peakPending = 0;
+}
+
+/*	labels the next rows of the image
+	@param	band holding the rows
+	@param	number of rows of band to label, from its first row
+	@pre	band must be cols wide and hold at least count rows
+	@post	the rows are labeled, segments they end are closed and every
+			row that is finished is written to the row sink	*/
+void StreamSegmenter::addRows(const Image& band, int count)
+{
+	const Image& compared = comparisonImage(band, similarity, converted);
+	switch (similarity.metric)
+	{
+	case Metric::L2:
+		addRowsWith(L2Policy(similarity), band, compared, count);
+		break;
+	case Metric::Chebyshev:
+		addRowsWith(ChebyshevPolicy(similarity), band, compared, count);
+		break;
+	case Metric::Weighted:
+		addRowsWith(WeightedPolicy(similarity), band, compared, count);
+		break;
+	case Metric::Lab:
+		addRowsWith(LabPolicy(similarity), band, compared, count);
+		break;
+	default:
+		addRowsWith(L1Policy(similarity), band, compared, count);
+		break;
+	}
+}
+
+/*	labels rows with a metric
+	@param	metric policy
+	@param	rows to label
+	@param	rows converted for the metric
+	@param	number of rows of band to label
+	@pre	see addRows()
+	@post	see addRows()	*/
+template <class Policy>
+void StreamSegmenter::addRowsWith(const Policy& policy, const Image& band, const Image& compared, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const pixel* cur = compared.getRow(i);
+
+		// bit col - 1 of across joins col to col - 1, bit col of down joins
+		// col to the pixel above it
+		if (cols > 1)
+			pairMask(policy, cur + 1, cur, cols - 1, across.data());
+		if (row > 0)
+			pairMask(policy, cur, aboveCompared.data(), cols, down.data());
+		labelRow(band.getRow(i), cur);
+	}
+}
+
+/*	labels one row
+	@param	original colors of the row
+	@param	colors of the row converted for the metric
+	@pre	across and down hold the neighbour masks of the row
+	@post	the row is labeled, queued and joined to the row above	*/
+void StreamSegmenter::labelRow(const pixel* colors, const pixel* compared)
+{
+	int col = 0;
+	while (col < cols)
+	{
+		// a run of pixels joined to their left neighbour shares a record,
+		// its statistics are gathered locally and added to the root once
+		int record = newRecord();
+		SegmentStats run;
+		do
+		{
+			current[col] = record;
+			run.add(colors[col], row, col);
+			if (row > 0 && (down[col >> 6] >> (col & 63) & 1))
+				unite(record, above[col]);
+			col++;
+		} while (col < cols && (across[(col - 1) >> 6] >> ((col - 1) & 63) & 1));
+
+		Record& root = records[find(record)];
+		root.stats.merge(run);
+		root.lastRow = row;
+	}
+	pending.push(current.data());
+	if (pending.size() > peakPending)
+		peakPending = pending.size();
+
+	// a segment of the row above that this row did not reach is finished
+	for (int c = 0; c < cols && row > 0; c++)
+	{
+		if (c > 0 && above[c] == above[c - 1])
+			continue;
+		int root = find(above[c]);
+		if (!records[root].closed && records[root].lastRow < row)
+			close(root);
+	}
+
+	above.swap(current);
+	for (int c = 0; c < cols; c++)
+		aboveCompared[c] = compared[c];
+	row++;
+
+	// the row just labeled touches open segments, so it always waits
+	emitRows(1);
+}
+
+/*	ends the image
+	@pre	none
+	@post	every segment is closed and every remaining row is written
+			to the row sink	*/
+void StreamSegmenter::finish()
+{
+	for (int c = 0; c < cols && row > 0; c++)
+	{
+		int root = find(above[c]);
+		if (!records[root].closed)
+			close(root);
+	}
+	emitRows(0);
+}
+
+/*	creates a record for a new run
+	@pre	none
+	@post	index of an unused record that is the root of its own tree
+			is returned, held once by the row being labeled	*/
+int StreamSegmenter::newRecord()
+{
+	int index;
+	if (freeRecords.empty())
+	{
+		index = (int)records.size();
+		records.push_back(Record());
+	}
+	else
+	{
+		index = freeRecords.back();
+		freeRecords.pop_back();
+		records[index].stats = SegmentStats();
+	}
+	Record& r = records[index];
+	r.parent = index;
+	r.refs = 1;
+	r.rank = 0;
+	r.lastRow = row;
+	r.closed = false;
+	openRecords++;
+	if (openRecords > peakRecords)
+		peakRecords = openRecords;
+	return index;
+}
+
+/*	finds the root of a record's tree
+	@param	record index
+	@pre	record must be in use
+	@post	index of the root is returned	*/
+int StreamSegmenter::find(int record) const
+{
+	// union by rank keeps trees shallow, so there is no path compression
+	// to keep the holds of the records on the path up to date
+	while (records[record].parent != record)
+		record = records[record].parent;
+	return record;
+}
+
+/*	joins the segments of two records
+	@param	first record
+	@param	second record
+	@pre	both records must be in use
+	@post	both records have the same root, which holds the statistics
+			of both segments	*/
+void StreamSegmenter::unite(int a, int b)
+{
+	a = find(a);
+	b = find(b);
+	if (a == b)
+		return;
+	if (records[a].rank < records[b].rank)
+	{
+		int temp = a;
+		a = b;
+		b = temp;
+	}
+	Record& root = records[a];
+	Record& child = records[b];
+	child.parent = a;
+	root.refs++;
+	root.stats.merge(child.stats);
+	if (child.lastRow > root.lastRow)
+		root.lastRow = child.lastRow;
+	if (root.rank == child.rank)
+		root.rank++;
+}
+
+/*	drops one hold on a record
+	@param	record index
+	@pre	record must be held
+	@post	the record, and any parents that are no longer held, are
+			freed if their segment is closed	*/
+void StreamSegmenter::release(int record)
+{
+	while (--records[record].refs == 0)
+	{
+		// nothing holds the record, so no queued row or record below it can
+		// reach its segment, which is therefore closed
+		int parent = records[record].parent;
+		freeRecords.push_back(record);
+		openRecords--;
+		if (record == blocking)
+			blocking = -1;
+		if (parent == record)
+			return;
+		record = parent;
+	}
+}
+
+/*	closes a segment
+	@param	root of the segment
+	@pre	root must be an open root
+	@post	the segment's color is fixed and it is reported	*/
+void StreamSegmenter::close(int root)
+{
+	Record& r = records[root];
+	r.closed = true;
+	r.color = r.stats.average();
+	segments++;
+	total.merge(r.stats);
+	if (r.stats.count > largest)
+		largest = r.stats.count;
+	if (segmentSink)
+		segmentSink(r.stats);
+}
+
+/*	writes every finished row at the front of the queue
+	@param	number of rows at the back of the queue that cannot be
+			finished yet
+	@pre	none
+	@post	rows whose segments are all closed are written to the sink
+			in order until one that is not is found	*/
+void StreamSegmenter::emitRows(long long keep)
+{
+	while (pending.size() > keep)
+	{
+		// the segment that held the row back last time is usually still open
+		if (blocking >= 0 && !records[find(blocking)].closed)
+			return;
+		blocking = -1;
+
+		const std::vector<int32_t>& labels = pending.front();
+		for (int col = 0; col < cols; )
+		{
+			int32_t label = labels[col];
+			const Record& root = records[find(label)];
+			if (!root.closed)
+			{
+				blocking = find(label);
+				return;
+			}
+			for (; col < cols && labels[col] == label; col++)
+				output[col] = root.color;
+		}
+		rowSink(output.data());
+
+		for (int col = 0; col < cols; col++)
+		{
+			if (col == 0 || labels[col] != labels[col - 1])
+				release(labels[col]);
+		}
+		pending.pop();
+	}
+}
+
+/*	returns the number of segments closed
+	@pre	none
+	@post	number of segments is returned	*/
+int StreamSegmenter::getSegments() const
+{
+	return segments;
+}
+
+/*	returns the statistics of every closed segment together
+	@pre	none
+	@post	combined statistics are returned	*/
+const SegmentStats& StreamSegmenter::getTotal() const
+{
+	return total;
+}
+
+/*	returns the size of the largest closed segment
+	@pre	none
+	@post	pixel count of the largest segment is returned	*/
+long long StreamSegmenter::getLargest() const
+{
+	return largest;
+}
+
+/*	returns the most records that were in use at once
+	@pre	none
+	@post	peak number of records is returned	*/
+int StreamSegmenter::getPeakRecords() const
+{
+	return peakRecords;
+}
+
+/*	returns the most output rows that waited at once
+	@pre	none
+	@post	peak length of the queue is returned	*/
+long long StreamSegmenter::getPeakPending() const
+{
+	return peakPending;
+}
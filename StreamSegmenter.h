@@ -0,0 +1,233 @@
+/*	StreamSegmenter.h
+	Jayden Fullerton
+
+	This file contains a streaming segmentation mode for images larger than
+	memory. Rows are fed in bands and labeled as they arrive with the same
+	neighbour test as the union-find mode, but only the previous row's labels
+	and the records of segments that can still change (or that a queued
+	output row refers to) are kept. A segment is closed as soon as a row
+	passes without touching it, and an output row is written as soon as
+	every segment on it is closed. Output rows that are still waiting are
+	queued as labels, and the queue spills to a temporary file past a fixed
+	number of rows, so memory stays O(width x band height + open segments).	*/
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "ColorMetric.h"
+#include "Image.h"
+#include "SegmentStats.h"
+
+// Receives the next finished output row, cols pixels
+typedef std::function<void(const pixel* colors)> RowSink;
+
+// Receives the statistics of a segment as it closes
+typedef std::function<void(const SegmentStats& stats)> SegmentSink;
+
+class LabelQueue
+{
+	/*	moves the oldest spilled row into memory
+		@pre	a row is spilled
+		@post	the row is at the back of rows	*/
+	void load();
+
+	std::deque<std::vector<int32_t>> rows;	// the oldest rows
+	FILE* spill;							// rows queued after rows filled up
+	long long readRow, writeRow;			// spilled rows are readRow..writeRow-1
+	int cols;
+	size_t maxRows;
+public:
+	/*	LabelQueue constructor
+		@param	labels in a row
+		@param	rows kept in memory before rows spill to a temporary file
+		@pre	cols and maxRows must be positive
+		@post	an empty queue is created	*/
+	LabelQueue(int cols, int maxRows);
+
+	/*	LabelQueue destructor
+		@pre	none
+		@post	the temporary file is closed and removed	*/
+	~LabelQueue();
+
+	LabelQueue(const LabelQueue&) = delete;
+	LabelQueue& operator=(const LabelQueue&) = delete;
+
+	/*	adds a row to the back of the queue
+		@param	cols labels
+		@pre	none
+		@post	the row is queued, in memory if there is room and nothing is
+				spilled, otherwise in the temporary file	*/
+	void push(const int32_t* labels);
+
+	/*	returns the oldest row
+		@pre	the queue must not be empty
+		@post	the labels of the oldest row are returned	*/
+	const std::vector<int32_t>& front();
+
+	/*	removes the oldest row
+		@pre	the queue must not be empty
+		@post	the oldest row is removed	*/
+	void pop();
+
+	/*	returns the number of queued rows
+		@pre	none
+		@post	number of rows in memory and spilled is returned	*/
+	long long size() const;
+};
+
+class StreamSegmenter
+{
+	/*	Record struct
+
+		A run of similar pixels on one row, and the segment it belongs to.
+		Records are linked into a union-find forest, the root of a tree holds
+		the segment's statistics. A record is held by the queued row its run
+		is on and by every record linked under it, and is reused once nothing
+		holds it and its segment is closed.	*/
+	struct Record
+	{
+		SegmentStats stats;	// at a root, statistics of the segment
+		pixel color;		// at a closed root, the segment's average color
+		int parent;
+		int refs;
+		int rank;
+		int lastRow;		// at a root, the last row the segment touches
+		bool closed;		// at a root, no later row can join the segment
+	};
+
+	/*	labels rows with a metric
+		@param	metric policy
+		@param	rows to label
+		@param	rows converted for the metric
+		@param	number of rows of band to label
+		@pre	see addRows()
+		@post	see addRows()	*/
+	template <class Policy>
+	void addRowsWith(const Policy& policy, const Image& band, const Image& compared, int count);
+
+	/*	labels one row
+		@param	original colors of the row
+		@param	colors of the row converted for the metric
+		@pre	across and down hold the neighbour masks of the row
+		@post	the row is labeled, queued and joined to the row above	*/
+	void labelRow(const pixel* colors, const pixel* compared);
+
+	/*	creates a record for a new run
+		@pre	none
+		@post	index of an unused record that is the root of its own tree
+				is returned, held once by the row being labeled	*/
+	int newRecord();
+
+	/*	finds the root of a record's tree
+		@param	record index
+		@pre	record must be in use
+		@post	index of the root is returned	*/
+	int find(int record) const;
+
+	/*	joins the segments of two records
+		@param	first record
+		@param	second record
+		@pre	both records must be in use
+		@post	both records have the same root, which holds the statistics
+				of both segments	*/
+	void unite(int a, int b);
+
+	/*	drops one hold on a record
+		@param	record index
+		@pre	record must be held
+		@post	the record, and any parents that are no longer held, are
+				freed if their segment is closed	*/
+	void release(int record);
+
+	/*	closes a segment
+		@param	root of the segment
+		@pre	root must be an open root
+		@post	the segment's color is fixed and it is reported	*/
+	void close(int root);
+
+	/*	writes every finished row at the front of the queue
+		@param	number of rows at the back of the queue that cannot be
+				finished yet
+		@pre	none
+		@post	rows whose segments are all closed are written to the sink
+				in order until one that is not is found	*/
+	void emitRows(long long keep);
+
+	std::vector<Record> records;
+	std::vector<int> freeRecords;
+	std::vector<int32_t> above, current;	// labels of the previous and current row
+	std::vector<pixel> aboveCompared;		// converted colors of the previous row
+	std::vector<uint64_t> across, down;
+	std::vector<pixel> output;
+	LabelQueue pending;
+	Similarity similarity;
+	Image converted;
+	RowSink rowSink;
+	SegmentSink segmentSink;
+	int cols;
+	int row;			// rows labeled so far
+	int blocking;		// record known to hold back the oldest queued row, -1 if none
+	int segments;
+	long long largest;
+	int openRecords, peakRecords;
+	long long peakPending;
+	SegmentStats total;
+public:
+	/*	StreamSegmenter constructor
+		@param	width of the image
+		@param	metric and threshold two neighbours must be similar by
+		@param	receives every output row, in order
+		@param	receives the statistics of every segment as it closes, may
+				be empty
+		@param	output rows kept in memory while they wait for their
+				segments to close, later ones spill to a temporary file
+		@pre	cols must be positive
+		@post	an instance of StreamSegmenter is created at row 0	*/
+	StreamSegmenter(int cols, const Similarity& similarity, const RowSink& rowSink,
+		const SegmentSink& segmentSink = SegmentSink(), int bufferedRows = 1024);
+
+	StreamSegmenter(const StreamSegmenter&) = delete;
+	StreamSegmenter& operator=(const StreamSegmenter&) = delete;
+
+	/*	labels the next rows of the image
+		@param	band holding the rows
+		@param	number of rows of band to label, from its first row
+		@pre	band must be cols wide and hold at least count rows
+		@post	the rows are labeled, segments they end are closed and every
+				row that is finished is written to the row sink	*/
+	void addRows(const Image& band, int count);
+
+	/*	ends the image
+		@pre	none
+		@post	every segment is closed and every remaining row is written
+				to the row sink	*/
+	void finish();
+
+	/*	returns the number of segments closed
+		@pre	none
+		@post	number of segments is returned	*/
+	int getSegments() const;
+
+	/*	returns the statistics of every closed segment together
+		@pre	none
+		@post	combined statistics are returned	*/
+	const SegmentStats& getTotal() const;
+
+	/*	returns the size of the largest closed segment
+		@pre	none
+		@post	pixel count of the largest segment is returned	*/
+	long long getLargest() const;
+
+	/*	returns the most records that were in use at once
+		@pre	none
+		@post	peak number of records is returned	*/
+	int getPeakRecords() const;
+
+	/*	returns the most output rows that waited at once
+		@pre	none
+		@post	peak length of the queue is returned	*/
+	long long getPeakPending() const;
+};
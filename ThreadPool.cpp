@@ -0,0 +1,155 @@
+/*	ThreadPool.cpp
+	Jayden Fullerton
+
+	This file contains a fixed-size pool of worker threads. Tasks are queued
+	with submit() and run on the first free worker; wait() blocks until every
+	queued task has finished so a caller can use the pool for one phase of
+	work at a time. forEachBand() splits the rows of an image into bands
+	that workers take in turn, for work that is the same for every row.	*/
+#include <algorithm>
+#include <atomic>
+#include "ThreadPool.h"
+
+/*	ThreadPool constructor
+	@param	number of worker threads, 0 uses one per hardware thread
+	@pre	threads must be non-negative
+	@post	the worker threads are started	*/
+ThreadPool::ThreadPool(int threads)
+{
+	running = 0;
+	stopping = false;
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+	for (int i = 0; i < threads; i++)
+		workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+/*	ThreadPool destructor
+	@pre	none
+	@post	queued tasks are finished and the worker threads are joined	*/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		stopping = true;
+	}
+	taskReady.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+/*	worker loop
+	@pre	none
+	@post	tasks are run until the pool is destroyed	*/
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			taskReady.wait(guard, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return; // stopping and nothing left to do
+			task = std::move(tasks.front());
+			tasks.pop();
+			running++;
+		}
+
+		task();
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			running--;
+			if (running == 0 && tasks.empty())
+				allDone.notify_all();
+		}
+	}
+}
+
+/*	queues a task
+	@param	task to run
+	@pre	none
+	@post	task will be run on a worker thread	*/
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		tasks.push(std::move(task));
+	}
+	taskReady.notify_one();
+}
+
+/*	waits for every queued task
+	@pre	none
+	@post	every task submitted so far has finished	*/
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	allDone.wait(guard, [this] { return running == 0 && tasks.empty(); });
+}
+
+/*	returns the number of worker threads
+	@pre	none
+	@post	number of worker threads is returned	*/
+int ThreadPool::getSize() const
+{
+	return (int)workers.size();
+}
+
+/*	returns the number of threads a pool would start
+	@param	threads asked for, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	number of threads is returned, at least 1	*/
+int resolveThreads(int threads)
+{
+	if (threads == 0)
+		threads = (int)std::thread::hardware_concurrency();
+	return std::max(threads, 1);
+}
+
+/*	runs a task on a band of rows at a time until every band is taken
+	@param	rows to cover
+	@param	rows in each band
+	@param	threads to run on, 0 for every hardware thread
+	@param	task, called with a worker index below resolveThreads(threads)
+			and the first and one past the last row of a band, returns
+			false to stop every worker
+	@pre	bandRows must be positive, threads must be non-negative
+	@post	task has been run on every band, or until it returned false; the
+			number of workers used is returned	*/
+int forEachBand(int rows, int bandRows, int threads, const std::function<bool(int, int, int)>& task)
+{
+	int bands = (rows + bandRows - 1) / bandRows;
+	int workers = std::min(resolveThreads(threads), bands);
+	if (workers <= 1)
+	{
+		for (int band = 0; band < bands; band++)
+		{
+			if (!task(0, band * bandRows, std::min(rows, (band + 1) * bandRows)))
+				break;
+		}
+		return 1;
+	}
+
+	// workers take the next band from a shared counter, so a band that is
+	// slower to do does not hold up the others
+	ThreadPool pool(workers);
+	std::atomic<int> next(0);
+	std::atomic<bool> stopped(false);
+	for (int worker = 0; worker < workers; worker++)
+	{
+		pool.submit([&, worker]()
+		{
+			for (int band = next++; band < bands && !stopped.load(std::memory_order_relaxed); band = next++)
+			{
+				if (!task(worker, band * bandRows, std::min(rows, (band + 1) * bandRows)))
+					stopped = true;
+			}
+		});
+	}
+	pool.wait();
+	return workers;
+}
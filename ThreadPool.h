@@ -0,0 +1,80 @@
+/*	ThreadPool.h
+	Jayden Fullerton
+
+	This file contains a fixed-size pool of worker threads. Tasks are queued
+	with submit() and run on the first free worker; wait() blocks until every
+	queued task has finished so a caller can use the pool for one phase of
+	work at a time. forEachBand() splits the rows of an image into bands
+	that workers take in turn, for work that is the same for every row.	*/
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+	/*	worker loop
+		@pre	none
+		@post	tasks are run until the pool is destroyed	*/
+	void work();
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex lock;
+	std::condition_variable taskReady;
+	std::condition_variable allDone;
+	int running;
+	bool stopping;
+public:
+	/*	ThreadPool constructor
+		@param	number of worker threads, 0 uses one per hardware thread
+		@pre	threads must be non-negative
+		@post	the worker threads are started	*/
+	ThreadPool(int threads = 0);
+
+	/*	ThreadPool destructor
+		@pre	none
+		@post	queued tasks are finished and the worker threads are joined	*/
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/*	queues a task
+		@param	task to run
+		@pre	none
+		@post	task will be run on a worker thread	*/
+	void submit(std::function<void()> task);
+
+	/*	waits for every queued task
+		@pre	none
+		@post	every task submitted so far has finished	*/
+	void wait();
+
+	/*	returns the number of worker threads
+		@pre	none
+		@post	number of worker threads is returned	*/
+	int getSize() const;
+};
+
+/*	returns the number of threads a pool would start
+	@param	threads asked for, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	number of threads is returned, at least 1	*/
+int resolveThreads(int threads);
+
+/*	runs a task on a band of rows at a time until every band is taken
+	@param	rows to cover
+	@param	rows in each band
+	@param	threads to run on, 0 for every hardware thread
+	@param	task, called with a worker index below resolveThreads(threads)
+			and the first and one past the last row of a band, returns
+			false to stop every worker
+	@pre	bandRows must be positive, threads must be non-negative
+	@post	task has been run on every band, or until it returned false; the
+			number of workers used is returned	*/
+int forEachBand(int rows, int bandRows, int threads, const std::function<bool(int, int, int)>& task);
@@ -0,0 +1,150 @@
+/*	TiledSegmenter.cpp
+	Jayden Fullerton
+
+	This file contains a multithreaded version of the union-find segmentation
+	mode. The image is split into horizontal strips which are labeled in
+	parallel on a thread pool, then a merge pass unites labels that touch
+	across the seams between strips and renumbers them so that the result is
+	exactly the same as labeling the whole image on one thread.	*/
+#include <chrono>
+#include "Profile.h"
+#include "TiledSegmenter.h"
+
+/*	milliseconds elapsed since a point in time
+	@pre	none
+	@post	milliseconds since start are returned	*/
+static double millisSince(std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/*	TiledSegmenter constructor
+	@param	number of worker threads, 0 uses one per hardware thread
+	@param	metric and threshold two neighbours must be similar by
+	@pre	threads must be non-negative
+	@post	an instance of TiledSegmenter is created and its threads started	*/
+TiledSegmenter::TiledSegmenter(int threads, const Similarity& similarity) : pool(threads)
+{
+	this->similarity = similarity;
+	times.label = times.seams = times.relabel = 0;
+}
+
+/*	labels the 4-connected components of an image in parallel
+	@param	image to segment
+	@param	segmentation to write the result to
+	@pre	in must be a valid image object
+	@post	result is identical to UnionFindSegmenter::segment() with the
+			same similarity	*/
+void TiledSegmenter::segment(const Image& in, Segmentation& result)
+{
+	int rows = in.getRows();
+	int cols = in.getCols();
+	result.rows = rows;
+	result.cols = cols;
+	result.labels.resize(rows * cols);
+	result.stats.clear();
+	if (rows == 0 || cols == 0)
+		return;
+
+	// a couple of strips per thread evens out strips that label slower
+	int strips = pool.getSize() * 2;
+	if (strips > rows)
+		strips = rows;
+	std::vector<int> firstRow(strips + 1);
+	for (int k = 0; k <= strips; k++)
+		firstRow[k] = (int)((long long)rows * k / strips);
+	std::vector<std::vector<SegmentStats>> stripStats(strips);
+	int32_t* labels = result.labels.data();
+
+	// every strip and seam measures distances on the same converted image
+	Image converted(0, 0);
+	const Image& colors = comparisonImage(in, similarity, converted);
+
+	// Phase 1: label every strip on its own, strip labels start at 0
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int k = 0; k < strips; k++)
+	{
+		pool.submit([&, k] {
+			UnionFindSegmenter segmenter(similarity);
+			segmenter.segmentRows(in, firstRow[k], firstRow[k + 1],
+				labels + firstRow[k] * cols, stripStats[k], &colors);
+		});
+	}
+	pool.wait();
+	times.label = millisSince(start);
+
+	// Phase 2: strip label l of strip k is label offset[k] + l of the whole
+	// image, unite the labels on either side of every seam
+	start = std::chrono::steady_clock::now();
+	std::vector<int> offset(strips + 1, 0);
+	for (int k = 0; k < strips; k++)
+		offset[k + 1] = offset[k] + (int)stripStats[k].size();
+	DisjointSet seams(offset[strips]);
+	UnionFindSegmenter test(similarity);
+	for (int k = 1; k < strips; k++)
+	{
+		PROFILE_SCOPE("tile_seam");
+		int row = firstRow[k];
+		const pixel* above = colors.getRow(row - 1);
+		const pixel* below = colors.getRow(row);
+		for (int col = 0; col < cols; col++)
+		{
+			if (test.joins(above[col], below[col]))
+				seams.unite(offset[k - 1] + labels[(row - 1) * cols + col],
+					offset[k] + labels[row * cols + col]);
+		}
+	}
+
+	// Strip labels are already in raster order within a strip, so walking
+	// them strip by strip numbers the merged labels in raster order too
+	std::vector<int32_t> rootLabel(offset[strips], -1);
+	std::vector<int32_t> finalLabel(offset[strips]);
+	for (int k = 0; k < strips; k++)
+	{
+		for (size_t l = 0; l < stripStats[k].size(); l++)
+		{
+			int root = seams.find(offset[k] + (int)l);
+			if (rootLabel[root] < 0)
+			{
+				rootLabel[root] = (int32_t)result.stats.size();
+				result.stats.push_back(SegmentStats());
+			}
+			finalLabel[offset[k] + l] = rootLabel[root];
+			result.stats[rootLabel[root]].merge(stripStats[k][l]);
+		}
+	}
+	times.seams = millisSince(start);
+
+	// Phase 3: rewrite every strip's labels to the final labels
+	start = std::chrono::steady_clock::now();
+	for (int k = 0; k < strips; k++)
+	{
+		pool.submit([&, k] {
+			PROFILE_SCOPE("tile_relabel");
+			int32_t* first = labels + firstRow[k] * cols;
+			int32_t* last = labels + firstRow[k + 1] * cols;
+			const int32_t* map = finalLabel.data() + offset[k];
+			for (int32_t* p = first; p != last; p++)
+				*p = map[*p];
+		});
+	}
+	pool.wait();
+	times.relabel = millisSince(start);
+}
+
+/*	returns the time spent in each phase of the last segment()
+	@pre	none
+	@post	phase times of the last segment() are returned	*/
+PhaseTimes TiledSegmenter::getPhaseTimes() const
+{
+	return times;
+}
+
+/*	returns the number of worker threads
+	@pre	none
+	@post	number of worker threads is returned	*/
+int TiledSegmenter::getThreads() const
+{
+	return pool.getSize();
+}
@@ -0,0 +1,55 @@
+/*	TiledSegmenter.h
+	Jayden Fullerton
+
+	This file contains a multithreaded version of the union-find segmentation
+	mode. The image is split into horizontal strips which are labeled in
+	parallel on a thread pool, then a merge pass unites labels that touch
+	across the seams between strips and renumbers them so that the result is
+	exactly the same as labeling the whole image on one thread.	*/
+#pragma once
+
+#include "ThreadPool.h"
+#include "UnionFindSegmenter.h"
+
+/*	PhaseTimes struct
+
+	Wall clock time, in milliseconds, spent in each phase of the last call
+	to TiledSegmenter::segment().	*/
+struct PhaseTimes
+{
+	double label;	// labeling every strip in parallel
+	double seams;	// uniting labels across strip seams
+	double relabel;	// rewriting strip labels to final labels in parallel
+};
+
+class TiledSegmenter
+{
+	ThreadPool pool;
+	Similarity similarity;
+	PhaseTimes times;
+public:
+	/*	TiledSegmenter constructor
+		@param	number of worker threads, 0 uses one per hardware thread
+		@param	metric and threshold two neighbours must be similar by
+		@pre	threads must be non-negative
+		@post	an instance of TiledSegmenter is created and its threads started	*/
+	TiledSegmenter(int threads = 0, const Similarity& similarity = Similarity());
+
+	/*	labels the 4-connected components of an image in parallel
+		@param	image to segment
+		@param	segmentation to write the result to
+		@pre	in must be a valid image object
+		@post	result is identical to UnionFindSegmenter::segment() with the
+				same similarity	*/
+	void segment(const Image& in, Segmentation& result);
+
+	/*	returns the time spent in each phase of the last segment()
+		@pre	none
+		@post	phase times of the last segment() are returned	*/
+	PhaseTimes getPhaseTimes() const;
+
+	/*	returns the number of worker threads
+		@pre	none
+		@post	number of worker threads is returned	*/
+	int getThreads() const;
+};
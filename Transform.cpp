@@ -0,0 +1,289 @@
+/*	Transform.cpp
+	Jayden Fullerton
+
+	This file contains the geometric transforms applied to an image before
+	it is segmented: flips, rotations by multiples of 90 degrees, transposes
+	and crops. Flips reverse rows with the pixel reversal kernel. Transposes
+	and quarter rotations read and write square tiles small enough to stay in
+	cache, so that neither image is walked down a column. Large images are
+	transformed a band of rows at a time on several threads.	*/
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "ColorKernel.h"
+#include "Profile.h"
+#include "ThreadPool.h"
+#include "Transform.h"
+
+// Side of the square tiles of a transpose, in pixels. Two 32 x 32 tiles are
+// 6 KB, well inside the L1 cache, and a tile row of 96 bytes spans only two
+// cache lines
+static const int TILE = 32;
+
+// Rows a worker takes at a time when every row is independent
+static const int BAND_ROWS = 64;
+
+// Bytes swapped at a time when two rows trade places
+static const size_t SWAP_CHUNK = 4096;
+
+/*	reads a transform from its name
+	@param	"fliph", "flipv", "rotate90", "rotate180", "rotate270",
+			"transpose" or "none"
+	@param	transform to set
+	@pre	none
+	@post	transform is set, false is returned if name is unknown	*/
+bool parseTransform(const std::string& name, Transform& transform)
+{
+	if (name == "none")
+		transform = Transform::None;
+	else if (name == "fliph")
+		transform = Transform::FlipHorizontal;
+	else if (name == "flipv")
+		transform = Transform::FlipVertical;
+	else if (name == "rotate90")
+		transform = Transform::Rotate90;
+	else if (name == "rotate180")
+		transform = Transform::Rotate180;
+	else if (name == "rotate270")
+		transform = Transform::Rotate270;
+	else if (name == "transpose")
+		transform = Transform::Transpose;
+	else
+		return false;
+	return true;
+}
+
+/*	returns whether a transform swaps the rows and columns of an image
+	@pre	none
+	@post	true is returned for quarter rotations and transposes	*/
+bool swapsAxes(Transform transform)
+{
+	return transform == Transform::Rotate90 || transform == Transform::Rotate270 || transform == Transform::Transpose;
+}
+
+/*	swaps the pixels of two rows
+	@param	first row
+	@param	second row
+	@param	pixels in each row
+	@pre	the rows must not overlap
+	@post	a and b have traded pixels	*/
+static void swapRows(pixel* a, pixel* b, int count)
+{
+	unsigned char buffer[SWAP_CHUNK];
+	unsigned char* x = (unsigned char*)a;
+	unsigned char* y = (unsigned char*)b;
+	size_t bytes = (size_t)count * sizeof(pixel);
+	for (size_t done = 0; done < bytes; done += SWAP_CHUNK)
+	{
+		size_t size = std::min(SWAP_CHUNK, bytes - done);
+		memcpy(buffer, x + done, size);
+		memcpy(x + done, y + done, size);
+		memcpy(y + done, buffer, size);
+	}
+}
+
+/*	fills rows of a transposed or quarter rotated image a tile at a time
+	@param	image to write, pixel (i, j) is read from origin + i * iStep + j * jStep
+	@param	source pixel of output pixel (0, 0)
+	@param	source step from one output row to the next
+	@param	source step from one output column to the next
+	@param	first output row
+	@param	one past the last output row
+	@pre	every source pixel must lie inside the input image
+	@post	output rows first to last are filled	*/
+static void transposeRows(Image& out, const pixel* origin, ptrdiff_t iStep, ptrdiff_t jStep, int first, int last)
+{
+	int cols = out.getCols();
+	for (int top = first; top < last; top += TILE)
+	{
+		int bottom = std::min(last, top + TILE);
+		for (int left = 0; left < cols; left += TILE)
+		{
+			// the tile's source rows stay in cache while its rows are written
+			int right = std::min(cols, left + TILE);
+			for (int i = top; i < bottom; i++)
+			{
+				pixel* line = out.getRow(i);
+				const pixel* source = origin + i * iStep;
+				for (int j = left; j < right; j++)
+					line[j] = source[j * jStep];
+			}
+		}
+	}
+}
+
+/*	transposes a square image in place, a row of tiles at a time
+	@param	image to transpose
+	@param	first row of the band, a multiple of TILE
+	@param	one past the last row of the band
+	@pre	img must be square
+	@post	every pixel of the band's rows at or right of the diagonal has
+			traded places with its mirror across the diagonal	*/
+static void transposeBand(Image& img, int first, int last)
+{
+	int size = img.getCols();
+	for (int left = first; left < size; left += TILE)
+	{
+		int right = std::min(size, left + TILE);
+		for (int i = first; i < last; i++)
+		{
+			pixel* line = img.getRow(i);
+			// tiles on the diagonal are only swapped above it
+			for (int j = std::max(left, i + 1); j < right; j++)
+				std::swap(line[j], img.getRow(j)[i]);
+		}
+	}
+}
+
+/*	transforms an image into a new one
+	@param	image to transform
+	@param	transform to apply
+	@param	threads to run on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	the transformed image is returned, in is unchanged	*/
+Image transformImage(const Image& in, Transform transform, int threads)
+{
+	PROFILE_SCOPE("transform");
+	int rows = in.getRows();
+	int cols = in.getCols();
+	if (swapsAxes(transform))
+	{
+		Image out(cols, rows);
+		if (rows == 0 || cols == 0)
+			return out;
+
+		ptrdiff_t stride = in.getStride();
+		const pixel* origin = in.getData();
+		ptrdiff_t iStep = 1, jStep = stride;
+		if (transform == Transform::Rotate90)
+		{
+			// out(i, j) = in(rows - 1 - j, i)
+			origin += (rows - 1) * stride;
+			jStep = -stride;
+		}
+		else if (transform == Transform::Rotate270)
+		{
+			// out(i, j) = in(j, cols - 1 - i)
+			origin += cols - 1;
+			iStep = -1;
+		}
+		forEachBand(cols, TILE, threads, [&](int, int first, int last)
+		{
+			transposeRows(out, origin, iStep, jStep, first, last);
+			return true;
+		});
+		return out;
+	}
+
+	Image out(rows, cols);
+	size_t rowBytes = (size_t)cols * sizeof(pixel);
+	forEachBand(rows, BAND_ROWS, threads, [&](int, int first, int last)
+	{
+		for (int row = first; row < last; row++)
+		{
+			pixel* line = out.getRow(row);
+			switch (transform)
+			{
+			case Transform::FlipHorizontal:
+				reversePixels(in.getRow(row), cols, line);
+				break;
+			case Transform::FlipVertical:
+				memcpy(line, in.getRow(rows - 1 - row), rowBytes);
+				break;
+			case Transform::Rotate180:
+				reversePixels(in.getRow(rows - 1 - row), cols, line);
+				break;
+			default:
+				memcpy(line, in.getRow(row), rowBytes);
+			}
+		}
+		return true;
+	});
+	return out;
+}
+
+/*	transforms an image in place
+	@param	image to transform
+	@param	transform to apply
+	@param	threads to run on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	img holds the transformed image. Flips, 180 degree rotations and
+			transforms of square images reuse its pixels; the others cannot
+			and replace them with a new buffer	*/
+void transformInPlace(Image& img, Transform transform, int threads)
+{
+	int rows = img.getRows();
+	int cols = img.getCols();
+	if (transform == Transform::None)
+		return;
+	if (swapsAxes(transform) && rows != cols)
+	{
+		img = transformImage(img, transform, threads);
+		return;
+	}
+
+	PROFILE_SCOPE("transform");
+	if (swapsAxes(transform))
+	{
+		forEachBand(rows, TILE, threads, [&](int, int first, int last)
+		{
+			transposeBand(img, first, last);
+			return true;
+		});
+		// a quarter rotation is a transpose and then a flip
+		if (transform == Transform::Rotate90)
+			transform = Transform::FlipHorizontal;
+		else if (transform == Transform::Rotate270)
+			transform = Transform::FlipVertical;
+		else
+			return;
+	}
+
+	if (transform == Transform::FlipHorizontal)
+	{
+		forEachBand(rows, BAND_ROWS, threads, [&](int, int first, int last)
+		{
+			for (int row = first; row < last; row++)
+				reversePixelsInPlace(img.getRow(row), cols);
+			return true;
+		});
+		return;
+	}
+
+	// vertical flips and 180 degree rotations trade the rows of the top half
+	// with those of the bottom half, the middle row stays where it is
+	bool reverse = transform == Transform::Rotate180;
+	forEachBand((rows + 1) / 2, BAND_ROWS, threads, [&](int, int first, int last)
+	{
+		for (int row = first; row < last; row++)
+		{
+			pixel* top = img.getRow(row);
+			pixel* bottom = img.getRow(rows - 1 - row);
+			if (reverse)
+			{
+				reversePixelsInPlace(top, cols);
+				if (bottom != top)
+					reversePixelsInPlace(bottom, cols);
+			}
+			if (bottom != top)
+				swapRows(top, bottom, cols);
+		}
+		return true;
+	});
+}
+
+/*	copies a rectangle of an image
+	@param	image to crop
+	@param	first row of the rectangle
+	@param	first column of the rectangle
+	@param	rows of the rectangle
+	@param	columns of the rectangle
+	@pre	the rectangle must lie inside in
+	@post	a rows by cols image of the rectangle is returned	*/
+Image cropImage(const Image& in, int top, int left, int rows, int cols)
+{
+	Image out(rows, cols);
+	for (int row = 0; row < rows; row++)
+		memcpy(out.getRow(row), in.getRow(top + row) + left, (size_t)cols * sizeof(pixel));
+	return out;
+}
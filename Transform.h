@@ -0,0 +1,66 @@
+/*	Transform.h
+	Jayden Fullerton
+
+	This file contains the geometric transforms applied to an image before
+	it is segmented: flips, rotations by multiples of 90 degrees, transposes
+	and crops. Flips reverse rows with the pixel reversal kernel. Transposes
+	and quarter rotations read and write square tiles small enough to stay in
+	cache, so that neither image is walked down a column. Large images are
+	transformed a band of rows at a time on several threads.	*/
+#pragma once
+
+#include <string>
+#include "Image.h"
+
+// A flip, rotation or transpose. Rotations are clockwise.
+enum class Transform
+{
+	None,
+	FlipHorizontal,		// left and right swapped, as Image::mirror
+	FlipVertical,		// top and bottom swapped
+	Rotate90,
+	Rotate180,
+	Rotate270,
+	Transpose			// rows become columns
+};
+
+/*	reads a transform from its name
+	@param	"fliph", "flipv", "rotate90", "rotate180", "rotate270",
+			"transpose" or "none"
+	@param	transform to set
+	@pre	none
+	@post	transform is set, false is returned if name is unknown	*/
+bool parseTransform(const std::string& name, Transform& transform);
+
+/*	returns whether a transform swaps the rows and columns of an image
+	@pre	none
+	@post	true is returned for quarter rotations and transposes	*/
+bool swapsAxes(Transform transform);
+
+/*	transforms an image into a new one
+	@param	image to transform
+	@param	transform to apply
+	@param	threads to run on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	the transformed image is returned, in is unchanged	*/
+Image transformImage(const Image& in, Transform transform, int threads = 1);
+
+/*	transforms an image in place
+	@param	image to transform
+	@param	transform to apply
+	@param	threads to run on, 0 for every hardware thread
+	@pre	threads must be non-negative
+	@post	img holds the transformed image. Flips, 180 degree rotations and
+			transforms of square images reuse its pixels; the others cannot
+			and replace them with a new buffer	*/
+void transformInPlace(Image& img, Transform transform, int threads = 1);
+
+/*	copies a rectangle of an image
+	@param	image to crop
+	@param	first row of the rectangle
+	@param	first column of the rectangle
+	@param	rows of the rectangle
+	@param	columns of the rectangle
+	@pre	the rectangle must lie inside in
+	@post	a rows by cols image of the rectangle is returned	*/
+Image cropImage(const Image& in, int top, int left, int rows, int cols);
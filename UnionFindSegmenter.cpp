@@ -0,0 +1,178 @@
+/*	UnionFindSegmenter.cpp
+	Jayden Fullerton
+
+	This file contains a second segmentation mode built on a disjoint-set
+	forest over pixel indices. Neighbouring pixels that pass a color
+	similarity test are united in a single raster pass, and a second pass
+	resolves every pixel to a dense label and gathers per-label statistics.
+	Unlike the region grower, pixels are compared with their neighbours rather
+	than with a seed, so the result does not depend on where a region starts.
+	Whole rows of neighbours are compared at once, and the color metric is a
+	policy chosen once per band so its test is inlined into the pass.	*/
+#include "Profile.h"
+#include "UnionFindSegmenter.h"
+
+/*	UnionFindSegmenter constructor
+	@param	metric and threshold two neighbours must be similar by
+	@pre	none
+	@post	an instance of UnionFindSegmenter is created	*/
+UnionFindSegmenter::UnionFindSegmenter(const Similarity& similarity)
+{
+	this->similarity = similarity;
+}
+
+/*	labels the 4-connected components of an image
+	@param	image to segment
+	@param	segmentation to write the result to
+	@pre	in must be a valid image object
+	@post	result holds a dense label for every pixel of in and the
+			statistics of every label	*/
+void UnionFindSegmenter::segment(const Image& in, Segmentation& result)
+{
+	result.rows = in.getRows();
+	result.cols = in.getCols();
+	result.labels.resize(result.rows * result.cols);
+	result.stats.clear();
+	segmentRows(in, 0, result.rows, result.labels.data(), result.stats);
+}
+
+/*	labels the 4-connected components of a band of rows
+	@param	image to segment
+	@param	first row of the band
+	@param	one past the last row of the band
+	@param	label map of the band, labels[0] is firstRow, column 0
+	@param	statistics of the band's labels
+	@param	in converted for the metric by comparisonImage(), nullptr to
+			convert it here
+	@pre	firstRow..lastRow-1 must be rows of in, labels must hold
+			(lastRow - firstRow) * in.getCols() entries
+	@post	labels holds a label for every pixel of the band, numbered
+			from 0 in raster order within the band, and stats holds
+			the statistics of every label	*/
+void UnionFindSegmenter::segmentRows(const Image& in, int firstRow, int lastRow, int32_t* labels,
+	std::vector<SegmentStats>& stats, const Image* compared)
+{
+	PROFILE_SCOPE("union_find_rows");
+	int cols = in.getCols();
+	int size = (lastRow - firstRow) * cols;
+	PROFILE_COUNT(PixelsVisited, size);
+	stats.clear();
+	forest.reset(size);
+
+	// First pass: unite every pixel with its similar left and upper neighbour
+	Image converted(0, 0);
+	const Image& colors = compared != nullptr ? *compared : comparisonImage(in, similarity, converted);
+	switch (similarity.metric)
+	{
+	case Metric::L2:
+		uniteRows(L2Policy(similarity), colors, firstRow, lastRow);
+		break;
+	case Metric::Chebyshev:
+		uniteRows(ChebyshevPolicy(similarity), colors, firstRow, lastRow);
+		break;
+	case Metric::Weighted:
+		uniteRows(WeightedPolicy(similarity), colors, firstRow, lastRow);
+		break;
+	case Metric::Lab:
+		uniteRows(LabPolicy(similarity), colors, firstRow, lastRow);
+		break;
+	default:
+		uniteRows(L1Policy(similarity), colors, firstRow, lastRow);
+		break;
+	}
+
+	// Second pass: number the roots in raster order and gather statistics.
+	// A root's slot in labels holds its label once assigned; every other slot
+	// is only written by its own pixel, so one array is enough.
+	for (int i = 0; i < size; i++)
+		labels[i] = -1;
+	for (int row = firstRow; row < lastRow; row++)
+	{
+		const pixel* cur = in.getRow(row);
+		int base = (row - firstRow) * cols;
+		for (int col = 0; col < cols; col++)
+		{
+			int root = forest.find(base + col);
+			int32_t label = labels[root];
+			if (label < 0)
+			{
+				label = (int32_t)stats.size();
+				labels[root] = label;
+				stats.push_back(SegmentStats());
+			}
+			labels[base + col] = label;
+			stats[label].add(cur[col], row, col);
+		}
+	}
+}
+
+/*	unites the similar neighbours of a band of rows
+	@param	metric policy
+	@param	image to measure distances on
+	@param	first row of the band
+	@param	one past the last row of the band
+	@pre	forest must hold one set per pixel of the band
+	@post	every pixel is united with its left and upper neighbour if
+			they are similar	*/
+template <class Policy>
+void UnionFindSegmenter::uniteRows(const Policy& policy, const Image& in, int firstRow, int lastRow)
+{
+	int cols = in.getCols();
+	across.resize(maskWords(cols));
+	down.resize(maskWords(cols));
+	for (int row = firstRow; row < lastRow; row++)
+	{
+		const pixel* cur = in.getRow(row);
+		int base = (row - firstRow) * cols;
+
+		// bit col - 1 of across joins col to col - 1
+		if (cols > 1)
+		{
+			pairMask(policy, cur + 1, cur, cols - 1, across.data());
+			for (int w = 0; w < maskWords(cols - 1); w++)
+			{
+				for (uint64_t bits = across[w]; bits != 0; bits &= bits - 1)
+				{
+					int col = w * 64 + lowestBit(bits) + 1;
+					forest.unite(base + col, base + col - 1);
+				}
+			}
+		}
+
+		// bit col of down joins col to the pixel above it
+		if (row > firstRow)
+		{
+			pairMask(policy, cur, in.getRow(row - 1), cols, down.data());
+			for (int w = 0; w < maskWords(cols); w++)
+			{
+				for (uint64_t bits = down[w]; bits != 0; bits &= bits - 1)
+				{
+					int col = w * 64 + lowestBit(bits);
+					forest.unite(base + col, base + col - cols);
+				}
+			}
+		}
+	}
+}
+
+/*	are two neighbouring pixels joined
+	@param	first pixel
+	@param	second pixel
+	@pre	a and b must be pixels of the image distances are measured on
+	@post	true is returned if a and b are similar	*/
+bool UnionFindSegmenter::joins(const pixel& a, const pixel& b) const
+{
+	switch (similarity.metric)
+	{
+	case Metric::L2:
+		return L2Policy(similarity)(a, b);
+	case Metric::Chebyshev:
+		return ChebyshevPolicy(similarity)(a, b);
+	case Metric::Weighted:
+		return WeightedPolicy(similarity)(a, b);
+	case Metric::Lab:
+		return LabPolicy(similarity)(a, b);
+	default:
+		return L1Policy(similarity)(a, b);
+	}
+}
@@ -0,0 +1,84 @@
+/*	UnionFindSegmenter.h
+	Jayden Fullerton
+
+	This file contains a second segmentation mode built on a disjoint-set
+	forest over pixel indices. Neighbouring pixels that pass a color
+	similarity test are united in a single raster pass, and a second pass
+	resolves every pixel to a dense label and gathers per-label statistics.
+	Unlike the region grower, pixels are compared with their neighbours rather
+	than with a seed, so the result does not depend on where a region starts.	*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ColorMetric.h"
+#include "DisjointSet.h"
+#include "Image.h"
+#include "SegmentStats.h"
+
+/*	Segmentation struct
+
+	Result of labeling an image. labels holds the label of every pixel in
+	row-major order (row * cols + col), labels are numbered 0..stats.size()-1
+	in the order their first pixel appears in a raster scan.	*/
+struct Segmentation
+{
+	int rows, cols;
+	std::vector<int32_t> labels;
+	std::vector<SegmentStats> stats;
+};
+
+class UnionFindSegmenter
+{
+	/*	unites the similar neighbours of a band of rows
+		@param	metric policy
+		@param	image to measure distances on
+		@param	first row of the band
+		@param	one past the last row of the band
+		@pre	forest must hold one set per pixel of the band
+		@post	every pixel is united with its left and upper neighbour if
+				they are similar	*/
+	template <class Policy>
+	void uniteRows(const Policy& policy, const Image& in, int firstRow, int lastRow);
+
+	DisjointSet forest;
+	std::vector<uint64_t> across, down;
+	Similarity similarity;
+public:
+	/*	UnionFindSegmenter constructor
+		@param	metric and threshold two neighbours must be similar by
+		@pre	none
+		@post	an instance of UnionFindSegmenter is created	*/
+	UnionFindSegmenter(const Similarity& similarity = Similarity());
+
+	/*	labels the 4-connected components of an image
+		@param	image to segment
+		@param	segmentation to write the result to
+		@pre	in must be a valid image object
+		@post	result holds a dense label for every pixel of in and the
+				statistics of every label	*/
+	void segment(const Image& in, Segmentation& result);
+
+	/*	labels the 4-connected components of a band of rows
+		@param	image to segment
+		@param	first row of the band
+		@param	one past the last row of the band
+		@param	label map of the band, labels[0] is firstRow, column 0
+		@param	statistics of the band's labels
+		@param	in converted for the metric by comparisonImage(), nullptr to
+				convert it here
+		@pre	firstRow..lastRow-1 must be rows of in, labels must hold
+				(lastRow - firstRow) * in.getCols() entries
+		@post	labels holds a label for every pixel of the band, numbered
+				from 0 in raster order within the band, and stats holds
+				the statistics of every label	*/
+	void segmentRows(const Image& in, int firstRow, int lastRow, int32_t* labels,
+		std::vector<SegmentStats>& stats, const Image* compared = nullptr);
+
+	/*	are two neighbouring pixels joined
+		@param	first pixel
+		@param	second pixel
+		@pre	a and b must be pixels of the image distances are measured on
+		@post	true is returned if a and b are similar	*/
+	bool joins(const pixel& a, const pixel& b) const;
+};